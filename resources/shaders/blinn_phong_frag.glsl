@@ -7,7 +7,7 @@ uniform vec3 matDif;
 uniform vec3 matSpec;
 uniform float specIntensity;
 
-const int MAX_TOTAL_LIGHTS = 6;
+const int MAX_DIR_LIGHTS = 3;
 
 in vec3 meshPosition;
 in vec3 scenePosition;
@@ -20,14 +20,30 @@ in vec3 viewNormal;
 in vec3 postBHNormal;
 
 uniform bool useBlackHole;
-uniform bool blackHoleSecondary;
+flat in int secondaryImage;
 in vec3 viewBlackHolePosition;
 in float blackHolePrimaryMinAngle;
 in float blackHoleSecondaryMinAngle;
 in vec3 viewBlackHoleObserver;
 
-in vec3 lightDirections[MAX_TOTAL_LIGHTS];
-in float lightIntensities[MAX_TOTAL_LIGHTS];
+in vec3 lightDirections[MAX_DIR_LIGHTS];
+in float lightIntensities[MAX_DIR_LIGHTS];
+in vec3 lightingPosition;
+
+// one texel per point light, view space position in xyz and intensity in w,
+// see Scene::updateFrameUniforms
+uniform samplerBuffer pointLights;
+
+vec3 shade(vec3 lightDir, float intensity)
+{
+	vec3 lightDirNorm = normalize(lightDir);
+	float lightFalloff = 1.0 / max(dot(lightDir, lightDir), 1.0);
+	float lightIntensity = intensity * lightFalloff;
+	float dC = max(dot(viewNormal, lightDirNorm), 0.0);
+	vec3 H = normalize((-normalize(viewPosition) + lightDirNorm) / 2);
+	float sC = pow(max(dot(viewNormal, H), 0), specIntensity);
+	return (matDif * dC + matSpec * sC) * lightIntensity;
+}
 
 void main()
 {
@@ -41,7 +57,7 @@ void main()
 		vec3 dirToBlackHole = normalize(viewBlackHolePosition);
 		float bhAngle = acos(clamp(dot(dirToVertex, dirToBlackHole), -1.0, 1.0));
 		float originalAngle = acos(clamp(dot(dirToOriginalVertex, dirToBlackHole), -1.0, 1.0));
-		if (blackHoleSecondary)
+		if (secondaryImage != 0)
 		{
 			// TODO: unify with other one :(
 			if (bhAngle < blackHoleSecondaryMinAngle)
@@ -62,16 +78,15 @@ void main()
 	vec3 finalColor = vec3(0.0);
 
 	#pragma optionNV(unroll all)
-	for (int i = 0; i < MAX_TOTAL_LIGHTS; i++)
+	for (int i = 0; i < MAX_DIR_LIGHTS; i++)
+	{
+		finalColor += shade(lightDirections[i], lightIntensities[i]);
+	}
+	int pointLightCount = textureSize(pointLights);
+	for (int i = 0; i < pointLightCount; i++)
 	{
-		vec3 lightDir = lightDirections[i];
-		vec3 lightDirNorm = normalize(lightDir);
-		float lightFalloff = 1.0 / max(dot(lightDir, lightDir), 1.0);
-		float lightIntensity = lightIntensities[i] * lightFalloff;
-		float dC = max(dot(viewNormal, lightDirNorm), 0.0);
-		vec3 H = normalize((-normalize(viewPosition) + lightDirNorm) / 2);
-		float sC = pow(max(dot(viewNormal, H), 0), specIntensity);
-		finalColor += (matDif * dC + matSpec * sC) * lightIntensity;
+		vec4 light = texelFetch(pointLights, i);
+		finalColor += shade(light.xyz - lightingPosition, light.w);
 	}
 
 	color = vec4(matAmb + finalColor, 1.0);
@@ -11,7 +11,7 @@ in vec3 viewNormal;
 in vec3 postBHNormal;
 
 uniform bool useBlackHole;
-uniform bool blackHoleSecondary;
+flat in int secondaryImage;
 in vec3 viewBlackHolePosition;
 in float blackHolePrimaryMinAngle;
 in float blackHoleSecondaryMinAngle;
@@ -31,7 +31,7 @@ void main()
 		vec3 dirToBlackHole = normalize(viewBlackHolePosition);
 		float bhAngle = acos(clamp(dot(dirToVertex, dirToBlackHole), -1.0, 1.0));
 		float originalAngle = acos(clamp(dot(dirToOriginalVertex, dirToBlackHole), -1.0, 1.0));
-		if (blackHoleSecondary)
+		if (secondaryImage != 0)
 		{
 			if (bhAngle < blackHoleSecondaryMinAngle || originalAngle < 0.05)
 			{
@@ -5,34 +5,49 @@
 layout(location = 0) in vec4 vertPos;
 layout(location = 1) in vec3 vertNor;
 layout(location = 2) in vec2 vertTex;
+// baseInstance + gl_InstanceID / divisor, from a buffer of 0, 1, 2... so indirect
+// draws can say where their instances start; see GeometryArena::reserveInstances
+layout(location = 3) in int vertInstance;
 
 uniform sampler3D blackHoleMesh;
-uniform vec3 blackHolePosition;
-uniform float blackHoleSize;
-uniform float blackHoleVertexMin;
-uniform float blackHoleVertexMax;
-uniform float blackHoleObserverMin;
-uniform float blackHoleObserverMax;
 uniform bool useBlackHole;
 uniform bool blackHoleSecondary;
-uniform bool freeCam;
+// draw both images at once, even instances primary and odd ones secondary,
+// with the instance divisor at 2 so each pair shares a transform
+uniform bool bothImages;
 
 uniform bool flipNormals;
 
-uniform mat4 P;
-uniform mat4 V;
-uniform mat4 M;
+// model matrices of everything drawn this frame, one column per texel, and
+// where this draw's instances start when the draw can't say; see RenderQueue
+uniform samplerBuffer instanceTransforms;
+uniform int instanceBase;
 
-// max light count kinda low cause i'm lazy
+// max light count kinda low cause i'm lazy, point lights are unlimited though
 const int MAX_DIR_LIGHTS = 3;
-const int MAX_POINT_LIGHTS = 3;
-const int MAX_TOTAL_LIGHTS = 6;
 
-uniform vec3 dirLightDirections[MAX_DIR_LIGHTS];
-uniform float dirLightIntensities[MAX_DIR_LIGHTS];
-
-uniform vec3 pointLightPositions[MAX_POINT_LIGHTS];
-uniform float pointLightIntensities[MAX_POINT_LIGHTS];
+// everything that is the same for every draw in a frame, filled once per frame
+// by Scene::drawAll; must match FrameUniforms in Scene.h
+layout(std140) uniform FrameData
+{
+	mat4 P;
+	mat4 V;
+	vec3 blackHolePosition;
+	float blackHoleSize;
+	float blackHoleVertexMin;
+	float blackHoleVertexMax;
+	float blackHoleObserverMin;
+	float blackHoleObserverMax;
+	// per axis warp of the table as (vertex r, vertex phi, observer r), see BlackHoleLUT.h
+	ivec3 blackHoleWarp;
+	bool freeCam;
+	vec3 blackHoleWarpParameter;
+	// 16 bit tables come back normalized, (1, 1, 1) and (0, 0, 0) for float tables
+	vec3 blackHoleChannelScale;
+	vec3 blackHoleChannelOffset;
+	// direction in xyz, intensity in w
+	vec4 dirLights[MAX_DIR_LIGHTS];
+};
 
 out vec3 meshPosition;
 out vec3 scenePosition;
@@ -46,13 +61,18 @@ out vec3 postBHNormal;
 
 out vec2 vTexCoord;
 
+// which image this vertex is in, for the fragment shader's horizon test
+flat out int secondaryImage;
+
 out vec3 viewBlackHolePosition;
 out float blackHolePrimaryMinAngle;
 out float blackHoleSecondaryMinAngle;
 out vec3 viewBlackHoleObserver;
 
-out vec3 lightDirections[MAX_TOTAL_LIGHTS];
-out float lightIntensities[MAX_TOTAL_LIGHTS];
+out vec3 lightDirections[MAX_DIR_LIGHTS];
+out float lightIntensities[MAX_DIR_LIGHTS];
+// where the point lights are measured from, the real view space position even in free cam
+out vec3 lightingPosition;
 
 // https://www.neilmendoza.com/glsl-rotation-about-an-arbitrary-axis/
 mat4 rotationMatrix(vec3 axis, float angle)
@@ -73,8 +93,48 @@ float map(float value, float min1, float max1, float min2, float max2)
 	return min2 + (value - min1) * (max2 - min2) / (max1 - min1);
 }
 
+// must match BlackHoleLUT::warpAxis
+float warpAxis(float value, float minValue, float maxValue, int warp, float parameter)
+{
+	value = clamp(value, minValue, maxValue);
+	if (warp == 1)
+	{
+		return log((value - parameter) / (minValue - parameter)) / log((maxValue - parameter) / (minValue - parameter));
+	}
+	if (warp == 2)
+	{
+		float middle = 0.5 * (minValue + maxValue);
+		float halfRange = 0.5 * (maxValue - minValue);
+		return 0.5 + asinh((value - middle) / halfRange * sinh(parameter)) / (2.0 * parameter);
+	}
+	return map(value, minValue, maxValue, 0.0, 1.0);
+}
+
+// table entries sit on the grid points rather than the texel edges, so the ends
+// of each axis land on the first and last texel centres
+vec3 tableCoord(float observerT, float vertexPhiT, float vertexRT)
+{
+	vec3 size = vec3(textureSize(blackHoleMesh, 0));
+	return (vec3(observerT, vertexPhiT, vertexRT) * (size - 1.0) + 0.5) / size;
+}
+
+vec3 sampleTable(vec3 coord)
+{
+	return texture(blackHoleMesh, coord).xyz * blackHoleChannelScale + blackHoleChannelOffset;
+}
+
+mat4 instanceTransform(int instance)
+{
+	return mat4(texelFetch(instanceTransforms, instance * 4),
+		texelFetch(instanceTransforms, instance * 4 + 1),
+		texelFetch(instanceTransforms, instance * 4 + 2),
+		texelFetch(instanceTransforms, instance * 4 + 3));
+}
+
 void main()
 {
+	bool secondary = bothImages ? (gl_InstanceID & 1) == 1 : blackHoleSecondary;
+	mat4 M = instanceTransform(instanceBase + vertInstance);
 	vec3 fixedCameraPosition = vec3(1.0, 2.0, 5.0);
 	vec3 bhObserver;
 
@@ -112,18 +172,18 @@ void main()
 
 		float vertexR = length(bhVertex2dCart);
 		float vertexPhi = atan(bhVertex2dY, bhVertex2dX);
-		if (blackHoleSecondary)
+		if (secondary)
 		{
 			vertexPhi = 2 * PI - vertexPhi;
 		}
 		float observerR = length(bhObserver2dCart);
 	
-		float vertexRMapped = map(vertexR / blackHoleSize, blackHoleVertexMin, blackHoleVertexMax, 0.0, 1.0);
-		float vertexPhiMapped = map(vertexPhi, 0, 2 * PI, 0.0, 1.0);
-		float observerRMapped = map(observerR / blackHoleSize, blackHoleObserverMin, blackHoleObserverMax, 0.0, 1.0);
+		float vertexRMapped = warpAxis(vertexR / blackHoleSize, blackHoleVertexMin, blackHoleVertexMax, blackHoleWarp.x, blackHoleWarpParameter.x);
+		float vertexPhiMapped = warpAxis(vertexPhi, 0, 2 * PI, blackHoleWarp.y, blackHoleWarpParameter.y);
+		float observerRMapped = warpAxis(observerR / blackHoleSize, blackHoleObserverMin, blackHoleObserverMax, blackHoleWarp.z, blackHoleWarpParameter.z);
 
-		vec3 coord = vec3(observerRMapped, vertexPhiMapped, vertexRMapped);
-		vec3 bh = texture(blackHoleMesh, coord).xyz;
+		vec3 coord = tableCoord(observerRMapped, vertexPhiMapped, vertexRMapped);
+		vec3 bh = sampleTable(coord);
 		float va = bh.x;
 		float oa = bh.y;
 		float d = bh.z;
@@ -132,7 +192,7 @@ void main()
 		d += max(0, observerR - blackHoleObserverMax * blackHoleSize);
 		d += max(0, vertexR - blackHoleVertexMax * blackHoleSize);
 
-		vec3 directionFromObserver = cos(oa) * bhXAxis + sin(oa) * (blackHoleSecondary ? -bhYAxis : bhYAxis);
+		vec3 directionFromObserver = cos(oa) * bhXAxis + sin(oa) * (secondary ? -bhYAxis : bhYAxis);
 		vec3 displacementFromObserver = directionFromObserver * d;
 		vec3 normalRotationAxis = cross(bhXAxis, bhYAxis);
 		float normalRotationAmount = (oa + PI) - va; // probably right?
@@ -142,23 +202,19 @@ void main()
 		postBHNormal = (normalRotationMatrix * viewNormalV4).xyz;
 
 		viewBlackHolePosition = bhHole;
-		vec3 closestPrimaryRayToHorizon = vec3(observerRMapped, 0.5, vertexRMapped);
-		blackHolePrimaryMinAngle = PI - texture(blackHoleMesh, closestPrimaryRayToHorizon).y;
-		vec3 closestSecondaryRayToHorizon = vec3(observerRMapped, 1.0, vertexRMapped);
-		blackHoleSecondaryMinAngle = PI - texture(blackHoleMesh, closestSecondaryRayToHorizon).y;
+		vec3 closestPrimaryRayToHorizon = tableCoord(observerRMapped, warpAxis(PI, 0, 2 * PI, blackHoleWarp.y, blackHoleWarpParameter.y), vertexRMapped);
+		blackHolePrimaryMinAngle = PI - sampleTable(closestPrimaryRayToHorizon).y;
+		vec3 closestSecondaryRayToHorizon = tableCoord(observerRMapped, 1.0, vertexRMapped);
+		blackHoleSecondaryMinAngle = PI - sampleTable(closestSecondaryRayToHorizon).y;
 	}
 	
 
 	for (int i = 0; i < MAX_DIR_LIGHTS; i++)
 	{
-		lightDirections[i] = normalize((V * vec4(-dirLightDirections[i], 0.0)).xyz);
-		lightIntensities[i] = dirLightIntensities[i];
-	}
-	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
-	{
-		lightDirections[i + 3] = (V * vec4(pointLightPositions[i], 1.0) - V * M * vertPos).xyz;
-		lightIntensities[i + 3] = pointLightIntensities[i];
+		lightDirections[i] = normalize((V * vec4(-dirLights[i].xyz, 0.0)).xyz);
+		lightIntensities[i] = dirLights[i].w;
 	}
+	lightingPosition = viewPositionV4.xyz;
 
 	
 	meshPosition = meshPositionV4.xyz;
@@ -186,4 +242,5 @@ void main()
 	}
 
 	vTexCoord = vertTex;
+	secondaryImage = secondary ? 1 : 0;
 }
@@ -8,7 +8,7 @@ uniform float dif;
 uniform float spec;
 uniform float specIntensity;
 
-const int MAX_TOTAL_LIGHTS = 6;
+const int MAX_DIR_LIGHTS = 3;
 
 in vec3 meshPosition;
 in vec3 scenePosition;
@@ -23,14 +23,30 @@ in vec3 postBHNormal;
 in vec2 vTexCoord;
 
 uniform bool useBlackHole;
-uniform bool blackHoleSecondary;
+flat in int secondaryImage;
 in vec3 viewBlackHolePosition;
 in float blackHolePrimaryMinAngle;
 in float blackHoleSecondaryMinAngle;
 in vec3 viewBlackHoleObserver;
 
-in vec3 lightDirections[MAX_TOTAL_LIGHTS];
-in float lightIntensities[MAX_TOTAL_LIGHTS];
+in vec3 lightDirections[MAX_DIR_LIGHTS];
+in float lightIntensities[MAX_DIR_LIGHTS];
+in vec3 lightingPosition;
+
+// one texel per point light, view space position in xyz and intensity in w,
+// see Scene::updateFrameUniforms
+uniform samplerBuffer pointLights;
+
+vec3 shade(vec3 lightDir, float intensity, vec3 normal, vec3 texColor0)
+{
+	vec3 lightDirNorm = normalize(lightDir);
+	float lightFalloff = 1.0 / max(dot(lightDir, lightDir), 1.0);
+	float lightIntensity = intensity * lightFalloff;
+	float dC = max(dot(normal, lightDirNorm), 0.0);
+	vec3 H = normalize((-normalize(viewPosition) + lightDirNorm) / 2);
+	float sC = pow(max(dot(normal, H), 0), specIntensity);
+	return (texColor0 * dC * dif + texColor0 * sC * spec) * lightIntensity;
+}
 
 void main()
 {
@@ -46,7 +62,7 @@ void main()
 		vec3 dirToBlackHole = normalize(viewBlackHolePosition - viewBlackHoleObserver);
 		float bhAngle = acos(clamp(dot(dirToVertex, dirToBlackHole), -1.0, 1.0));
 		float originalAngle = acos(clamp(dot(dirToOriginalVertex, dirToBlackHole), -1.0, 1.0));
-		if (blackHoleSecondary)
+		if (secondaryImage != 0)
 		{
 			if (bhAngle < blackHoleSecondaryMinAngle || originalAngle < 0.04)
 			{
@@ -68,16 +84,15 @@ void main()
 	vec3 finalColor = vec3(0.0);
 
 	#pragma optionNV(unroll all)
-	for (int i = 0; i < MAX_TOTAL_LIGHTS; i++)
+	for (int i = 0; i < MAX_DIR_LIGHTS; i++)
+	{
+		finalColor += shade(lightDirections[i], lightIntensities[i], normal, texColor0);
+	}
+	int pointLightCount = textureSize(pointLights);
+	for (int i = 0; i < pointLightCount; i++)
 	{
-		vec3 lightDir = lightDirections[i];
-		vec3 lightDirNorm = normalize(lightDir);
-		float lightFalloff = 1.0 / max(dot(lightDir, lightDir), 1.0);
-		float lightIntensity = lightIntensities[i] * lightFalloff;
-		float dC = max(dot(normal, lightDirNorm), 0.0);
-		vec3 H = normalize((-normalize(viewPosition) + lightDirNorm) / 2);
-		float sC = pow(max(dot(normal, H), 0), specIntensity);
-		finalColor += (texColor0 * dC * dif + texColor0 * sC * spec) * lightIntensity;
+		vec4 light = texelFetch(pointLights, i);
+		finalColor += shade(light.xyz - lightingPosition, light.w, normal, texColor0);
 	}
 
 	color = vec4(texColor0 * amb + finalColor, 1.0);
@@ -0,0 +1,300 @@
+#include "AdaptiveTessellation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace
+{
+
+// vertices or edges per task, and per warp batch
+const size_t CHUNK_SIZE = 4096;
+
+struct Edge
+{
+	unsigned int a;
+	unsigned int b;
+};
+
+// every distinct edge, and for each corner the edge from it to the next corner of its triangle
+void buildEdges(const std::vector<unsigned int>& indices, std::vector<Edge>& edges, std::vector<unsigned int>& cornerEdges)
+{
+	size_t cornerCount = indices.size() / 3 * 3;
+	std::vector<std::pair<uint64_t, unsigned int>> keys(cornerCount);
+	for (size_t corner = 0; corner < cornerCount; corner++)
+	{
+		unsigned int a = indices[corner];
+		unsigned int b = indices[corner % 3 == 2 ? corner - 2 : corner + 1];
+		keys[corner] = { (uint64_t)std::min(a, b) << 32 | std::max(a, b), (unsigned int)corner };
+	}
+	std::sort(keys.begin(), keys.end());
+	edges.clear();
+	cornerEdges.assign(cornerCount, 0);
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (i == 0 || keys[i].first != keys[i - 1].first)
+		{
+			edges.push_back({ (unsigned int)(keys[i].first >> 32), (unsigned int)keys[i].first });
+		}
+		cornerEdges[keys[i].second] = (unsigned int)edges.size() - 1;
+	}
+}
+
+// angle between two directions from the eye, zero if either is the eye itself
+float angleBetween(const float *a, const float *b)
+{
+	float cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+	float sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	float cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	return sine == 0.0f && cosine == 0.0f ? 0.0f : std::atan2(sine, cosine);
+}
+
+// for every edge, the furthest its warped midpoint lands from the middle of the straight line
+// between its warped ends, over every eye and both images
+void measureEdges(const BlackHoleWarpTable& table, const TessellationSettings& settings, const TessellationMesh& mesh,
+	const std::vector<Edge>& edges, ThreadPool *pool, std::vector<float>& deviations)
+{
+	size_t vertexCount = mesh.positions.size() / 3;
+	std::vector<float> world[3];
+	for (int k = 0; k < 3; k++)
+	{
+		world[k].resize(vertexCount);
+	}
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		glm::vec3 position = glm::vec3(settings.model * glm::vec4(mesh.positions[3 * vertex], mesh.positions[3 * vertex + 1], mesh.positions[3 * vertex + 2], 1.0f));
+		for (int k = 0; k < 3; k++)
+		{
+			world[k][vertex] = position[k];
+		}
+	}
+
+	deviations.assign(edges.size(), 0.0f);
+	std::vector<float> warped[3];
+	for (int k = 0; k < 3; k++)
+	{
+		warped[k].resize(vertexCount);
+	}
+	for (const glm::vec3& eye : settings.eyes)
+	{
+		for (int image = 0; image < 2; image++)
+		{
+			// a view matrix that only moves the eye to the origin; the warp doesn't care which way it looks
+			BlackHoleWarpFrame frame;
+			for (int k = 0; k < 3; k++)
+			{
+				frame.hole[k] = settings.holePosition[k] - eye[k];
+			}
+			frame.size = settings.holeSize;
+			frame.secondary = image == 1;
+
+			ThreadPool::forEachRange(pool, vertexCount, CHUNK_SIZE, [&](size_t begin, size_t end)
+			{
+				BlackHoleWarpBatch batch;
+				batch.count = end - begin;
+				for (int k = 0; k < 3; k++)
+				{
+					for (size_t vertex = begin; vertex < end; vertex++)
+					{
+						warped[k][vertex] = world[k][vertex] - eye[k];
+					}
+					batch.position[k] = &warped[k][begin];
+					batch.warpedPosition[k] = &warped[k][begin];
+				}
+				BlackHoleWarp::warp(table, frame, batch);
+			});
+
+			ThreadPool::forEachRange(pool, edges.size(), CHUNK_SIZE, [&](size_t begin, size_t end)
+			{
+				float middle[3][CHUNK_SIZE];
+				BlackHoleWarpBatch batch;
+				batch.count = end - begin;
+				for (int k = 0; k < 3; k++)
+				{
+					for (size_t edge = begin; edge < end; edge++)
+					{
+						middle[k][edge - begin] = 0.5f * (world[k][edges[edge].a] + world[k][edges[edge].b]) - eye[k];
+					}
+					batch.position[k] = middle[k];
+					batch.warpedPosition[k] = middle[k];
+				}
+				BlackHoleWarp::warp(table, frame, batch);
+				for (size_t edge = begin; edge < end; edge++)
+				{
+					// where the rasterizer puts the midpoint, on the line between the warped ends
+					float drawn[3];
+					float actual[3];
+					for (int k = 0; k < 3; k++)
+					{
+						drawn[k] = warped[k][edges[edge].a] + warped[k][edges[edge].b];
+						actual[k] = middle[k][edge - begin];
+					}
+					deviations[edge] = std::max(deviations[edge], angleBetween(drawn, actual));
+				}
+			});
+		}
+	}
+}
+
+// appends the midpoint of an edge, normals renormalized
+unsigned int addMidpoint(TessellationMesh& mesh, const Edge& edge)
+{
+	unsigned int index = (unsigned int)(mesh.positions.size() / 3);
+	for (int k = 0; k < 3; k++)
+	{
+		mesh.positions.push_back(0.5f * (mesh.positions[3 * edge.a + k] + mesh.positions[3 * edge.b + k]));
+	}
+	if (!mesh.normals.empty())
+	{
+		glm::vec3 normal(0.0f);
+		for (int k = 0; k < 3; k++)
+		{
+			normal[k] = mesh.normals[3 * edge.a + k] + mesh.normals[3 * edge.b + k];
+		}
+		float length = glm::length(normal);
+		normal = length > 0.0f ? normal / length : glm::vec3(mesh.normals[3 * edge.a], mesh.normals[3 * edge.a + 1], mesh.normals[3 * edge.a + 2]);
+		mesh.normals.insert(mesh.normals.end(), { normal.x, normal.y, normal.z });
+	}
+	if (!mesh.texcoords.empty())
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			mesh.texcoords.push_back(0.5f * (mesh.texcoords[2 * edge.a + k] + mesh.texcoords[2 * edge.b + k]));
+		}
+	}
+	return index;
+}
+
+float distanceSquared(const TessellationMesh& mesh, unsigned int a, unsigned int b)
+{
+	float sum = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		float difference = mesh.positions[3 * a + k] - mesh.positions[3 * b + k];
+		sum += difference * difference;
+	}
+	return sum;
+}
+
+}
+
+namespace AdaptiveTessellation
+{
+
+TessellationError measure(const BlackHoleWarpTable& table, const TessellationSettings& settings, const TessellationMesh& mesh, ThreadPool *pool)
+{
+	std::vector<Edge> edges;
+	std::vector<unsigned int> cornerEdges;
+	std::vector<float> deviations;
+	buildEdges(mesh.indices, edges, cornerEdges);
+	measureEdges(table, settings, mesh, edges, pool, deviations);
+
+	TessellationError error;
+	error.edges = edges.size();
+	for (float deviation : deviations)
+	{
+		error.maxDeviation = std::max(error.maxDeviation, deviation);
+		error.edgesOverTolerance += deviation > settings.tolerance ? 1 : 0;
+	}
+	return error;
+}
+
+TessellationStats tessellate(const BlackHoleWarpTable& table, const TessellationSettings& settings, TessellationMesh& mesh, ThreadPool *pool)
+{
+	TessellationStats stats;
+	stats.inputTriangles = mesh.indices.size() / 3;
+	std::vector<Edge> edges;
+	std::vector<unsigned int> cornerEdges;
+	std::vector<float> deviations;
+	for (int round = 0; round < settings.maxDepth; round++)
+	{
+		buildEdges(mesh.indices, edges, cornerEdges);
+		measureEdges(table, settings, mesh, edges, pool, deviations);
+
+		// each split edge adds one triangle to each triangle it borders
+		size_t splitCount = 0;
+		size_t triangleCount = mesh.indices.size() / 3;
+		for (size_t corner = 0; corner < cornerEdges.size(); corner++)
+		{
+			triangleCount += deviations[cornerEdges[corner]] > settings.tolerance ? 1 : 0;
+		}
+		for (float deviation : deviations)
+		{
+			splitCount += deviation > settings.tolerance ? 1 : 0;
+		}
+		if (splitCount == 0 || triangleCount > settings.maxTriangles)
+		{
+			break;
+		}
+
+		std::vector<unsigned int> midpoints(edges.size(), 0);
+		for (size_t edge = 0; edge < edges.size(); edge++)
+		{
+			if (deviations[edge] > settings.tolerance)
+			{
+				midpoints[edge] = addMidpoint(mesh, edges[edge]);
+			}
+		}
+
+		std::vector<unsigned int> indices;
+		indices.reserve(3 * triangleCount);
+		for (size_t triangle = 0; triangle < cornerEdges.size() / 3; triangle++)
+		{
+			unsigned int v[3];
+			unsigned int m[3];
+			int splits = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				v[k] = mesh.indices[3 * triangle + k];
+				// midpoint of the edge from corner k to corner k + 1, zero if it isn't split
+				m[k] = midpoints[cornerEdges[3 * triangle + k]];
+				splits += m[k] != 0 ? 1 : 0;
+			}
+			if (splits == 0)
+			{
+				indices.insert(indices.end(), { v[0], v[1], v[2] });
+			}
+			else if (splits == 3)
+			{
+				indices.insert(indices.end(), { v[0], m[0], m[2], m[0], v[1], m[1], m[2], m[1], v[2], m[0], m[1], m[2] });
+			}
+			else
+			{
+				// turn the triangle so its first edge is split and, with two splits, its last one isn't
+				int r = 0;
+				while (m[r] == 0 || (splits == 2 && m[(r + 2) % 3] != 0))
+				{
+					r++;
+				}
+				unsigned int a = v[r], b = v[(r + 1) % 3], c = v[(r + 2) % 3];
+				unsigned int ab = m[r], bc = m[(r + 1) % 3];
+				if (splits == 1)
+				{
+					indices.insert(indices.end(), { a, ab, c, ab, b, c });
+				}
+				else
+				{
+					indices.insert(indices.end(), { ab, b, bc });
+					// the rest is a quad, cut along its shorter diagonal
+					if (distanceSquared(mesh, a, bc) < distanceSquared(mesh, ab, c))
+					{
+						indices.insert(indices.end(), { a, ab, bc, a, bc, c });
+					}
+					else
+					{
+						indices.insert(indices.end(), { a, ab, c, ab, bc, c });
+					}
+				}
+			}
+		}
+		mesh.indices = std::move(indices);
+		stats.rounds++;
+		stats.splitEdges += splitCount;
+	}
+	stats.outputTriangles = mesh.indices.size() / 3;
+	return stats;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef _ADAPTIVE_TESSELLATION_H_
+#define _ADAPTIVE_TESSELLATION_H_
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "BlackHoleWarp.h"
+
+class ThreadPool;
+
+// Subdivides a mesh only where the black hole bends it. The rasterizer joins
+// warped vertices with straight lines, so an edge whose warped midpoint lands
+// away from the middle of the line between its warped ends draws in the wrong
+// place. Those edges are split (red-green, so neighbours never end up with
+// T-junctions) and the new edges checked again, until every edge is within
+// tolerance from every eye or maxDepth rounds have gone by. Edges far from the
+// hole barely bend and stay as coarse as they came in.
+
+// an indexed triangle list as tinyobj loads it, normals and texcoords are optional
+struct TessellationMesh
+{
+	// xyz per vertex, in model space
+	std::vector<float> positions;
+	// xyz per vertex, or empty
+	std::vector<float> normals;
+	// uv per vertex, or empty
+	std::vector<float> texcoords;
+	std::vector<unsigned int> indices;
+};
+
+struct TessellationSettings
+{
+	// where the camera may be, in world space; the warp only depends on the eye's
+	// position, not on where it looks
+	std::vector<glm::vec3> eyes;
+	// model to world, like the object's transform in the scene
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec3 holePosition = glm::vec3(0.0f);
+	float holeSize = 1.0f;
+	// how far an edge's midpoint may be drawn from where it belongs, in radians seen from the eye
+	float tolerance = 0.002f;
+	int maxDepth = 6;
+	// stops splitting before the mesh grows past this
+	size_t maxTriangles = 1 << 24;
+};
+
+// the worst edge of a mesh over every eye and both images
+struct TessellationError
+{
+	float maxDeviation = 0.0f;
+	size_t edges = 0;
+	size_t edgesOverTolerance = 0;
+};
+
+struct TessellationStats
+{
+	int rounds = 0;
+	size_t splitEdges = 0;
+	size_t inputTriangles = 0;
+	size_t outputTriangles = 0;
+};
+
+namespace AdaptiveTessellation
+{
+	// how far each edge of mesh strays; pool may be null
+	TessellationError measure(const BlackHoleWarpTable& table, const TessellationSettings& settings, const TessellationMesh& mesh,
+		ThreadPool *pool = nullptr);
+	// splits mesh in place until it is within tolerance
+	TessellationStats tessellate(const BlackHoleWarpTable& table, const TessellationSettings& settings, TessellationMesh& mesh,
+		ThreadPool *pool = nullptr);
+}
+
+#endif
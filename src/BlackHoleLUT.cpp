@@ -0,0 +1,740 @@
+#include "BlackHoleLUT.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+
+namespace BlackHoleLUT
+{
+
+static std::array<uint32_t, 256> makeCrcTable()
+{
+	std::array<uint32_t, 256> table;
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t value = i;
+		for (int bit = 0; bit < 8; bit++)
+		{
+			value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+		}
+		table[i] = value;
+	}
+	return table;
+}
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc)
+{
+	static const std::array<uint32_t, 256> table = makeCrcTable();
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+size_t getElementSize(uint32_t elementType)
+{
+	switch (elementType)
+	{
+	case BLACK_HOLE_LUT_FLOAT32:
+		return BLACK_HOLE_LUT_CHANNELS * sizeof(float);
+	case BLACK_HOLE_LUT_FLOAT16:
+	case BLACK_HOLE_LUT_UNORM16:
+		return BLACK_HOLE_LUT_CHANNELS * sizeof(uint16_t);
+	default:
+		return 0;
+	}
+}
+
+const char* getElementTypeName(uint32_t elementType)
+{
+	switch (elementType)
+	{
+	case BLACK_HOLE_LUT_FLOAT32:
+		return "float32";
+	case BLACK_HOLE_LUT_FLOAT16:
+		return "float16";
+	case BLACK_HOLE_LUT_UNORM16:
+		return "unorm16";
+	default:
+		return "unknown";
+	}
+}
+
+const char* getWarpName(uint32_t warp)
+{
+	switch (warp)
+	{
+	case BLACK_HOLE_LUT_WARP_LINEAR:
+		return "linear";
+	case BLACK_HOLE_LUT_WARP_LOG:
+		return "log";
+	case BLACK_HOLE_LUT_WARP_SINH:
+		return "sinh";
+	default:
+		return "unknown";
+	}
+}
+
+double warpAxis(uint32_t warp, double parameter, double value, double min, double max)
+{
+	value = std::min(std::max(value, min), max);
+	switch (warp)
+	{
+	case BLACK_HOLE_LUT_WARP_LOG:
+		return std::log((value - parameter) / (min - parameter)) / std::log((max - parameter) / (min - parameter));
+	case BLACK_HOLE_LUT_WARP_SINH:
+	{
+		double middle = 0.5 * (min + max);
+		double half = 0.5 * (max - min);
+		return 0.5 + std::asinh((value - middle) / half * std::sinh(parameter)) / (2.0 * parameter);
+	}
+	default:
+		return (value - min) / (max - min);
+	}
+}
+
+double unwarpAxis(uint32_t warp, double parameter, double t, double min, double max)
+{
+	// keep the ends exact so the first and last texels sit on the range bounds
+	if (t <= 0.0)
+	{
+		return min;
+	}
+	if (t >= 1.0)
+	{
+		return max;
+	}
+	switch (warp)
+	{
+	case BLACK_HOLE_LUT_WARP_LOG:
+		return parameter + (min - parameter) * std::pow((max - parameter) / (min - parameter), t);
+	case BLACK_HOLE_LUT_WARP_SINH:
+	{
+		double middle = 0.5 * (min + max);
+		double half = 0.5 * (max - min);
+		return middle + half * std::sinh(parameter * (2.0 * t - 1.0)) / std::sinh(parameter);
+	}
+	default:
+		return min + (max - min) * t;
+	}
+}
+
+// texel on one axis to the left of the coordinate and how far towards the next one it is
+static void locate(double t, uint32_t resolution, uint32_t& index, double& fraction)
+{
+	double position = t * (resolution - 1);
+	index = (uint32_t)std::min<double>(std::max(std::floor(position), 0.0), resolution > 1 ? resolution - 2 : 0);
+	fraction = resolution > 1 ? std::min(std::max(position - index, 0.0), 1.0) : 0.0;
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent == 0xff)
+	{
+		return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+	int halfExponent = (int)exponent - 127 + 15;
+	if (halfExponent >= 0x1f)
+	{
+		return (uint16_t)(sign | 0x7c00);
+	}
+	if (halfExponent <= 0)
+	{
+		// subnormal, or too small for a half at all
+		if (halfExponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	// round to nearest even, a carry into the exponent is still correct
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return (uint16_t)(sign | half);
+}
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		// subnormal half, normal as a float
+		int shift = 0;
+		while (!(mantissa & 0x400))
+		{
+			mantissa <<= 1;
+			shift++;
+		}
+		bits = sign | ((uint32_t)(127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void decodeTexel(const BlackHoleLUTHeader& header, const void* texels, size_t index, float* value)
+{
+	switch (header.elementType)
+	{
+	case BLACK_HOLE_LUT_FLOAT16:
+	{
+		const uint16_t* texel = static_cast<const uint16_t*>(texels) + index * BLACK_HOLE_LUT_CHANNELS;
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			value[channel] = halfToFloat(texel[channel]) * header.channelScale[channel] + header.channelOffset[channel];
+		}
+		break;
+	}
+	case BLACK_HOLE_LUT_UNORM16:
+	{
+		const uint16_t* texel = static_cast<const uint16_t*>(texels) + index * BLACK_HOLE_LUT_CHANNELS;
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			value[channel] = texel[channel] / 65535.0f * header.channelScale[channel] + header.channelOffset[channel];
+		}
+		break;
+	}
+	default:
+		std::memcpy(value, static_cast<const float*>(texels) + index * BLACK_HOLE_LUT_CHANNELS, BLACK_HOLE_LUT_CHANNELS * sizeof(float));
+		break;
+	}
+}
+
+std::vector<unsigned char> quantize(const BlackHoleLUTHeader& header, const float* values, uint32_t elementType,
+	BlackHoleLUTHeader& quantizedHeader)
+{
+	size_t count = getTexelCount(header) * BLACK_HOLE_LUT_CHANNELS;
+	quantizedHeader = header;
+	quantizedHeader.elementType = elementType;
+	quantizedHeader.version = BLACK_HOLE_LUT_VERSION;
+	std::vector<unsigned char> payload(getTexelCount(header) * getElementSize(elementType));
+
+	if (elementType == BLACK_HOLE_LUT_FLOAT32)
+	{
+		std::memcpy(payload.data(), values, payload.size());
+		return payload;
+	}
+
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		float low = values[channel];
+		float high = values[channel];
+		for (size_t i = channel; i < count; i += BLACK_HOLE_LUT_CHANNELS)
+		{
+			low = std::min(low, values[i]);
+			high = std::max(high, values[i]);
+		}
+		// halves keep their own exponent so they are stored as they are
+		bool unorm = elementType == BLACK_HOLE_LUT_UNORM16;
+		quantizedHeader.channelScale[channel] = unorm ? std::max(high - low, 1e-30f) : 1.0f;
+		quantizedHeader.channelOffset[channel] = unorm ? low : 0.0f;
+	}
+
+	uint16_t* encoded = reinterpret_cast<uint16_t*>(payload.data());
+	for (size_t i = 0; i < count; i++)
+	{
+		int channel = (int)(i % BLACK_HOLE_LUT_CHANNELS);
+		if (elementType == BLACK_HOLE_LUT_UNORM16)
+		{
+			float normalized = (values[i] - quantizedHeader.channelOffset[channel]) / quantizedHeader.channelScale[channel];
+			encoded[i] = (uint16_t)std::lround(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f);
+		}
+		else
+		{
+			encoded[i] = floatToHalf(values[i]);
+		}
+	}
+	return payload;
+}
+
+void sample(const BlackHoleLUTHeader& header, const void* texels,
+	double vertexR, double vertexPhi, double observerR, float* value)
+{
+	const double twoPi = 6.28318530717958647692;
+	uint32_t index[3];
+	double fraction[3];
+	locate(warpAxis(header.vrWarp, header.vrWarpParameter, vertexR, header.vrMin, header.vrMax), header.vrResolution, index[0], fraction[0]);
+	locate(warpAxis(header.vPhiWarp, header.vPhiWarpParameter, vertexPhi, 0.0, twoPi), header.vPhiResolution, index[1], fraction[1]);
+	locate(warpAxis(header.orWarp, header.orWarpParameter, observerR, header.orMin, header.orMax), header.orResolution, index[2], fraction[2]);
+
+	uint32_t extents[3] = { header.vrResolution, header.vPhiResolution, header.orResolution };
+	double sum[BLACK_HOLE_LUT_CHANNELS] = {};
+	for (int corner = 0; corner < 8; corner++)
+	{
+		double weight = 1.0;
+		size_t cornerIndex[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bool upper = (corner >> axis) & 1;
+			weight *= upper ? fraction[axis] : 1.0 - fraction[axis];
+			cornerIndex[axis] = std::min(index[axis] + (upper ? 1 : 0), extents[axis] - 1);
+		}
+		float decoded[BLACK_HOLE_LUT_CHANNELS];
+		decodeTexel(header, texels, getTexelIndex(header, cornerIndex[0], cornerIndex[1], cornerIndex[2]), decoded);
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			sum[channel] += weight * decoded[channel];
+		}
+	}
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		value[channel] = (float)sum[channel];
+	}
+}
+
+// parameters that would put a NaN into the shader
+static bool validateWarp(uint32_t warp, float parameter, float min, const char* axis, std::string& error)
+{
+	bool valid = warp == BLACK_HOLE_LUT_WARP_LINEAR
+		|| (warp == BLACK_HOLE_LUT_WARP_LOG && parameter < min)
+		|| (warp == BLACK_HOLE_LUT_WARP_SINH && parameter > 0.0f);
+	if (!valid)
+	{
+		error = std::string("invalid ") + axis + " warp " + getWarpName(warp) + " (" + std::to_string(parameter) + ")";
+	}
+	return valid;
+}
+
+BlackHoleLUTHeader makeHeader(int vrResolution, int vPhiResolution, int orResolution,
+	float vrMin, float vrMax, float orMin, float orMax, uint32_t elementType)
+{
+	BlackHoleLUTHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, BLACK_HOLE_LUT_MAGIC, sizeof(header.magic));
+	header.version = BLACK_HOLE_LUT_VERSION;
+	header.headerSize = sizeof(BlackHoleLUTHeader);
+	header.vrResolution = vrResolution;
+	header.vPhiResolution = vPhiResolution;
+	header.orResolution = orResolution;
+	header.elementType = elementType;
+	header.vrMin = vrMin;
+	header.vrMax = vrMax;
+	header.orMin = orMin;
+	header.orMax = orMax;
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		header.channelScale[channel] = 1.0f;
+	}
+	return header;
+}
+
+bool validateHeader(const BlackHoleLUTHeader& header, size_t fileSize, std::string& error)
+{
+	if (std::memcmp(header.magic, BLACK_HOLE_LUT_MAGIC, sizeof(header.magic)) != 0)
+	{
+		error = "not a black hole table";
+		return false;
+	}
+	if (header.version == 0 || header.version > BLACK_HOLE_LUT_VERSION)
+	{
+		error = "unsupported version " + std::to_string(header.version);
+		return false;
+	}
+	if (header.headerSize < sizeof(BlackHoleLUTHeader))
+	{
+		error = "truncated header";
+		return false;
+	}
+	size_t elementSize = getElementSize(header.elementType);
+	if (elementSize == 0)
+	{
+		error = "unknown element type " + std::to_string(header.elementType);
+		return false;
+	}
+	if (header.elementType != BLACK_HOLE_LUT_FLOAT32)
+	{
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			if (!(header.channelScale[channel] > 0.0f) || !std::isfinite(header.channelScale[channel])
+				|| !std::isfinite(header.channelOffset[channel]))
+			{
+				error = "invalid channel scale or offset";
+				return false;
+			}
+		}
+	}
+	if (header.vrResolution == 0 || header.vPhiResolution == 0 || header.orResolution == 0)
+	{
+		error = "empty table";
+		return false;
+	}
+	if (!validateWarp(header.vrWarp, header.vrWarpParameter, header.vrMin, "vr", error)
+		|| !validateWarp(header.vPhiWarp, header.vPhiWarpParameter, 0.0f, "vPhi", error)
+		|| !validateWarp(header.orWarp, header.orWarpParameter, header.orMin, "or", error))
+	{
+		return false;
+	}
+	uint64_t expectedSize = (uint64_t)header.vrResolution * header.vPhiResolution * header.orResolution * elementSize;
+	if (header.dataSize != expectedSize)
+	{
+		error = "payload size does not match resolution";
+		return false;
+	}
+	if (header.dataOffset < header.headerSize || header.dataOffset % sizeof(float) != 0
+		|| header.dataOffset + header.dataSize > fileSize)
+	{
+		error = "payload out of bounds";
+		return false;
+	}
+	return true;
+}
+
+static bool hasMagic(const std::string& path, const char* expected)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[sizeof(BLACK_HOLE_LUT_MAGIC)];
+	if (!file.read(magic, sizeof(magic)))
+	{
+		return false;
+	}
+	return std::memcmp(magic, expected, sizeof(magic)) == 0;
+}
+
+bool isBinaryFile(const std::string& path)
+{
+	return hasMagic(path, BLACK_HOLE_LUT_MAGIC);
+}
+
+bool isPackFile(const std::string& path)
+{
+	return hasMagic(path, BLACK_HOLE_LUT_PACK_MAGIC);
+}
+
+size_t getTexelCount(const BlackHoleLUTHeader& header)
+{
+	return (size_t)header.vrResolution * header.vPhiResolution * header.orResolution;
+}
+
+bool readPack(const unsigned char* data, size_t size, std::vector<BlackHoleLUTPackEntry>& entries,
+	std::vector<BlackHoleLUTHeader>& headers, std::string& error)
+{
+	BlackHoleLUTPackHeader pack;
+	if (size < sizeof(pack))
+	{
+		error = "truncated pack header";
+		return false;
+	}
+	std::memcpy(&pack, data, sizeof(pack));
+	if (std::memcmp(pack.magic, BLACK_HOLE_LUT_PACK_MAGIC, sizeof(pack.magic)) != 0)
+	{
+		error = "not a black hole table pack";
+		return false;
+	}
+	if (pack.version == 0 || pack.version > BLACK_HOLE_LUT_PACK_VERSION)
+	{
+		error = "unsupported pack version " + std::to_string(pack.version);
+		return false;
+	}
+	if (pack.levelCount == 0 || (size - sizeof(pack)) / sizeof(BlackHoleLUTPackEntry) < pack.levelCount)
+	{
+		error = "bad level count " + std::to_string(pack.levelCount);
+		return false;
+	}
+
+	entries.resize(pack.levelCount);
+	headers.resize(pack.levelCount);
+	std::memcpy(entries.data(), data + sizeof(pack), entries.size() * sizeof(BlackHoleLUTPackEntry));
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const BlackHoleLUTPackEntry& entry = entries[i];
+		if (entry.offset % BLACK_HOLE_LUT_ALIGNMENT != 0 || entry.offset > size || entry.size > size - entry.offset
+			|| entry.size < sizeof(BlackHoleLUTHeader))
+		{
+			error = "level " + std::to_string(i) + " out of bounds";
+			return false;
+		}
+		std::memcpy(&headers[i], data + entry.offset, sizeof(BlackHoleLUTHeader));
+		if (!validateHeader(headers[i], (size_t)entry.size, error))
+		{
+			error = "level " + std::to_string(i) + ": " + error;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Pulls whitespace separated numbers out of a file in fixed size chunks, so
+// parsing a large table never holds more than one chunk of text at a time.
+class NumberReader
+{
+public:
+	NumberReader(std::ifstream& file) : file(file), buffer(1 << 16), begin(0), end(0) {}
+
+	bool nextToken(std::string& token)
+	{
+		token.clear();
+		while (true)
+		{
+			if (begin == end && !refill())
+			{
+				return !token.empty();
+			}
+			while (begin < end && std::isspace((unsigned char)buffer[begin]))
+			{
+				if (!token.empty())
+				{
+					return true;
+				}
+				begin++;
+			}
+			while (begin < end && !std::isspace((unsigned char)buffer[begin]))
+			{
+				token.push_back(buffer[begin++]);
+			}
+		}
+	}
+
+	bool next(long& value)
+	{
+		char* parsedEnd = nullptr;
+		if (!nextToken(token))
+		{
+			return false;
+		}
+		value = std::strtol(token.c_str(), &parsedEnd, 10);
+		return *parsedEnd == '\0';
+	}
+
+	bool next(float& value)
+	{
+		char* parsedEnd = nullptr;
+		if (!nextToken(token))
+		{
+			return false;
+		}
+		value = std::strtof(token.c_str(), &parsedEnd);
+		return *parsedEnd == '\0';
+	}
+
+private:
+	bool refill()
+	{
+		file.read(buffer.data(), buffer.size());
+		begin = 0;
+		end = (size_t)file.gcount();
+		return end > 0;
+	}
+
+	std::ifstream& file;
+	std::vector<char> buffer;
+	std::string token;
+	size_t begin;
+	size_t end;
+};
+
+bool readText(const std::string& path, BlackHoleLUTHeader& header, std::vector<float>& values)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open black hole file: " << path << std::endl;
+		return false;
+	}
+	NumberReader reader(file);
+
+	long resolutions[3];
+	for (auto& resolution : resolutions)
+	{
+		if (!reader.next(resolution) || resolution <= 0)
+		{
+			std::cerr << "Malformed black hole header: " << path << std::endl;
+			return false;
+		}
+	}
+
+	float ranges[4];
+	for (auto& range : ranges)
+	{
+		if (!reader.next(range))
+		{
+			std::cerr << "Malformed black hole header: " << path << std::endl;
+			return false;
+		}
+	}
+
+	header = makeHeader(resolutions[0], resolutions[1], resolutions[2], ranges[0], ranges[1], ranges[2], ranges[3]);
+
+	size_t totalSize = (size_t)resolutions[0] * resolutions[1] * resolutions[2] * BLACK_HOLE_LUT_CHANNELS;
+	values.resize(totalSize);
+	for (size_t i = 0; i < totalSize; i++)
+	{
+		if (!reader.next(values[i]))
+		{
+			std::cerr << "Black hole file ended after " << i << " of " << totalSize << " values: " << path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<unsigned char> serialize(BlackHoleLUTHeader header, const void* texels)
+{
+	header.dataSize = (uint64_t)getTexelCount(header) * getElementSize(header.elementType);
+	header.dataOffset = (header.headerSize + BLACK_HOLE_LUT_ALIGNMENT - 1) / BLACK_HOLE_LUT_ALIGNMENT * BLACK_HOLE_LUT_ALIGNMENT;
+	header.checksum = crc32(texels, (size_t)header.dataSize);
+
+	std::vector<unsigned char> image((size_t)(header.dataOffset + header.dataSize), 0);
+	std::memcpy(image.data(), &header, sizeof(header));
+	std::memcpy(image.data() + header.dataOffset, texels, (size_t)header.dataSize);
+	return image;
+}
+
+static bool writeFile(const std::string& path, const std::vector<std::vector<unsigned char>>& parts)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Failed to open black hole file for writing: " << path << std::endl;
+		return false;
+	}
+	for (const auto& part : parts)
+	{
+		file.write(reinterpret_cast<const char*>(part.data()), (std::streamsize)part.size());
+	}
+	if (!file)
+	{
+		std::cerr << "Failed to write black hole file: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool write(const std::string& path, BlackHoleLUTHeader header, const void* texels)
+{
+	return writeFile(path, { serialize(header, texels) });
+}
+
+// shortest digits that read back as the same float
+static void writeFloat(std::ostream& stream, float value)
+{
+	char text[32];
+	for (int precision = 6; precision <= 9; precision++)
+	{
+		snprintf(text, sizeof(text), "%.*g", precision, value);
+		if (std::strtof(text, nullptr) == value)
+		{
+			break;
+		}
+	}
+	stream << text;
+}
+
+bool writeText(const std::string& path, const BlackHoleLUTHeader& header, const float* values)
+{
+	if (header.vrWarp != BLACK_HOLE_LUT_WARP_LINEAR || header.vPhiWarp != BLACK_HOLE_LUT_WARP_LINEAR || header.orWarp != BLACK_HOLE_LUT_WARP_LINEAR)
+	{
+		std::cerr << "Text black hole files can't hold warped axes: " << path << std::endl;
+		return false;
+	}
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Failed to open black hole file for writing: " << path << std::endl;
+		return false;
+	}
+	file << header.vrResolution << " " << header.vPhiResolution << " " << header.orResolution << "\n";
+	const float ranges[4] = { header.vrMin, header.vrMax, header.orMin, header.orMax };
+	for (int i = 0; i < 4; i++)
+	{
+		writeFloat(file, ranges[i]);
+		file << (i % 2 == 0 ? " " : "\n");
+	}
+	size_t count = getTexelCount(header) * BLACK_HOLE_LUT_CHANNELS;
+	for (size_t i = 0; i < count; i++)
+	{
+		writeFloat(file, values[i]);
+		file << (i % BLACK_HOLE_LUT_CHANNELS == BLACK_HOLE_LUT_CHANNELS - 1 ? "\n" : " ");
+	}
+	if (!file)
+	{
+		std::cerr << "Failed to write black hole file: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool writePack(const std::string& path, std::vector<std::vector<unsigned char>> levels)
+{
+	auto texelCount = [](const std::vector<unsigned char>& image)
+	{
+		BlackHoleLUTHeader header;
+		std::memcpy(&header, image.data(), sizeof(header));
+		return getTexelCount(header);
+	};
+	std::stable_sort(levels.begin(), levels.end(), [&](const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+	{
+		return texelCount(a) < texelCount(b);
+	});
+
+	BlackHoleLUTPackHeader header;
+	std::memcpy(header.magic, BLACK_HOLE_LUT_PACK_MAGIC, sizeof(header.magic));
+	header.version = BLACK_HOLE_LUT_PACK_VERSION;
+	header.levelCount = (uint32_t)levels.size();
+
+	// directory first, then every level starting on an aligned offset
+	std::vector<std::vector<unsigned char>> parts(1);
+	uint64_t offset = sizeof(header) + levels.size() * sizeof(BlackHoleLUTPackEntry);
+	std::vector<BlackHoleLUTPackEntry> entries;
+	for (auto& level : levels)
+	{
+		uint64_t aligned = (offset + BLACK_HOLE_LUT_ALIGNMENT - 1) / BLACK_HOLE_LUT_ALIGNMENT * BLACK_HOLE_LUT_ALIGNMENT;
+		parts.push_back(std::vector<unsigned char>((size_t)(aligned - offset), 0));
+		entries.push_back({ aligned, (uint64_t)level.size() });
+		parts.push_back(std::move(level));
+		offset = aligned + entries.back().size;
+	}
+
+	parts[0].resize(sizeof(header) + entries.size() * sizeof(BlackHoleLUTPackEntry));
+	std::memcpy(parts[0].data(), &header, sizeof(header));
+	if (!entries.empty())
+	{
+		std::memcpy(parts[0].data() + sizeof(header), entries.data(), entries.size() * sizeof(BlackHoleLUTPackEntry));
+	}
+	return writeFile(path, parts);
+}
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef _BLACK_HOLE_LUT_H_
+#define _BLACK_HOLE_LUT_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Binary black hole table (.bhlut). A fixed size little-endian header is
+// followed by the texel payload at dataOffset. Texels are stored with the
+// observer radius varying fastest, then vertex phi, then vertex radius, which
+// is exactly what glTexImage3D expects for the (or, vPhi, vr) texture, so a
+// mapped file can be uploaded without touching the data. BlackHoleLUT::getTexelIndex
+// is the one place that order is written down.
+//
+// Each axis can be warped so texels bunch up where the table changes fastest.
+// A texture coordinate t in [0, 1] maps to a value on the axis through
+// BlackHoleLUT::unwarpAxis, and back through warpAxis. The vertex shader's
+// copy of warpAxis must stay in sync with the one here.
+constexpr char BLACK_HOLE_LUT_MAGIC[8] = { 'B', 'H', 'L', 'U', 'T', '\0', '\r', '\n' };
+constexpr uint32_t BLACK_HOLE_LUT_VERSION = 3;
+constexpr uint32_t BLACK_HOLE_LUT_ALIGNMENT = 64;
+constexpr int BLACK_HOLE_LUT_CHANNELS = 3;
+
+// 16 bit types are decoded as stored * channelScale + channelOffset
+enum BlackHoleLUTElementType : uint32_t
+{
+	BLACK_HOLE_LUT_FLOAT32 = 0,
+	// added in version 3
+	BLACK_HOLE_LUT_FLOAT16 = 1,
+	// stored / 65535, so each channel's range is spread over the full 16 bits
+	BLACK_HOLE_LUT_UNORM16 = 2,
+};
+
+enum BlackHoleLUTWarp : uint32_t
+{
+	// evenly spaced, what version 1 tables always were
+	BLACK_HOLE_LUT_WARP_LINEAR = 0,
+	// evenly spaced in log(x - parameter), parameter must be below the axis minimum
+	BLACK_HOLE_LUT_WARP_LOG = 1,
+	// packed towards the middle of the axis, denser as the parameter grows
+	BLACK_HOLE_LUT_WARP_SINH = 2,
+};
+
+struct BlackHoleLUTHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t vrResolution;
+	uint32_t vPhiResolution;
+	uint32_t orResolution;
+	uint32_t elementType;
+	float vrMin, vrMax;
+	float orMin, orMax;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+	// CRC-32 of the payload
+	uint32_t checksum;
+	// BlackHoleLUTWarp per axis, added in version 2
+	uint32_t vrWarp, vPhiWarp, orWarp;
+	float vrWarpParameter, vPhiWarpParameter, orWarpParameter;
+	// per channel decode for the 16 bit element types, added in version 3
+	float channelScale[3];
+	float channelOffset[3];
+	// zeroed; later versions may only add fields whose zero value keeps the old meaning
+	uint32_t reserved[3];
+};
+
+static_assert(sizeof(BlackHoleLUTHeader) == 128, "BlackHoleLUTHeader layout changed");
+
+// A pack (.bhlut as well, told apart by its magic) bundles several tables of
+// increasing resolution so the application can pick one at runtime. The pack
+// header is followed by one entry per level, coarsest first, and each entry
+// points at a complete table image (header, padding and payload) whose
+// dataOffset is relative to the start of that image.
+constexpr char BLACK_HOLE_LUT_PACK_MAGIC[8] = { 'B', 'H', 'L', 'U', 'T', 'P', '\r', '\n' };
+constexpr uint32_t BLACK_HOLE_LUT_PACK_VERSION = 1;
+
+struct BlackHoleLUTPackHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t levelCount;
+};
+
+struct BlackHoleLUTPackEntry
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+static_assert(sizeof(BlackHoleLUTPackHeader) == 16, "BlackHoleLUTPackHeader layout changed");
+static_assert(sizeof(BlackHoleLUTPackEntry) == 16, "BlackHoleLUTPackEntry layout changed");
+
+namespace BlackHoleLUT
+{
+	uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+	size_t getElementSize(uint32_t elementType);
+	const char* getElementTypeName(uint32_t elementType);
+	const char* getWarpName(uint32_t warp);
+	// value on [min, max] to a texture coordinate on [0, 1], clamping at the ends
+	double warpAxis(uint32_t warp, double parameter, double value, double min, double max);
+	// texture coordinate on [0, 1] back to the value on [min, max]
+	double unwarpAxis(uint32_t warp, double parameter, double t, double min, double max);
+	// trilinear lookup of a table the way the vertex shader samples it,
+	// radii in units of the black hole size and vertex phi in radians
+	void sample(const BlackHoleLUTHeader& header, const void* texels,
+		double vertexR, double vertexPhi, double observerR, float* value);
+	BlackHoleLUTHeader makeHeader(int vrResolution, int vPhiResolution, int orResolution,
+		float vrMin, float vrMax, float orMin, float orMax, uint32_t elementType = BLACK_HOLE_LUT_FLOAT32);
+	// checks the header against the size of the file it came from
+	bool validateHeader(const BlackHoleLUTHeader& header, size_t fileSize, std::string& error);
+	bool isBinaryFile(const std::string& path);
+	bool isPackFile(const std::string& path);
+	size_t getTexelCount(const BlackHoleLUTHeader& header);
+	inline size_t getTexelIndex(const BlackHoleLUTHeader& header, size_t vr, size_t vPhi, size_t orIndex)
+	{
+		return (vr * header.vPhiResolution + vPhi) * header.orResolution + orIndex;
+	}
+	uint16_t floatToHalf(float value);
+	float halfToFloat(uint16_t value);
+	// decoded channels of one texel in any element type
+	void decodeTexel(const BlackHoleLUTHeader& header, const void* texels, size_t index, float* value);
+	// re-encodes a float32 table, picking the scale and offset for unorm16 from each channel's range
+	std::vector<unsigned char> quantize(const BlackHoleLUTHeader& header, const float* values, uint32_t elementType,
+		BlackHoleLUTHeader& quantizedHeader);
+	// validates the pack directory and every level header, payload checksums are left to the caller
+	bool readPack(const unsigned char* data, size_t size, std::vector<BlackHoleLUTPackEntry>& entries,
+		std::vector<BlackHoleLUTHeader>& headers, std::string& error);
+	// reads the whitespace separated format written by black_hole_grid_calculator.py
+	bool readText(const std::string& path, BlackHoleLUTHeader& header, std::vector<float>& values);
+	// complete table image with dataOffset, dataSize and checksum filled in
+	std::vector<unsigned char> serialize(BlackHoleLUTHeader header, const void* texels);
+	bool write(const std::string& path, BlackHoleLUTHeader header, const void* texels);
+	// the format readText reads, float32 values and linear axes only
+	bool writeText(const std::string& path, const BlackHoleLUTHeader& header, const float* values);
+	// table images in any order, they are stored coarsest first
+	bool writePack(const std::string& path, std::vector<std::vector<unsigned char>> levels);
+}
+
+#endif
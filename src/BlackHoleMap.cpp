@@ -0,0 +1,293 @@
+#include "BlackHoleMap.h"
+#include <iostream>
+#include <cstring>
+
+BlackHoleMap::BlackHoleMap() :
+	position(glm::vec3(0.0)),
+	size(0.0f),
+	vrResolution(0),
+	vrMin(0.0f),
+	vrMax(0.0f),
+	vPhiResolution(0),
+	orResolution(0),
+	orMin(0.0f),
+	orMax(0.0f),
+	vrWarp(BLACK_HOLE_LUT_WARP_LINEAR),
+	vPhiWarp(BLACK_HOLE_LUT_WARP_LINEAR),
+	orWarp(BLACK_HOLE_LUT_WARP_LINEAR),
+	vrWarpParameter(0.0f),
+	vPhiWarpParameter(0.0f),
+	orWarpParameter(0.0f),
+	elementType(BLACK_HOLE_LUT_FLOAT32),
+	channelScale(glm::vec3(1.0f)),
+	channelOffset(glm::vec3(0.0f)),
+	data(nullptr),
+	textureID(0),
+	textureUnit(0),
+	targetLevel(0),
+	currentLevel(-1)
+{
+}
+
+BlackHoleMap::~BlackHoleMap()
+{
+}
+
+bool BlackHoleMap::loadFromFile(std::string path)
+{
+	data = nullptr;
+	mappedFile.close();
+	textData.clear();
+	levels.clear();
+	currentLevel = -1;
+
+	bool binary = BlackHoleLUT::isBinaryFile(path) || BlackHoleLUT::isPackFile(path);
+	if (!(binary ? loadBinary(path) : loadText(path)) || !setLevel(0))
+	{
+		levels.clear();
+		mappedFile.close();
+		textData.clear();
+		return false;
+	}
+	targetLevel = (int)levels.size() - 1;
+	return true;
+}
+
+bool BlackHoleMap::loadBinary(const std::string& path)
+{
+	if (!mappedFile.open(path))
+	{
+		std::cerr << "Failed to open black hole file: " << path << std::endl;
+		return false;
+	}
+
+	std::string error;
+	std::vector<BlackHoleLUTPackEntry> entries;
+	std::vector<BlackHoleLUTHeader> headers;
+	bool isPack = mappedFile.getSize() >= sizeof(BLACK_HOLE_LUT_PACK_MAGIC)
+		&& std::memcmp(mappedFile.getData(), BLACK_HOLE_LUT_PACK_MAGIC, sizeof(BLACK_HOLE_LUT_PACK_MAGIC)) == 0;
+	if (isPack)
+	{
+		if (!BlackHoleLUT::readPack(mappedFile.getData(), mappedFile.getSize(), entries, headers, error))
+		{
+			std::cerr << "Invalid black hole pack " << path << ": " << error << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		// a plain table is a pack with one level that starts at the top of the file
+		BlackHoleLUTHeader header;
+		if (mappedFile.getSize() < sizeof(header))
+		{
+			std::cerr << "Black hole file is truncated: " << path << std::endl;
+			return false;
+		}
+		std::memcpy(&header, mappedFile.getData(), sizeof(header));
+		if (!BlackHoleLUT::validateHeader(header, mappedFile.getSize(), error))
+		{
+			std::cerr << "Invalid black hole file " << path << ": " << error << std::endl;
+			return false;
+		}
+		entries.push_back({ 0, mappedFile.getSize() });
+		headers.push_back(header);
+	}
+
+	for (size_t i = 0; i < headers.size(); i++)
+	{
+		levels.push_back({ headers[i], mappedFile.getData() + entries[i].offset + headers[i].dataOffset, false });
+	}
+	return true;
+}
+
+bool BlackHoleMap::loadText(const std::string& path)
+{
+	BlackHoleLUTHeader header;
+	if (!BlackHoleLUT::readText(path, header, textData))
+	{
+		textData.clear();
+		return false;
+	}
+
+	levels.push_back({ header, reinterpret_cast<const unsigned char*>(textData.data()), true });
+	return true;
+}
+
+size_t BlackHoleMap::getTextureBytes(int level) const
+{
+	// uploaded in the same format the file stores
+	const BlackHoleLUTHeader& header = levels[level].header;
+	return BlackHoleLUT::getTexelCount(header) * BlackHoleLUT::getElementSize(header.elementType);
+}
+
+int BlackHoleMap::selectLevel(const BlackHoleBudget& budget) const
+{
+	for (int level = (int)levels.size() - 1; level > 0; level--)
+	{
+		bool fitsMemory = budget.textureBytes == 0 || getTextureBytes(level) <= budget.textureBytes;
+		bool fitsVertices = budget.verticesPerFrame == 0
+			|| BlackHoleLUT::getTexelCount(levels[level].header) <= budget.verticesPerFrame * budget.texelsPerVertex;
+		const BlackHoleLUTHeader& header = levels[level].header;
+		bool fitsTexture = budget.maxTextureSize == 0 || ((int)header.vrResolution <= budget.maxTextureSize
+			&& (int)header.vPhiResolution <= budget.maxTextureSize && (int)header.orResolution <= budget.maxTextureSize);
+		if (fitsMemory && fitsVertices && fitsTexture)
+		{
+			return level;
+		}
+	}
+	return 0;
+}
+
+bool BlackHoleMap::setLevel(int level)
+{
+	if (level < 0 || level >= (int)levels.size())
+	{
+		return false;
+	}
+	Level& entry = levels[level];
+	if (!entry.verified)
+	{
+		if (BlackHoleLUT::crc32(entry.texels, (size_t)entry.header.dataSize) != entry.header.checksum)
+		{
+			std::cerr << "Black hole table level " << level << " failed its checksum" << std::endl;
+			return false;
+		}
+		entry.verified = true;
+	}
+
+	applyHeader(entry.header);
+	data = entry.texels;
+	warpTable = BlackHoleWarp::prepare(entry.header, data);
+	currentLevel = level;
+	return true;
+}
+
+bool BlackHoleMap::upgrade()
+{
+	if (currentLevel < 0 || currentLevel >= targetLevel)
+	{
+		return false;
+	}
+	if (!setLevel(currentLevel + 1))
+	{
+		// stay on what already works
+		targetLevel = currentLevel;
+		return false;
+	}
+	sendToGPU();
+	return true;
+}
+
+void BlackHoleMap::applyHeader(const BlackHoleLUTHeader& header)
+{
+	vrResolution = header.vrResolution;
+	vPhiResolution = header.vPhiResolution;
+	orResolution = header.orResolution;
+	vrMin = header.vrMin;
+	vrMax = header.vrMax;
+	orMin = header.orMin;
+	orMax = header.orMax;
+	vrWarp = header.vrWarp;
+	vPhiWarp = header.vPhiWarp;
+	orWarp = header.orWarp;
+	vrWarpParameter = header.vrWarpParameter;
+	vPhiWarpParameter = header.vPhiWarpParameter;
+	orWarpParameter = header.orWarpParameter;
+	elementType = header.elementType;
+	// float tables leave the decode fields zeroed
+	bool scaled = elementType != BLACK_HOLE_LUT_FLOAT32;
+	channelScale = scaled ? glm::vec3(header.channelScale[0], header.channelScale[1], header.channelScale[2]) : glm::vec3(1.0f);
+	channelOffset = scaled ? glm::vec3(header.channelOffset[0], header.channelOffset[1], header.channelOffset[2]) : glm::vec3(0.0f);
+}
+
+void BlackHoleMap::sendToGPU()
+{
+	if (textureID == 0)
+	{
+		glGenTextures(1, &textureID);
+	}
+	glBindTexture(GL_TEXTURE_3D, textureID);
+
+	GLint internalFormat = GL_RGB32F;
+	GLenum type = GL_FLOAT;
+	if (elementType == BLACK_HOLE_LUT_FLOAT16)
+	{
+		internalFormat = GL_RGB16F;
+		type = GL_HALF_FLOAT;
+	}
+	else if (elementType == BLACK_HOLE_LUT_UNORM16)
+	{
+		internalFormat = GL_RGB16;
+		type = GL_UNSIGNED_SHORT;
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, orResolution);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, vPhiResolution);
+	// 6 byte texels don't keep rows 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// straight from the mapping for binary tables, the driver does the only copy
+	glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, orResolution, vPhiResolution, vrResolution, 0, GL_RGB, type, data);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+glm::vec3 BlackHoleMap::getValue(float vertexR, float vertexPhi, float observerR) const
+{
+	float value[BLACK_HOLE_LUT_CHANNELS];
+	BlackHoleWarp::sample(warpTable, vertexR, vertexPhi, observerR, value);
+	return glm::vec3(value[0], value[1], value[2]);
+}
+
+void BlackHoleMap::getValues(size_t count, const float* vertexR, const float* vertexPhi, const float* observerR, float* const value[3]) const
+{
+	BlackHoleWarp::sample(warpTable, count, vertexR, vertexPhi, observerR, value);
+}
+
+BlackHoleWarpFrame BlackHoleMap::getWarpFrame(const glm::mat4& V, bool secondary, const glm::vec3& observer) const
+{
+	BlackHoleWarpFrame frame;
+	glm::vec3 hole = glm::vec3(V * glm::vec4(position, 1.0f));
+	for (int i = 0; i < 3; i++)
+	{
+		frame.hole[i] = hole[i];
+		frame.observer[i] = observer[i];
+	}
+	frame.size = size;
+	frame.secondary = secondary;
+	return frame;
+}
+
+void BlackHoleMap::warp(const BlackHoleWarpFrame& frame, const BlackHoleWarpBatch& batch) const
+{
+	BlackHoleWarp::warp(warpTable, frame, batch);
+}
+
+void BlackHoleMap::bind(GLint handle)
+{
+	bindTexture();
+	glUniform1i(handle, textureUnit);
+}
+
+void BlackHoleMap::bindTexture()
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_3D, textureID);
+}
+
+void BlackHoleMap::unbind()
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef _BLACK_HOLE_MAP_H_
+#define _BLACK_HOLE_MAP_H_
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "BlackHoleLUT.h"
+#include "BlackHoleWarp.h"
+#include "MappedFile.h"
+
+// What a table level may cost. A level is only worth its memory while the
+// meshes are dense enough to show the difference, so the texel count is also
+// capped relative to how many vertices get warped every frame.
+struct BlackHoleBudget
+{
+	// GPU memory the table may take, 0 for no limit
+	size_t textureBytes = 0;
+	// vertices run through the black hole per frame, 0 for no limit
+	size_t verticesPerFrame = 0;
+	float texelsPerVertex = 4.0f;
+	// GL_MAX_3D_TEXTURE_SIZE, 0 for no limit
+	int maxTextureSize = 0;
+};
+
+class BlackHoleMap {
+public:
+	BlackHoleMap();
+	virtual ~BlackHoleMap();
+	glm::vec3 position;
+	float size;
+	int vrResolution;
+	float vrMin, vrMax;
+	int vPhiResolution;
+	int orResolution;
+	float orMin, orMax;
+	// axis warps from the header, see BlackHoleLUT::warpAxis
+	int vrWarp, vPhiWarp, orWarp;
+	float vrWarpParameter, vPhiWarpParameter, orWarpParameter;
+	// BlackHoleLUTElementType of data, 16 bit tables are decoded with the channel scale and offset
+	int elementType;
+	glm::vec3 channelScale, channelOffset;
+	// points into the mapped .bhlut file, or into textData for legacy tables
+	const void* data;
+	GLuint textureID;
+	GLint textureUnit;
+	// packs start out on their coarsest level with targetLevel at the finest
+	bool loadFromFile(std::string path);
+	void sendToGPU();
+	int getLevelCount() const { return (int)levels.size(); }
+	int getLevel() const { return currentLevel; }
+	const BlackHoleLUTHeader& getLevelHeader(int level) const { return levels[level].header; }
+	size_t getTextureBytes(int level) const;
+	// finest level that fits, or the coarsest if none do
+	int selectLevel(const BlackHoleBudget& budget) const;
+	// points data and the resolution fields at another level, call sendToGPU() after
+	bool setLevel(int level);
+	// moves one level closer to targetLevel and uploads it, false once there
+	bool upgrade();
+	int targetLevel;
+	// trilinear like the texture unit, vertex and observer radius in units of size, vertex phi in radians
+	glm::vec3 getValue(float vertexR, float vertexPhi, float observerR) const;
+	// the same for count lookups at once, channel k of lookup i goes to value[k][i]
+	void getValues(size_t count, const float* vertexR, const float* vertexPhi, const float* observerR, float* const value[3]) const;
+	// the current level, for BlackHoleWarp
+	const BlackHoleWarpTable& getWarpTable() const { return warpTable; }
+	// what the shader derives from its uniforms for one pass, observer in view space
+	BlackHoleWarpFrame getWarpFrame(const glm::mat4& V, bool secondary, const glm::vec3& observer = glm::vec3(0.0f)) const;
+	// view space vertices to where the vertex shader puts them
+	void warp(const BlackHoleWarpFrame& frame, const BlackHoleWarpBatch& batch) const;
+	void bind(GLint handle);
+	// just the texture, for programs whose sampler already points at textureUnit
+	void bindTexture();
+	void unbind();
+private:
+	struct Level
+	{
+		BlackHoleLUTHeader header;
+		const unsigned char* texels;
+		// payload checksums are only checked once a level is actually used
+		bool verified;
+	};
+	bool loadBinary(const std::string& path);
+	bool loadText(const std::string& path);
+	void applyHeader(const BlackHoleLUTHeader& header);
+	std::vector<Level> levels;
+	int currentLevel;
+	BlackHoleWarpTable warpTable;
+	MappedFile mappedFile;
+	std::vector<float> textData;
+};
+
+#endif
@@ -0,0 +1,655 @@
+#include "BlackHoleWarp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BLACK_HOLE_WARP_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC hands out every intrinsic regardless of /arch
+#define AVX2_TARGET
+#else
+// only these functions get AVX2, the rest of the binary still runs anywhere
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+constexpr float WARP_PI = 3.14159265358979f;
+constexpr float WARP_TWO_PI = 6.28318530717959f;
+
+namespace
+{
+
+struct Frame
+{
+	float hole[3];
+	float observer[3];
+	float xAxis[3];
+	// used as the y axis when a vertex sits right on the x axis
+	float fallbackYAxis[3];
+	float invSize;
+	float tObserver;
+	// distance compensation for an observer beyond the table
+	float observerExtra;
+	float vertexMax;
+	float ySign;
+	bool secondary;
+};
+
+BlackHoleWarpAxis makeAxis(uint32_t warp, float parameter, float min, float max, uint32_t resolution)
+{
+	BlackHoleWarpAxis axis;
+	axis.warp = warp;
+	axis.min = min;
+	axis.max = max;
+	if (warp == BLACK_HOLE_LUT_WARP_LOG)
+	{
+		axis.shift = parameter;
+		axis.a = (float)(1.0 / std::log(((double)max - parameter) / ((double)min - parameter)));
+		axis.b = (float)(-std::log((double)min - parameter) * axis.a);
+	}
+	else if (warp == BLACK_HOLE_LUT_WARP_SINH)
+	{
+		axis.shift = 0.5f * (min + max);
+		axis.a = (float)(std::sinh((double)parameter) / (0.5 * ((double)max - min)));
+		axis.b = 0.5f / parameter;
+	}
+	else
+	{
+		axis.a = 1.0f / (max - min);
+		axis.b = -min * axis.a;
+	}
+	axis.resolution = (int)resolution;
+	axis.last = (float)(resolution - 1);
+	axis.lastLower = std::max((int)resolution - 2, 0);
+	return axis;
+}
+
+float warpAxis(const BlackHoleWarpAxis& axis, float value)
+{
+	value = std::min(std::max(value, axis.min), axis.max);
+	float t;
+	if (axis.warp == BLACK_HOLE_LUT_WARP_LOG)
+	{
+		t = std::log(value - axis.shift) * axis.a + axis.b;
+	}
+	else if (axis.warp == BLACK_HOLE_LUT_WARP_SINH)
+	{
+		t = 0.5f + std::asinh((value - axis.shift) * axis.a) * axis.b;
+	}
+	else
+	{
+		t = value * axis.a + axis.b;
+	}
+	return std::min(std::max(t, 0.0f), 1.0f);
+}
+
+void locate(const BlackHoleWarpAxis& axis, float t, int* index, float* weight)
+{
+	float position = t * axis.last;
+	index[0] = std::min((int)position, axis.lastLower);
+	index[1] = std::min(index[0] + 1, axis.resolution - 1);
+	float fraction = std::min(std::max(position - index[0], 0.0f), 1.0f);
+	weight[0] = 1.0f - fraction;
+	weight[1] = fraction;
+}
+
+// channels before the scale and offset, so they interpolate the same way the texture unit does
+void loadTexel(const BlackHoleWarpTable& table, int index, float* raw)
+{
+	if (table.elementType == BLACK_HOLE_LUT_FLOAT32)
+	{
+		std::memcpy(raw, static_cast<const float*>(table.texels) + (size_t)index * BLACK_HOLE_LUT_CHANNELS, sizeof(float) * BLACK_HOLE_LUT_CHANNELS);
+		return;
+	}
+	const uint16_t* texel = static_cast<const uint16_t*>(table.texels) + (size_t)index * BLACK_HOLE_LUT_CHANNELS;
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		raw[channel] = table.elementType == BLACK_HOLE_LUT_FLOAT16 ? BlackHoleLUT::halfToFloat(texel[channel]) : (float)texel[channel];
+	}
+}
+
+void sampleCoordinates(const BlackHoleWarpTable& table, float tVr, float tVPhi, float tOr, float* value)
+{
+	int vr[2], vPhi[2], orIndex[2];
+	float vrWeight[2], vPhiWeight[2], orWeight[2];
+	locate(table.axes[0], tVr, vr, vrWeight);
+	locate(table.axes[1], tVPhi, vPhi, vPhiWeight);
+	locate(table.axes[2], tOr, orIndex, orWeight);
+
+	float sum[BLACK_HOLE_LUT_CHANNELS] = {};
+	for (int corner = 0; corner < 8; corner++)
+	{
+		int vrUpper = (corner >> 2) & 1;
+		int vPhiUpper = (corner >> 1) & 1;
+		int orUpper = corner & 1;
+		float weight = vrWeight[vrUpper] * vPhiWeight[vPhiUpper] * orWeight[orUpper];
+		float raw[BLACK_HOLE_LUT_CHANNELS];
+		loadTexel(table, vr[vrUpper] * table.vrStride + vPhi[vPhiUpper] * table.vPhiStride + orIndex[orUpper], raw);
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			sum[channel] += weight * raw[channel];
+		}
+	}
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		value[channel] = sum[channel] * table.scale[channel] + table.offset[channel];
+	}
+}
+
+Frame makeFrame(const BlackHoleWarpTable& table, const BlackHoleWarpFrame& source)
+{
+	Frame frame;
+	float observerRelative[3];
+	for (int i = 0; i < 3; i++)
+	{
+		frame.hole[i] = source.hole[i];
+		frame.observer[i] = source.observer[i];
+		observerRelative[i] = source.observer[i] - source.hole[i];
+	}
+	float observerR = std::sqrt(observerRelative[0] * observerRelative[0] + observerRelative[1] * observerRelative[1]
+		+ observerRelative[2] * observerRelative[2]);
+	for (int i = 0; i < 3; i++)
+	{
+		frame.xAxis[i] = observerRelative[i] / observerR;
+	}
+
+	// any direction at right angles to x will do, so take the world axis least like it and remove its x part
+	int least = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (std::fabs(frame.xAxis[i]) < std::fabs(frame.xAxis[least]))
+		{
+			least = i;
+		}
+	}
+	float other[3] = { 0.0f, 0.0f, 0.0f };
+	other[least] = 1.0f;
+	float along = frame.xAxis[least];
+	float length = std::sqrt(1.0f - along * along);
+	for (int i = 0; i < 3; i++)
+	{
+		frame.fallbackYAxis[i] = (other[i] - along * frame.xAxis[i]) / length;
+	}
+
+	frame.invSize = 1.0f / source.size;
+	frame.tObserver = warpAxis(table.axes[2], observerR * frame.invSize);
+	frame.observerExtra = std::max(0.0f, observerR - table.axes[2].max * source.size);
+	frame.vertexMax = table.axes[0].max * source.size;
+	frame.ySign = source.secondary ? -1.0f : 1.0f;
+	frame.secondary = source.secondary;
+	return frame;
+}
+
+void warpVertex(const BlackHoleWarpTable& table, const Frame& frame, const BlackHoleWarpBatch& batch, size_t i, bool normals)
+{
+	const float* x = frame.xAxis;
+	float relative[3] = { batch.position[0][i] - frame.hole[0], batch.position[1][i] - frame.hole[1], batch.position[2][i] - frame.hole[2] };
+	float vertexX = relative[0] * x[0] + relative[1] * x[1] + relative[2] * x[2];
+	float perpendicular[3] = { relative[0] - vertexX * x[0], relative[1] - vertexX * x[1], relative[2] - vertexX * x[2] };
+	float vertexY = std::sqrt(perpendicular[0] * perpendicular[0] + perpendicular[1] * perpendicular[1] + perpendicular[2] * perpendicular[2]);
+	float y[3];
+	for (int k = 0; k < 3; k++)
+	{
+		y[k] = vertexY > 1e-15f ? perpendicular[k] / vertexY : frame.fallbackYAxis[k];
+	}
+
+	float vertexR = std::sqrt(relative[0] * relative[0] + relative[1] * relative[1] + relative[2] * relative[2]);
+	float vertexPhi = std::atan2(vertexY, vertexX);
+	if (frame.secondary)
+	{
+		vertexPhi = WARP_TWO_PI - vertexPhi;
+	}
+
+	float value[BLACK_HOLE_LUT_CHANNELS];
+	sampleCoordinates(table, warpAxis(table.axes[0], vertexR * frame.invSize), warpAxis(table.axes[1], vertexPhi), frame.tObserver, value);
+	float va = value[0];
+	float oa = value[1];
+	float d = value[2] + frame.observerExtra + std::max(0.0f, vertexR - frame.vertexMax);
+
+	float cosOa = std::cos(oa);
+	float sinOa = std::sin(oa) * frame.ySign;
+	float normal[3];
+	if (normals)
+	{
+		normal[0] = batch.normal[0][i];
+		normal[1] = batch.normal[1][i];
+		normal[2] = batch.normal[2][i];
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		batch.warpedPosition[k][i] = frame.observer[k] + (cosOa * x[k] + sinOa * y[k]) * d;
+	}
+	if (!normals)
+	{
+		return;
+	}
+
+	// the shader's rotationMatrix is filled column by column from a row major listing,
+	// so it ends up turning the other way round its axis
+	float angle = va - oa - WARP_PI;
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	float axis[3] = { x[1] * y[2] - x[2] * y[1], x[2] * y[0] - x[0] * y[2], x[0] * y[1] - x[1] * y[0] };
+	float across[3] = { axis[1] * normal[2] - axis[2] * normal[1], axis[2] * normal[0] - axis[0] * normal[2], axis[0] * normal[1] - axis[1] * normal[0] };
+	float along = (axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2]) * (1.0f - c);
+	for (int k = 0; k < 3; k++)
+	{
+		batch.warpedNormal[k][i] = normal[k] * c + across[k] * s + axis[k] * along;
+	}
+}
+
+#ifdef BLACK_HOLE_WARP_X86
+
+// Cephes style polynomials, good to a couple of ulp over the ranges the warp feeds them
+
+AVX2_TARGET inline __m256 log8(__m256 x)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+	// mantissa on [0.5, 1)
+	__m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)));
+	__m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+	exponent = _mm256_sub_ps(exponent, _mm256_and_ps(small, one));
+	m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(small, m));
+
+	__m256 z = _mm256_mul_ps(m, m);
+	__m256 y = _mm256_set1_ps(7.0376836292e-2f);
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.1514610310e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.1676998740e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.2420140846e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.4249322787e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.6668057665e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(2.0000714765e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-2.4999993993e-1f));
+	y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(3.3333331174e-1f));
+	y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+	y = _mm256_fmadd_ps(exponent, _mm256_set1_ps(-2.12194440e-4f), y);
+	y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+	return _mm256_fmadd_ps(exponent, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+}
+
+AVX2_TARGET inline __m256 asinh8(__m256 x)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 magnitude = _mm256_andnot_ps(signMask, x);
+	__m256 root = _mm256_sqrt_ps(_mm256_fmadd_ps(magnitude, magnitude, _mm256_set1_ps(1.0f)));
+	return _mm256_or_ps(log8(_mm256_add_ps(magnitude, root)), _mm256_and_ps(signMask, x));
+}
+
+AVX2_TARGET inline void sincos8(__m256 x, __m256& sine, __m256& cosine)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 sineSign = _mm256_and_ps(x, signMask);
+	x = _mm256_andnot_ps(signMask, x);
+
+	// octant, rounded up to even
+	__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)));
+	octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+	__m256 y = _mm256_cvtepi32_ps(octant);
+
+	__m256 swapSineSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29));
+	__m256 useSinePolynomial = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+	__m256 cosineSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+		_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+	sineSign = _mm256_xor_ps(sineSign, swapSineSign);
+
+	// x - y * pi / 4 in three pieces
+	x = _mm256_fnmadd_ps(y, _mm256_set1_ps(0.78515625f), x);
+	x = _mm256_fnmadd_ps(y, _mm256_set1_ps(2.4187564849853515625e-4f), x);
+	x = _mm256_fnmadd_ps(y, _mm256_set1_ps(3.77489497744594108e-8f), x);
+	__m256 z = _mm256_mul_ps(x, x);
+
+	__m256 cosinePolynomial = _mm256_set1_ps(2.443315711809948e-5f);
+	cosinePolynomial = _mm256_fmadd_ps(cosinePolynomial, z, _mm256_set1_ps(-1.388731625493765e-3f));
+	cosinePolynomial = _mm256_fmadd_ps(cosinePolynomial, z, _mm256_set1_ps(4.166664568298827e-2f));
+	cosinePolynomial = _mm256_mul_ps(_mm256_mul_ps(cosinePolynomial, z), z);
+	cosinePolynomial = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, cosinePolynomial);
+	cosinePolynomial = _mm256_add_ps(cosinePolynomial, _mm256_set1_ps(1.0f));
+
+	__m256 sinePolynomial = _mm256_set1_ps(-1.9515295891e-4f);
+	sinePolynomial = _mm256_fmadd_ps(sinePolynomial, z, _mm256_set1_ps(8.3321608736e-3f));
+	sinePolynomial = _mm256_fmadd_ps(sinePolynomial, z, _mm256_set1_ps(-1.6666654611e-1f));
+	sinePolynomial = _mm256_fmadd_ps(_mm256_mul_ps(sinePolynomial, z), x, x);
+
+	sine = _mm256_xor_ps(_mm256_blendv_ps(cosinePolynomial, sinePolynomial, useSinePolynomial), sineSign);
+	cosine = _mm256_xor_ps(_mm256_blendv_ps(sinePolynomial, cosinePolynomial, useSinePolynomial), cosineSign);
+}
+
+// atan2 for y >= 0, which is all the warp ever asks for
+AVX2_TARGET inline __m256 atan2Upper8(__m256 y, __m256 x)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 absX = _mm256_andnot_ps(signMask, x);
+	__m256 numerator = _mm256_min_ps(y, absX);
+	__m256 denominator = _mm256_max_ps(_mm256_max_ps(y, absX), _mm256_set1_ps(1e-30f));
+	__m256 z = _mm256_div_ps(numerator, denominator);
+
+	// z on [0, 1], brought down to [-tan(pi / 8), tan(pi / 8)]
+	__m256 reduce = _mm256_cmp_ps(z, _mm256_set1_ps(0.414213562373095f), _CMP_GT_OQ);
+	__m256 reduced = _mm256_div_ps(_mm256_sub_ps(z, _mm256_set1_ps(1.0f)), _mm256_add_ps(z, _mm256_set1_ps(1.0f)));
+	z = _mm256_blendv_ps(z, reduced, reduce);
+	__m256 angle = _mm256_and_ps(reduce, _mm256_set1_ps(0.25f * WARP_PI));
+
+	__m256 z2 = _mm256_mul_ps(z, z);
+	__m256 polynomial = _mm256_set1_ps(8.05374449538e-2f);
+	polynomial = _mm256_fmadd_ps(polynomial, z2, _mm256_set1_ps(-1.38776856032e-1f));
+	polynomial = _mm256_fmadd_ps(polynomial, z2, _mm256_set1_ps(1.99777106478e-1f));
+	polynomial = _mm256_fmadd_ps(polynomial, z2, _mm256_set1_ps(-3.33329491539e-1f));
+	angle = _mm256_add_ps(angle, _mm256_fmadd_ps(_mm256_mul_ps(polynomial, z2), z, z));
+
+	angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(0.5f * WARP_PI), angle), _mm256_cmp_ps(y, absX, _CMP_GT_OQ));
+	return _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(WARP_PI), angle), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+}
+
+AVX2_TARGET inline __m256 warpAxis8(const BlackHoleWarpAxis& axis, __m256 value)
+{
+	value = _mm256_min_ps(_mm256_max_ps(value, _mm256_set1_ps(axis.min)), _mm256_set1_ps(axis.max));
+	__m256 t;
+	if (axis.warp == BLACK_HOLE_LUT_WARP_LOG)
+	{
+		t = _mm256_fmadd_ps(log8(_mm256_sub_ps(value, _mm256_set1_ps(axis.shift))), _mm256_set1_ps(axis.a), _mm256_set1_ps(axis.b));
+	}
+	else if (axis.warp == BLACK_HOLE_LUT_WARP_SINH)
+	{
+		__m256 scaled = _mm256_mul_ps(_mm256_sub_ps(value, _mm256_set1_ps(axis.shift)), _mm256_set1_ps(axis.a));
+		t = _mm256_fmadd_ps(asinh8(scaled), _mm256_set1_ps(axis.b), _mm256_set1_ps(0.5f));
+	}
+	else
+	{
+		t = _mm256_fmadd_ps(value, _mm256_set1_ps(axis.a), _mm256_set1_ps(axis.b));
+	}
+	return _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+AVX2_TARGET inline void locate8(const BlackHoleWarpAxis& axis, __m256 t, __m256i* index, __m256* weight)
+{
+	__m256 position = _mm256_mul_ps(t, _mm256_set1_ps(axis.last));
+	index[0] = _mm256_min_epi32(_mm256_cvttps_epi32(position), _mm256_set1_epi32(axis.lastLower));
+	index[1] = _mm256_min_epi32(_mm256_add_epi32(index[0], _mm256_set1_epi32(1)), _mm256_set1_epi32(axis.resolution - 1));
+	__m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(index[0]));
+	fraction = _mm256_min_ps(_mm256_max_ps(fraction, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	weight[0] = _mm256_sub_ps(_mm256_set1_ps(1.0f), fraction);
+	weight[1] = fraction;
+}
+
+// half floats as float, exact for everything but infinities and NaNs which a table never holds
+AVX2_TARGET inline __m256 halfToFloat8(__m256i half)
+{
+	__m256i magnitude = _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x7fff)), 13);
+	__m256 value = _mm256_mul_ps(_mm256_castsi256_ps(magnitude), _mm256_set1_ps(5.192296858534828e33f));
+	__m256i sign = _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x8000)), 16);
+	return _mm256_or_ps(value, _mm256_castsi256_ps(sign));
+}
+
+AVX2_TARGET inline void sample8(const BlackHoleWarpTable& table, __m256 tVr, __m256 tVPhi, __m256 tOr, __m256* value)
+{
+	__m256i vr[2], vPhi[2], orIndex[2];
+	__m256 vrWeight[2], vPhiWeight[2], orWeight[2];
+	locate8(table.axes[0], tVr, vr, vrWeight);
+	locate8(table.axes[1], tVPhi, vPhi, vPhiWeight);
+	locate8(table.axes[2], tOr, orIndex, orWeight);
+	for (int k = 0; k < 2; k++)
+	{
+		vr[k] = _mm256_mullo_epi32(vr[k], _mm256_set1_epi32(table.vrStride));
+		vPhi[k] = _mm256_mullo_epi32(vPhi[k], _mm256_set1_epi32(table.vPhiStride));
+	}
+
+	__m256 sum[BLACK_HOLE_LUT_CHANNELS] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+	for (int corner = 0; corner < 8; corner++)
+	{
+		int vrUpper = (corner >> 2) & 1;
+		int vPhiUpper = (corner >> 1) & 1;
+		int orUpper = corner & 1;
+		__m256 weight = _mm256_mul_ps(_mm256_mul_ps(vrWeight[vrUpper], vPhiWeight[vPhiUpper]), orWeight[orUpper]);
+		__m256i texel = _mm256_add_epi32(_mm256_add_epi32(vr[vrUpper], vPhi[vPhiUpper]), orIndex[orUpper]);
+
+		__m256 raw[BLACK_HOLE_LUT_CHANNELS];
+		if (table.elementType == BLACK_HOLE_LUT_FLOAT32)
+		{
+			const float* texels = static_cast<const float*>(table.texels);
+			__m256i element = _mm256_mullo_epi32(texel, _mm256_set1_epi32(BLACK_HOLE_LUT_CHANNELS));
+			raw[0] = _mm256_i32gather_ps(texels, element, 4);
+			raw[1] = _mm256_i32gather_ps(texels + 1, element, 4);
+			raw[2] = _mm256_i32gather_ps(texels + 2, element, 4);
+		}
+		else
+		{
+			// two 32 bit reads cover a 6 byte texel without running past its end
+			const int* texels = static_cast<const int*>(table.texels);
+			__m256i byte = _mm256_mullo_epi32(texel, _mm256_set1_epi32(BLACK_HOLE_LUT_CHANNELS * sizeof(uint16_t)));
+			__m256i low = _mm256_i32gather_epi32(texels, byte, 1);
+			__m256i high = _mm256_i32gather_epi32(texels, _mm256_add_epi32(byte, _mm256_set1_epi32(2)), 1);
+			__m256i channels[BLACK_HOLE_LUT_CHANNELS] = {
+				_mm256_and_si256(low, _mm256_set1_epi32(0xffff)),
+				_mm256_srli_epi32(low, 16),
+				_mm256_srli_epi32(high, 16)
+			};
+			for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+			{
+				raw[channel] = table.elementType == BLACK_HOLE_LUT_FLOAT16 ? halfToFloat8(channels[channel]) : _mm256_cvtepi32_ps(channels[channel]);
+			}
+		}
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			sum[channel] = _mm256_fmadd_ps(weight, raw[channel], sum[channel]);
+		}
+	}
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		value[channel] = _mm256_fmadd_ps(sum[channel], _mm256_set1_ps(table.scale[channel]), _mm256_set1_ps(table.offset[channel]));
+	}
+}
+
+AVX2_TARGET size_t sampleAVX2(const BlackHoleWarpTable& table, size_t count, const float* vertexR, const float* vertexPhi,
+	const float* observerR, float* const value[3])
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 tVr = warpAxis8(table.axes[0], _mm256_loadu_ps(vertexR + i));
+		__m256 tVPhi = warpAxis8(table.axes[1], _mm256_loadu_ps(vertexPhi + i));
+		__m256 tOr = warpAxis8(table.axes[2], _mm256_loadu_ps(observerR + i));
+		__m256 result[BLACK_HOLE_LUT_CHANNELS];
+		sample8(table, tVr, tVPhi, tOr, result);
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			_mm256_storeu_ps(value[channel] + i, result[channel]);
+		}
+	}
+	return i;
+}
+
+AVX2_TARGET size_t warpAVX2(const BlackHoleWarpTable& table, const Frame& frame, const BlackHoleWarpBatch& batch, bool normals)
+{
+	__m256 x[3], hole[3], observer[3], fallbackY[3];
+	for (int k = 0; k < 3; k++)
+	{
+		x[k] = _mm256_set1_ps(frame.xAxis[k]);
+		hole[k] = _mm256_set1_ps(frame.hole[k]);
+		observer[k] = _mm256_set1_ps(frame.observer[k]);
+		fallbackY[k] = _mm256_set1_ps(frame.fallbackYAxis[k]);
+	}
+	__m256 tOr = _mm256_set1_ps(frame.tObserver);
+
+	size_t i = 0;
+	for (; i + 8 <= batch.count; i += 8)
+	{
+		__m256 relative[3];
+		for (int k = 0; k < 3; k++)
+		{
+			relative[k] = _mm256_sub_ps(_mm256_loadu_ps(batch.position[k] + i), hole[k]);
+		}
+		__m256 vertexX = _mm256_fmadd_ps(relative[2], x[2], _mm256_fmadd_ps(relative[1], x[1], _mm256_mul_ps(relative[0], x[0])));
+		__m256 perpendicular[3];
+		for (int k = 0; k < 3; k++)
+		{
+			perpendicular[k] = _mm256_fnmadd_ps(vertexX, x[k], relative[k]);
+		}
+		__m256 vertexY = _mm256_sqrt_ps(_mm256_fmadd_ps(perpendicular[2], perpendicular[2],
+			_mm256_fmadd_ps(perpendicular[1], perpendicular[1], _mm256_mul_ps(perpendicular[0], perpendicular[0]))));
+		__m256 onAxis = _mm256_cmp_ps(vertexY, _mm256_set1_ps(1e-15f), _CMP_LE_OQ);
+		__m256 inverseY = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_max_ps(vertexY, _mm256_set1_ps(1e-15f)));
+		__m256 y[3];
+		for (int k = 0; k < 3; k++)
+		{
+			y[k] = _mm256_blendv_ps(_mm256_mul_ps(perpendicular[k], inverseY), fallbackY[k], onAxis);
+		}
+
+		__m256 vertexR = _mm256_sqrt_ps(_mm256_fmadd_ps(relative[2], relative[2],
+			_mm256_fmadd_ps(relative[1], relative[1], _mm256_mul_ps(relative[0], relative[0]))));
+		__m256 vertexPhi = atan2Upper8(vertexY, vertexX);
+		if (frame.secondary)
+		{
+			vertexPhi = _mm256_sub_ps(_mm256_set1_ps(WARP_TWO_PI), vertexPhi);
+		}
+
+		__m256 value[BLACK_HOLE_LUT_CHANNELS];
+		sample8(table, warpAxis8(table.axes[0], _mm256_mul_ps(vertexR, _mm256_set1_ps(frame.invSize))),
+			warpAxis8(table.axes[1], vertexPhi), tOr, value);
+		__m256 va = value[0];
+		__m256 oa = value[1];
+		__m256 beyond = _mm256_max_ps(_mm256_sub_ps(vertexR, _mm256_set1_ps(frame.vertexMax)), _mm256_setzero_ps());
+		__m256 d = _mm256_add_ps(_mm256_add_ps(value[2], _mm256_set1_ps(frame.observerExtra)), beyond);
+
+		__m256 sinOa, cosOa;
+		sincos8(oa, sinOa, cosOa);
+		sinOa = _mm256_mul_ps(sinOa, _mm256_set1_ps(frame.ySign));
+		__m256 normal[3];
+		if (normals)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				normal[k] = _mm256_loadu_ps(batch.normal[k] + i);
+			}
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			__m256 direction = _mm256_fmadd_ps(sinOa, y[k], _mm256_mul_ps(cosOa, x[k]));
+			_mm256_storeu_ps(batch.warpedPosition[k] + i, _mm256_fmadd_ps(direction, d, observer[k]));
+		}
+		if (!normals)
+		{
+			continue;
+		}
+
+		__m256 s, c;
+		sincos8(_mm256_sub_ps(_mm256_sub_ps(va, oa), _mm256_set1_ps(WARP_PI)), s, c);
+		__m256 axis[3] = {
+			_mm256_fmsub_ps(x[1], y[2], _mm256_mul_ps(x[2], y[1])),
+			_mm256_fmsub_ps(x[2], y[0], _mm256_mul_ps(x[0], y[2])),
+			_mm256_fmsub_ps(x[0], y[1], _mm256_mul_ps(x[1], y[0]))
+		};
+		__m256 across[3] = {
+			_mm256_fmsub_ps(axis[1], normal[2], _mm256_mul_ps(axis[2], normal[1])),
+			_mm256_fmsub_ps(axis[2], normal[0], _mm256_mul_ps(axis[0], normal[2])),
+			_mm256_fmsub_ps(axis[0], normal[1], _mm256_mul_ps(axis[1], normal[0]))
+		};
+		__m256 along = _mm256_fmadd_ps(axis[2], normal[2], _mm256_fmadd_ps(axis[1], normal[1], _mm256_mul_ps(axis[0], normal[0])));
+		along = _mm256_mul_ps(along, _mm256_sub_ps(_mm256_set1_ps(1.0f), c));
+		for (int k = 0; k < 3; k++)
+		{
+			__m256 rotated = _mm256_fmadd_ps(axis[k], along, _mm256_fmadd_ps(across[k], s, _mm256_mul_ps(normal[k], c)));
+			_mm256_storeu_ps(batch.warpedNormal[k] + i, rotated);
+		}
+	}
+	return i;
+}
+
+#endif
+
+}
+
+bool BlackHoleWarp::hasAVX2()
+{
+#if defined(BLACK_HOLE_WARP_X86) && defined(_MSC_VER) && !defined(__clang__)
+	static const bool supported = []()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osSaves = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		return fma && osSaves && (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+#elif defined(BLACK_HOLE_WARP_X86)
+	static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+BlackHoleWarpTable BlackHoleWarp::prepare(const BlackHoleLUTHeader& header, const void* texels)
+{
+	BlackHoleWarpTable table;
+	table.axes[0] = makeAxis(header.vrWarp, header.vrWarpParameter, header.vrMin, header.vrMax, header.vrResolution);
+	table.axes[1] = makeAxis(header.vPhiWarp, header.vPhiWarpParameter, 0.0f, WARP_TWO_PI, header.vPhiResolution);
+	table.axes[2] = makeAxis(header.orWarp, header.orWarpParameter, header.orMin, header.orMax, header.orResolution);
+	table.elementType = header.elementType;
+	table.texels = texels;
+	table.vrStride = (int)BlackHoleLUT::getTexelIndex(header, 1, 0, 0);
+	table.vPhiStride = (int)BlackHoleLUT::getTexelIndex(header, 0, 1, 0);
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		bool scaled = header.elementType != BLACK_HOLE_LUT_FLOAT32;
+		table.scale[channel] = scaled ? header.channelScale[channel] : 1.0f;
+		table.offset[channel] = scaled ? header.channelOffset[channel] : 0.0f;
+		if (header.elementType == BLACK_HOLE_LUT_UNORM16)
+		{
+			table.scale[channel] /= 65535.0f;
+		}
+	}
+	// 16 bit texels are gathered with byte offsets
+	table.gatherable = BlackHoleLUT::getTexelCount(header) * BlackHoleLUT::getElementSize(header.elementType) < 0x7fffffff;
+	return table;
+}
+
+void BlackHoleWarp::sample(const BlackHoleWarpTable& table, float vertexR, float vertexPhi, float observerR, float* value)
+{
+	sampleCoordinates(table, warpAxis(table.axes[0], vertexR), warpAxis(table.axes[1], vertexPhi), warpAxis(table.axes[2], observerR), value);
+}
+
+void BlackHoleWarp::sample(const BlackHoleWarpTable& table, size_t count, const float* vertexR, const float* vertexPhi,
+	const float* observerR, float* const value[3], bool allowSIMD)
+{
+	size_t i = 0;
+#ifdef BLACK_HOLE_WARP_X86
+	if (allowSIMD && hasAVX2() && table.gatherable)
+	{
+		i = sampleAVX2(table, count, vertexR, vertexPhi, observerR, value);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float result[BLACK_HOLE_LUT_CHANNELS];
+		sampleCoordinates(table, warpAxis(table.axes[0], vertexR[i]), warpAxis(table.axes[1], vertexPhi[i]),
+			warpAxis(table.axes[2], observerR[i]), result);
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			value[channel][i] = result[channel];
+		}
+	}
+}
+
+void BlackHoleWarp::warp(const BlackHoleWarpTable& table, const BlackHoleWarpFrame& sourceFrame, const BlackHoleWarpBatch& batch,
+	bool allowSIMD)
+{
+	Frame frame = makeFrame(table, sourceFrame);
+	bool normals = batch.normal[0] && batch.warpedNormal[0];
+	size_t i = 0;
+#ifdef BLACK_HOLE_WARP_X86
+	if (allowSIMD && hasAVX2() && table.gatherable)
+	{
+		i = warpAVX2(table, frame, batch, normals);
+	}
+#endif
+	for (; i < batch.count; i++)
+	{
+		warpVertex(table, frame, batch, i, normals);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef _BLACK_HOLE_WARP_H_
+#define _BLACK_HOLE_WARP_H_
+
+#include <cstddef>
+
+#include "BlackHoleLUT.h"
+
+// CPU copy of the black hole half of simple_vert.glsl, for culling, picking,
+// collision and checking frames without a GPU. Vertices come in as separate
+// x, y and z arrays so eight of them fill an AVX2 register. Machines without
+// AVX2 (and the last few vertices of every batch) take the scalar path, which
+// does exactly the same float math one vertex at a time. Nothing here keeps
+// state between calls, so batches can be split across threads freely.
+
+// value to texture coordinate on one axis, t = f(value) * a + b with f picked by the warp
+struct BlackHoleWarpAxis
+{
+	uint32_t warp = BLACK_HOLE_LUT_WARP_LINEAR;
+	float min = 0.0f, max = 1.0f;
+	float shift = 0.0f, a = 1.0f, b = 0.0f;
+	int resolution = 1;
+	// last grid point and the last one that can be the lower corner of a cell
+	float last = 0.0f;
+	int lastLower = 0;
+};
+
+// one level of a table with everything per axis worked out up front, see BlackHoleWarp::prepare
+struct BlackHoleWarpTable
+{
+	BlackHoleWarpAxis axes[3];
+	uint32_t elementType = BLACK_HOLE_LUT_FLOAT32;
+	const void* texels = nullptr;
+	int vrStride = 0, vPhiStride = 0;
+	// applied after interpolating, with the unorm16 divide folded in
+	float scale[BLACK_HOLE_LUT_CHANNELS] = { 1.0f, 1.0f, 1.0f };
+	float offset[BLACK_HOLE_LUT_CHANNELS] = { 0.0f, 0.0f, 0.0f };
+	// small enough for 32 bit gather offsets
+	bool gatherable = false;
+};
+
+// the shader's per frame uniforms, positions in view space
+struct BlackHoleWarpFrame
+{
+	float hole[3] = { 0.0f, 0.0f, 0.0f };
+	float observer[3] = { 0.0f, 0.0f, 0.0f };
+	float size = 1.0f;
+	// the image whose light goes the long way around the hole
+	bool secondary = false;
+};
+
+// structure of arrays, all of them count long; in and out may alias
+struct BlackHoleWarpBatch
+{
+	size_t count = 0;
+	// view space
+	const float* position[3] = { nullptr, nullptr, nullptr };
+	// optional, normals are only rotated when both of these are set
+	const float* normal[3] = { nullptr, nullptr, nullptr };
+	float* warpedPosition[3] = { nullptr, nullptr, nullptr };
+	float* warpedNormal[3] = { nullptr, nullptr, nullptr };
+};
+
+namespace BlackHoleWarp
+{
+	bool hasAVX2();
+	// texels must stay valid for as long as the table is used
+	BlackHoleWarpTable prepare(const BlackHoleLUTHeader& header, const void* texels);
+	// trilinear lookup with GL_LINEAR semantics, radii in units of the black hole size and
+	// vertex phi in radians; writes the three channels (va, oa, d)
+	void sample(const BlackHoleWarpTable& table, float vertexR, float vertexPhi, float observerR, float* value);
+	// the same for a whole batch, channel k of lookup i goes to value[k][i]
+	void sample(const BlackHoleWarpTable& table, size_t count, const float* vertexR, const float* vertexPhi,
+		const float* observerR, float* const value[3], bool allowSIMD = true);
+	// moves every vertex to where the observer sees it, like the vertex shader does
+	void warp(const BlackHoleWarpTable& table, const BlackHoleWarpFrame& frame, const BlackHoleWarpBatch& batch,
+		bool allowSIMD = true);
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "CacheFile.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <algorithm>
+
+namespace CacheFile
+{
+
+bool statSource(const std::string& sourcePath, uint64_t& size, int64_t& time)
+{
+	std::error_code error;
+	size = (uint64_t)std::filesystem::file_size(sourcePath, error);
+	if (error)
+	{
+		return false;
+	}
+	time = (int64_t)std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+	return !error;
+}
+
+uint64_t align(uint64_t offset)
+{
+	return (offset + CACHE_FILE_ALIGNMENT - 1) / CACHE_FILE_ALIGNMENT * CACHE_FILE_ALIGNMENT;
+}
+
+std::string getPath(const std::string& directory, const std::string& sourcePath, const char *extension)
+{
+	std::error_code error;
+	std::string absolute = std::filesystem::absolute(sourcePath, error).lexically_normal().string();
+	if (error)
+	{
+		absolute = sourcePath;
+	}
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : absolute)
+	{
+		hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+	}
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return (std::filesystem::path(directory) / (name + std::string(extension))).string();
+}
+
+bool write(const std::string& path, const std::vector<CacheFilePiece>& pieces)
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	// written next to the real name and renamed, so a half written cache is never picked up
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cerr << "Failed to open cache for writing: " << temporaryPath << std::endl;
+			return false;
+		}
+		static const char padding[CACHE_FILE_ALIGNMENT] = {};
+		uint64_t position = 0;
+		for (const CacheFilePiece& piece : pieces)
+		{
+			while (file && position < piece.offset)
+			{
+				size_t count = (size_t)std::min<uint64_t>(piece.offset - position, sizeof(padding));
+				file.write(padding, (std::streamsize)count);
+				position += count;
+			}
+			file.write(static_cast<const char *>(piece.data), (std::streamsize)piece.size);
+			position += piece.size;
+		}
+		if (!file)
+		{
+			std::cerr << "Failed to write cache: " << temporaryPath << std::endl;
+			file.close();
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cerr << "Failed to write cache: " << path << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+}
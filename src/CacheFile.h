@@ -0,0 +1,38 @@
+#pragma once
+#ifndef _CACHE_FILE_H_
+#define _CACHE_FILE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What the on-disk caches (MeshCache, TextureCache) have in common: one file
+// per source named after a hash of its absolute path, the source's size and
+// modification time to tell when it is stale, payloads aligned so a mapped
+// file can be uploaded in place, and writes that never leave a half written
+// cache under the real name. Each cache only lays out its own header and entries.
+constexpr uint32_t CACHE_FILE_ALIGNMENT = 16;
+
+// bytes to put at offset, which must not be before the end of the previous piece
+struct CacheFilePiece
+{
+	uint64_t offset;
+	const void *data;
+	size_t size;
+};
+
+namespace CacheFile
+{
+	// size and modification time of the source, false if it can't be read; the
+	// time is whatever the filesystem clock counts in, only ever compare it for equality
+	bool statSource(const std::string& sourcePath, uint64_t& size, int64_t& time);
+	// offset rounded up to CACHE_FILE_ALIGNMENT
+	uint64_t align(uint64_t offset);
+	// directory/<FNV-1a of the absolute source path><extension>
+	std::string getPath(const std::string& directory, const std::string& sourcePath, const char *extension);
+	// writes the pieces in order, zero padded in between, creating the directory if need be
+	bool write(const std::string& path, const std::vector<CacheFilePiece>& pieces);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "CameraPath.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+CameraPath::CameraPath() :
+	loop(false),
+	loopTime(0.0)
+{
+}
+
+bool CameraPath::loadFromFile(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open camera path: " << path << std::endl;
+		return false;
+	}
+
+	keyframes.clear();
+	loop = false;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		Keyframe keyframe;
+		if (!(fields >> keyframe.time))
+		{
+			continue;
+		}
+		if (!(fields >> keyframe.eye.x >> keyframe.eye.y >> keyframe.eye.z >> keyframe.target.x >> keyframe.target.y >> keyframe.target.z)
+			|| (!keyframes.empty() && keyframe.time <= keyframes.back().time))
+		{
+			std::cerr << path << ":" << lineNumber << ": expected an increasing time and six coordinates" << std::endl;
+			return false;
+		}
+		keyframes.push_back(keyframe);
+	}
+	if (keyframes.empty())
+	{
+		std::cerr << "Camera path has no keyframes: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void CameraPath::makeOrbit(glm::vec3 center, float radius, float height, double duration)
+{
+	// plenty for the curve to stay within a hair of the circle
+	const int count = 32;
+	keyframes.clear();
+	for (int i = 0; i < count; i++)
+	{
+		double angle = 2.0 * 3.14159265358979 * i / count;
+		Keyframe keyframe;
+		keyframe.time = duration * i / count;
+		keyframe.eye = center + glm::vec3(radius * std::sin(angle), height, radius * std::cos(angle));
+		keyframe.target = center;
+		keyframes.push_back(keyframe);
+	}
+	loop = true;
+	loopTime = duration;
+}
+
+static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u)
+{
+	return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u * u
+		+ (3.0f * p1 - p0 - 3.0f * p2 + p3) * u * u * u);
+}
+
+void CameraPath::evaluate(double time, glm::vec3& eye, glm::vec3& target) const
+{
+	if (keyframes.empty())
+	{
+		return;
+	}
+	int count = (int)keyframes.size();
+	if (loop && loopTime > 0.0)
+	{
+		time = std::fmod(time, loopTime);
+		if (time < 0.0)
+		{
+			time += loopTime;
+		}
+	}
+
+	// segment from keyframe i to i + 1, wrapping round when looping and holding the ends otherwise
+	int i = 0;
+	while (i + 1 < count && keyframes[i + 1].time <= time)
+	{
+		i++;
+	}
+	auto index = [&](int k)
+	{
+		return loop ? ((k % count) + count) % count : std::min(std::max(k, 0), count - 1);
+	};
+	double start = keyframes[i].time;
+	double end = i + 1 < count ? keyframes[i + 1].time : (loop ? loopTime : start);
+	float u = end > start ? (float)std::min(std::max((time - start) / (end - start), 0.0), 1.0) : 0.0f;
+
+	const Keyframe& k0 = keyframes[index(i - 1)];
+	const Keyframe& k1 = keyframes[index(i)];
+	const Keyframe& k2 = keyframes[index(i + 1)];
+	const Keyframe& k3 = keyframes[index(i + 2)];
+	eye = catmullRom(k0.eye, k1.eye, k2.eye, k3.eye, u);
+	target = catmullRom(k0.target, k1.target, k2.target, k3.target, u);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef _CAMERA_PATH_H_
+#define _CAMERA_PATH_H_
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Scripted camera for unattended runs. Keyframes hold a time, where the eye is
+// and what it looks at, joined up with Catmull-Rom curves. Path files have one
+// keyframe per line, "time eyeX eyeY eyeZ targetX targetY targetZ", in
+// increasing time, with # starting a comment.
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		double time;
+		glm::vec3 eye;
+		glm::vec3 target;
+	};
+	CameraPath();
+	bool loadFromFile(const std::string& path);
+	// one turn around center in duration seconds, looking at it the whole way
+	void makeOrbit(glm::vec3 center, float radius, float height, double duration);
+	void evaluate(double time, glm::vec3& eye, glm::vec3& target) const;
+	std::vector<Keyframe> keyframes;
+	// loops back to the first keyframe at loopTime instead of stopping on the last one
+	bool loop;
+	double loopTime;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "FrameDumper.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <glad/glad.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+FrameDumper::FrameDumper() :
+	format(FORMAT_PNG),
+	width(0),
+	height(0),
+	stream(nullptr)
+{
+}
+
+FrameDumper::~FrameDumper()
+{
+	close();
+}
+
+static bool endsWith(const std::string& text, const std::string& ending)
+{
+	return text.size() >= ending.size() && text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+}
+
+// the pattern goes to snprintf, so it may hold one %d (with flags and a width) for the
+// frame number and %% but nothing else
+static bool isFramePattern(const std::string& pattern)
+{
+	int conversions = 0;
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] != '%')
+		{
+			continue;
+		}
+		i++;
+		if (i < pattern.size() && pattern[i] == '%')
+		{
+			continue;
+		}
+		while (i < pattern.size() && strchr("-+ #0", pattern[i]) != nullptr)
+		{
+			i++;
+		}
+		while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9')
+		{
+			i++;
+		}
+		if (i == pattern.size() || pattern[i] != 'd')
+		{
+			return false;
+		}
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+bool FrameDumper::open(const std::string& pattern, int width, int height)
+{
+	close();
+	this->pattern = pattern;
+	this->width = width;
+	this->height = height;
+
+	if (pattern == "-" || endsWith(pattern, ".raw"))
+	{
+		format = FORMAT_RAW;
+		stream = pattern == "-" ? stdout : fopen(pattern.c_str(), "wb");
+		if (stream == nullptr)
+		{
+			std::cerr << "Failed to open frame stream " << pattern << std::endl;
+			return false;
+		}
+		pixels.resize((size_t)width * height * 4);
+		return true;
+	}
+	if (endsWith(pattern, ".png"))
+	{
+		format = FORMAT_PNG;
+		pixels.resize((size_t)width * height * 3);
+	}
+	else if (endsWith(pattern, ".hdr"))
+	{
+		format = FORMAT_HDR;
+		hdrPixels.resize((size_t)width * height * 3);
+	}
+	else
+	{
+		std::cerr << "Frame output must end in .png, .hdr or .raw: " << pattern << std::endl;
+		return false;
+	}
+	if (!isFramePattern(pattern))
+	{
+		std::cerr << "Frame output must have one %d for the frame number: " << pattern << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// GL rows start at the bottom, every format here wants the top row first
+template<typename T>
+static void flipRows(std::vector<T>& pixels, size_t rowSize, int height)
+{
+	for (int row = 0; row < height / 2; row++)
+	{
+		std::swap_ranges(pixels.begin() + row * rowSize, pixels.begin() + (row + 1) * rowSize,
+			pixels.begin() + (height - 1 - row) * rowSize);
+	}
+}
+
+bool FrameDumper::write(int frame)
+{
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	if (format == FORMAT_RAW)
+	{
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		flipRows(pixels, (size_t)width * 4, height);
+		if (fwrite(pixels.data(), 1, pixels.size(), stream) != pixels.size())
+		{
+			std::cerr << "Failed to write frame " << frame << " to " << pattern << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	char path[4096];
+	snprintf(path, sizeof(path), pattern.c_str(), frame);
+	bool written;
+	if (format == FORMAT_HDR)
+	{
+		glReadPixels(0, 0, width, height, GL_RGB, GL_FLOAT, hdrPixels.data());
+		flipRows(hdrPixels, (size_t)width * 3, height);
+		written = stbi_write_hdr(path, width, height, 3, hdrPixels.data()) != 0;
+	}
+	else
+	{
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+		flipRows(pixels, (size_t)width * 3, height);
+		written = stbi_write_png(path, width, height, 3, pixels.data(), width * 3) != 0;
+	}
+	if (!written)
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+	}
+	return written;
+}
+
+void FrameDumper::close()
+{
+	if (stream != nullptr)
+	{
+		if (stream == stdout)
+		{
+			fflush(stream);
+		}
+		else
+		{
+			fclose(stream);
+		}
+		stream = nullptr;
+	}
+}
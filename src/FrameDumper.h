@@ -0,0 +1,43 @@
+#pragma once
+#ifndef _FRAME_DUMPER_H_
+#define _FRAME_DUMPER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Saves whatever framebuffer is bound for reading after each rendered frame.
+// The format comes from the extension: .png and .hdr give one file per frame
+// through a printf style pattern (frames/frame_%04d.png), .raw appends every
+// frame to a single file as top-down RGBA8, and "-" streams raw frames to
+// stdout, so they can go straight into something like
+//   ffmpeg -f rawvideo -pix_fmt rgba -s 1280x720 -r 30 -i - out.mp4
+class FrameDumper
+{
+public:
+	FrameDumper();
+	virtual ~FrameDumper();
+	FrameDumper(const FrameDumper&) = delete;
+	FrameDumper& operator=(const FrameDumper&) = delete;
+	bool open(const std::string& pattern, int width, int height);
+	// .hdr keeps values above 1, so it wants a float colour buffer
+	bool wantsFloat() const { return format == FORMAT_HDR; }
+	bool write(int frame);
+	void close();
+private:
+	enum Format
+	{
+		FORMAT_PNG,
+		FORMAT_HDR,
+		FORMAT_RAW,
+	};
+	std::string pattern;
+	Format format;
+	int width;
+	int height;
+	FILE* stream;
+	std::vector<unsigned char> pixels;
+	std::vector<float> hdrPixels;
+};
+
+#endif
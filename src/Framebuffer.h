@@ -0,0 +1,33 @@
+#pragma once
+#ifndef _FRAMEBUFFER_H_
+#define _FRAMEBUFFER_H_
+
+#include <glad/glad.h>
+
+// Offscreen colour + depth target for rendering without a visible window.
+// Renderbuffers only, nothing samples from it; frames come back with glReadPixels.
+class Framebuffer
+{
+public:
+	Framebuffer();
+	virtual ~Framebuffer();
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+	// GL_RGBA8, or GL_RGBA16F to keep values above 1 for .hdr dumps
+	bool init(int width, int height, GLenum colorFormat = GL_RGBA8);
+	// binds it for drawing and reading and sets the viewport
+	void bind();
+	void unbind();
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	GLenum getColorFormat() const { return colorFormat; }
+private:
+	int width;
+	int height;
+	GLenum colorFormat;
+	GLuint fbo;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+};
+
+#endif
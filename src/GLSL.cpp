@@ -10,6 +10,8 @@
 #include <iostream>
 #include <cstring>
 #include <cassert>
+#include <vector>
+#include <algorithm>
 
 namespace GLSL
 {
@@ -167,4 +169,141 @@ void vertexAttribPointer(const GLint handle, GLint size, GLenum type, GLboolean
 	}
 }
 
+MultiDrawElementsIndirectProc multiDrawElementsIndirect = nullptr;
+
+bool hasExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void loadMultiDrawIndirect(GLADloadproc load)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = major > 4 || (major == 4 && minor >= 3)
+		|| (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_base_instance"));
+	multiDrawElementsIndirect = supported ? (MultiDrawElementsIndirectProc)load("glMultiDrawElementsIndirect") : nullptr;
+}
+
+namespace
+{
+	struct CallCount
+	{
+		const char *name;
+		long count;
+	};
+
+	std::vector<CallCount *> countedCalls;
+
+	template<typename Function, Function *Slot>
+	struct CountedCall;
+
+	// one of these per wrapped function, Slot is glad's pointer for it
+	template<typename Result, typename... Args, Result (APIENTRYP *Slot)(Args...)>
+	struct CountedCall<Result (APIENTRYP)(Args...), Slot>
+	{
+		static inline Result (APIENTRYP original)(Args...) = nullptr;
+		static inline CallCount count = { nullptr, 0 };
+
+		static Result APIENTRY call(Args... args)
+		{
+			count.count++;
+			return original(args...);
+		}
+
+		static void install(const char *name)
+		{
+			if (original != nullptr || *Slot == nullptr)
+			{
+				return;
+			}
+			original = *Slot;
+			*Slot = call;
+			count.name = name;
+			countedCalls.push_back(&count);
+		}
+	};
+}
+
+#define COUNT_GL_CALLS(function) CountedCall<decltype(glad_##function), &glad_##function>::install(#function)
+
+void countCalls()
+{
+	COUNT_GL_CALLS(glUseProgram);
+	COUNT_GL_CALLS(glUniform1i);
+	COUNT_GL_CALLS(glUniform1f);
+	COUNT_GL_CALLS(glUniform3f);
+	COUNT_GL_CALLS(glUniform3i);
+	COUNT_GL_CALLS(glUniform1fv);
+	COUNT_GL_CALLS(glUniform3fv);
+	COUNT_GL_CALLS(glUniformMatrix4fv);
+	COUNT_GL_CALLS(glBindVertexArray);
+	COUNT_GL_CALLS(glBindBuffer);
+	COUNT_GL_CALLS(glBindBufferBase);
+	COUNT_GL_CALLS(glBufferData);
+	COUNT_GL_CALLS(glBufferSubData);
+	COUNT_GL_CALLS(glEnableVertexAttribArray);
+	COUNT_GL_CALLS(glDisableVertexAttribArray);
+	COUNT_GL_CALLS(glVertexAttribPointer);
+	COUNT_GL_CALLS(glActiveTexture);
+	COUNT_GL_CALLS(glBindTexture);
+	COUNT_GL_CALLS(glDrawElements);
+	COUNT_GL_CALLS(glDrawElementsInstanced);
+	COUNT_GL_CALLS(glDrawElementsInstancedBaseVertex);
+	COUNT_GL_CALLS(glDrawArrays);
+	COUNT_GL_CALLS(glClear);
+	COUNT_GL_CALLS(glViewport);
+	COUNT_GL_CALLS(glBindFramebuffer);
+	COUNT_GL_CALLS(glQueryCounter);
+	COUNT_GL_CALLS(glGetQueryObjectui64v);
+	COUNT_GL_CALLS(glGetError);
+	CountedCall<decltype(multiDrawElementsIndirect), &multiDrawElementsIndirect>::install("glMultiDrawElementsIndirect");
+}
+
+void resetCallCounts()
+{
+	for (auto count : countedCalls)
+	{
+		count->count = 0;
+	}
+}
+
+long getCallCount()
+{
+	long total = 0;
+	for (auto count : countedCalls)
+	{
+		total += count->count;
+	}
+	return total;
+}
+
+void printCallCounts(long frames)
+{
+	if (countedCalls.empty() || frames <= 0)
+	{
+		return;
+	}
+	std::vector<CallCount *> sorted = countedCalls;
+	std::sort(sorted.begin(), sorted.end(), [](const CallCount *a, const CallCount *b) { return a->count > b->count; });
+	printf("GL calls per frame: %.1f\n", getCallCount() / (double)frames);
+	for (auto count : sorted)
+	{
+		if (count->count > 0)
+		{
+			printf("  %-28s %10.1f\n", count->name, count->count / (double)frames);
+		}
+	}
+}
+
 }
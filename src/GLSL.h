@@ -11,6 +11,9 @@
 #include <glad/glad.h>
 #include <string>
 
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
 
 namespace GLSL
 {
@@ -25,6 +28,23 @@ namespace GLSL
 	void enableVertexAttribArray(const GLint handle);
 	void disableVertexAttribArray(const GLint handle);
 	void vertexAttribPointer(const GLint handle, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+	// Swaps the glad pointers of the functions the renderer calls every frame for
+	// ones that count their calls. Call after gladLoadGL, it can't be undone.
+	void countCalls();
+	void resetCallCounts();
+	long getCallCount();
+	// calls per frame of each counted function, busiest first
+	void printCallCounts(long frames);
+
+	// glMultiDrawElementsIndirect with base instances, from GL 4.3 or
+	// ARB_multi_draw_indirect + ARB_base_instance, which glad's 3.3 loader doesn't
+	// know about. Null when the context can't do it.
+	typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+	extern MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+	// call after gladLoadGL, with the context current
+	void loadMultiDrawIndirect(GLADloadproc load);
+	// whether the current context lists the extension
+	bool hasExtension(const char *name);
 }
 
 
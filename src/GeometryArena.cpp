@@ -0,0 +1,205 @@
+#include "GeometryArena.h"
+#include <algorithm>
+
+#include "Program.h"
+
+// big enough for every mesh the scene loads without growing
+static const size_t INITIAL_VERTEX_BYTES = 8 << 20;
+static const size_t INITIAL_INDEX_BYTES = 2 << 20;
+
+// a new buffer of newCapacity bytes holding the first used bytes of buffer, which is deleted
+static GLuint growBuffer(GLuint buffer, size_t used, size_t newCapacity)
+{
+	GLuint bigger;
+	glGenBuffers(1, &bigger);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+	if (buffer != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return bigger;
+}
+
+GeometryArena& GeometryArena::get()
+{
+	// never destroyed, the context is gone by the time statics are
+	static GeometryArena *arena = new GeometryArena();
+	return *arena;
+}
+
+GeometryArena::GeometryArena() :
+	boundPool(-1),
+	instanceIndexBuffer(0),
+	instanceCapacity(0),
+	instanceDivisor(1)
+{
+}
+
+int GeometryArena::findPool(const VertexFormat& format)
+{
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		if (pools[i].format == format)
+		{
+			return (int)i;
+		}
+	}
+	Pool pool;
+	pool.format = format;
+	glGenVertexArrays(1, &pool.vao);
+	pools.push_back(pool);
+	return (int)pools.size() - 1;
+}
+
+void GeometryArena::setUpVertexArray(Pool& pool)
+{
+	GLsizei stride = (GLsizei)pool.format.getStride();
+	glBindVertexArray(pool.vao);
+	boundPool = -1;
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+	// every program shares simple_vert.glsl, so the attribute locations are fixed
+	glEnableVertexAttribArray(ATTRIBUTE_VERT_POS);
+	glVertexAttribPointer(ATTRIBUTE_VERT_POS, 3, GL_FLOAT, GL_FALSE, stride, (const void *)0);
+	glEnableVertexAttribArray(ATTRIBUTE_VERT_NOR);
+	if (pool.format.packedNormals)
+	{
+		glVertexAttribPointer(ATTRIBUTE_VERT_NOR, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (const void *)pool.format.getNormalOffset());
+	}
+	else
+	{
+		glVertexAttribPointer(ATTRIBUTE_VERT_NOR, 3, GL_FLOAT, GL_FALSE, stride, (const void *)pool.format.getNormalOffset());
+	}
+	glEnableVertexAttribArray(ATTRIBUTE_VERT_TEX);
+	glVertexAttribPointer(ATTRIBUTE_VERT_TEX, 2, pool.format.halfTexCoords ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (const void *)pool.format.getTexOffset());
+	if (instanceIndexBuffer != 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+		glEnableVertexAttribArray(ATTRIBUTE_VERT_INSTANCE);
+		glVertexAttribIPointer(ATTRIBUTE_VERT_INSTANCE, 1, GL_INT, 0, (const void *)0);
+		glVertexAttribDivisor(ATTRIBUTE_VERT_INSTANCE, instanceDivisor);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+	// the element buffer binding belongs to the VAO, so unbind that first
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::Range GeometryArena::add(const VertexFormat& format, const void *vertices, size_t vertexCount, const void *indices, size_t indexCount, size_t indexSize)
+{
+	Range range;
+	range.pool = findPool(format);
+	Pool& pool = pools[range.pool];
+	size_t stride = format.getStride();
+	// a 32 bit range after a 16 bit one needs realigning
+	size_t indexOffset = (pool.indexBytes + indexSize - 1) / indexSize * indexSize;
+
+	bool grown = false;
+	if ((pool.vertexCount + vertexCount) * stride > pool.vertexCapacity)
+	{
+		size_t capacity = std::max(std::max(INITIAL_VERTEX_BYTES, 2 * pool.vertexCapacity), (pool.vertexCount + vertexCount) * stride);
+		pool.vertexBuffer = growBuffer(pool.vertexBuffer, pool.vertexCount * stride, capacity);
+		pool.vertexCapacity = capacity;
+		grown = true;
+	}
+	if (indexOffset + indexCount * indexSize > pool.indexCapacity)
+	{
+		size_t capacity = std::max(std::max(INITIAL_INDEX_BYTES, 2 * pool.indexCapacity), indexOffset + indexCount * indexSize);
+		pool.indexBuffer = growBuffer(pool.indexBuffer, pool.indexBytes, capacity);
+		pool.indexCapacity = capacity;
+		grown = true;
+	}
+	if (grown)
+	{
+		setUpVertexArray(pool);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, pool.vertexCount * stride, vertexCount * stride, vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// GL_COPY_WRITE_BUFFER so whatever VAO is bound keeps its element buffer
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, indexCount * indexSize, indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	range.baseVertex = (GLint)pool.vertexCount;
+	range.indexOffset = indexOffset;
+	pool.vertexCount += vertexCount;
+	pool.indexBytes = indexOffset + indexCount * indexSize;
+	return range;
+}
+
+void GeometryArena::bind(int pool)
+{
+	if (pool != boundPool)
+	{
+		glBindVertexArray(pools[pool].vao);
+		boundPool = pool;
+	}
+}
+
+void GeometryArena::reserveInstances(size_t count)
+{
+	if (count <= instanceCapacity)
+	{
+		return;
+	}
+	instanceCapacity = std::max(std::max<size_t>(1024, 2 * instanceCapacity), count);
+	std::vector<GLint> indices(instanceCapacity);
+	for (size_t i = 0; i < instanceCapacity; i++)
+	{
+		indices[i] = (GLint)i;
+	}
+	if (instanceIndexBuffer == 0)
+	{
+		glGenBuffers(1, &instanceIndexBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLint), indices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (auto& pool : pools)
+	{
+		setUpVertexArray(pool);
+	}
+}
+
+void GeometryArena::setInstanceDivisor(GLuint divisor)
+{
+	if (divisor == instanceDivisor)
+	{
+		return;
+	}
+	instanceDivisor = divisor;
+	for (auto& pool : pools)
+	{
+		glBindVertexArray(pool.vao);
+		glVertexAttribDivisor(ATTRIBUTE_VERT_INSTANCE, divisor);
+	}
+	glBindVertexArray(0);
+	boundPool = -1;
+}
+
+size_t GeometryArena::getUsedBytes() const
+{
+	size_t bytes = 0;
+	for (auto& pool : pools)
+	{
+		bytes += pool.vertexCount * pool.format.getStride() + pool.indexBytes;
+	}
+	return bytes;
+}
+
+size_t GeometryArena::getCapacityBytes() const
+{
+	size_t bytes = 0;
+	for (auto& pool : pools)
+	{
+		bytes += pool.vertexCapacity + pool.indexCapacity;
+	}
+	return bytes;
+}
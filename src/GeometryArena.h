@@ -0,0 +1,78 @@
+#pragma once
+#ifndef _GEOMETRY_ARENA_H_
+#define _GEOMETRY_ARENA_H_
+
+#include <vector>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Vertices and indices of every static mesh, suballocated from a few large
+// buffers so the whole scene draws from one VAO with base vertex draws. Meshes
+// whose vertices share a VertexFormat go in the same pool; a pool's buffers
+// grow by copying on the GPU when they fill up. Indices are stored relative to
+// the mesh's first vertex, 16 bit ones and 32 bit ones side by side.
+class GeometryArena
+{
+public:
+	// position as 3 floats, then normal and texcoord
+	struct VertexFormat
+	{
+		// GL_INT_2_10_10_10_REV instead of 3 floats
+		bool packedNormals;
+		// 2 halves instead of 2 floats
+		bool halfTexCoords;
+		size_t getNormalOffset() const { return 3 * sizeof(float); }
+		size_t getTexOffset() const { return getNormalOffset() + (packedNormals ? 4 : 3 * sizeof(float)); }
+		size_t getStride() const { return getTexOffset() + (halfTexCoords ? 4 : 2 * sizeof(float)); }
+		bool operator==(const VertexFormat& other) const { return packedNormals == other.packedNormals && halfTexCoords == other.halfTexCoords; }
+	};
+	struct Pool
+	{
+		VertexFormat format;
+		GLuint vao = 0;
+		GLuint vertexBuffer = 0;
+		GLuint indexBuffer = 0;
+		// in vertices and in bytes respectively
+		size_t vertexCount = 0, vertexCapacity = 0;
+		size_t indexBytes = 0, indexCapacity = 0;
+	};
+	// where add() put a mesh
+	struct Range
+	{
+		int pool;
+		GLint baseVertex;
+		// in bytes, aligned to the index size
+		size_t indexOffset;
+	};
+	// the one every Shape goes in; nothing is created until the first add()
+	static GeometryArena& get();
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+	// vertices are vertexCount * format.getStride() bytes, indices indexCount of indexSize (2 or 4)
+	Range add(const VertexFormat& format, const void *vertices, size_t vertexCount, const void *indices, size_t indexCount, size_t indexSize);
+	// binds the pool's VAO, unless it already is; nothing else binds VAOs
+	void bind(int pool);
+	// vertInstance in every VAO reads a buffer of 0, 1, 2..., so it comes out
+	// as baseInstance + gl_InstanceID / divisor; grows that to at least count
+	void reserveInstances(size_t count);
+	// 2 when both images come from one draw, see RenderQueue::singlePass
+	void setInstanceDivisor(GLuint divisor);
+	const Pool& getPool(int pool) const { return pools[pool]; }
+	int getPoolCount() const { return (int)pools.size(); }
+	// vertex and index bytes used, and allocated
+	size_t getUsedBytes() const;
+	size_t getCapacityBytes() const;
+private:
+	GeometryArena();
+	int findPool(const VertexFormat& format);
+	// re-points the VAO at the pool's current buffers
+	void setUpVertexArray(Pool& pool);
+	std::vector<Pool> pools;
+	int boundPool;
+	GLuint instanceIndexBuffer;
+	size_t instanceCapacity;
+	GLuint instanceDivisor;
+};
+
+#endif
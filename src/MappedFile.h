@@ -0,0 +1,32 @@
+#pragma once
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The pages are backed by the file
+// itself, so large baked assets can be handed straight to the GPU without a
+// heap copy and without counting against the process' private memory.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+	const unsigned char* getData() const { return data; }
+	size_t getSize() const { return size; }
+private:
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+#endif
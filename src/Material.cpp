@@ -3,8 +3,11 @@
 #include "Material.h"
 
 Material::Material(int programIndex) :
-	programIndex(programIndex)
+	programIndex(programIndex),
+	profileSection(-1)
 {
+	static unsigned nextSortId = 0;
+	sortId = nextSortId++;
 }
 
 Material::~Material()
@@ -14,7 +17,6 @@ Material::~Material()
 void Material::apply(std::shared_ptr<Scene> scene)
 {
 	scene->swapToShaderProgram(programIndex);
-	scene->blackHole->bind(scene->getCurrentShaderProgram()->getUniform("blackHoleMesh"));
 }
 
 SolidColorMaterial::SolidColorMaterial(int programIndex, float r, float g, float b) :
@@ -29,7 +31,7 @@ void SolidColorMaterial::apply(std::shared_ptr<Scene> scene)
 {
 	Material::apply(scene);
 	auto currentProgram = scene->getCurrentShaderProgram();
-	glUniform3f(currentProgram->getUniform("solidColor"), r, g, b);
+	glUniform3f(currentProgram->getUniform(UNIFORM_SOLID_COLOR), r, g, b);
 }
 
 BlinnPhongMaterial::BlinnPhongMaterial(int programIndex, glm::vec3 matAmb, glm::vec3 matDif, glm::vec3 matSpec, float specIntensity) :
@@ -45,10 +47,10 @@ void BlinnPhongMaterial::apply(std::shared_ptr<Scene> scene)
 {
 	Material::apply(scene);
 	auto currentProgram = scene->getCurrentShaderProgram();
-	glUniform3f(currentProgram->getUniform("matAmb"), matAmb.r, matAmb.g, matAmb.b);
-	glUniform3f(currentProgram->getUniform("matDif"), matDif.r, matDif.g, matDif.b);
-	glUniform3f(currentProgram->getUniform("matSpec"), matSpec.r, matSpec.g, matSpec.b);
-	glUniform1f(currentProgram->getUniform("specIntensity"), specIntensity);
+	glUniform3f(currentProgram->getUniform(UNIFORM_MAT_AMB), matAmb.r, matAmb.g, matAmb.b);
+	glUniform3f(currentProgram->getUniform(UNIFORM_MAT_DIF), matDif.r, matDif.g, matDif.b);
+	glUniform3f(currentProgram->getUniform(UNIFORM_MAT_SPEC), matSpec.r, matSpec.g, matSpec.b);
+	glUniform1f(currentProgram->getUniform(UNIFORM_SPEC_INTENSITY), specIntensity);
 }
 
 TexBlinnPhongMaterial::TexBlinnPhongMaterial(int programIndex, std::shared_ptr<Texture> texture, float amb, float dif, float spec, float specIntensity) :
@@ -65,9 +67,9 @@ void TexBlinnPhongMaterial::apply(std::shared_ptr<Scene> scene)
 {
 	Material::apply(scene);
 	auto currentProgram = scene->getCurrentShaderProgram();
-	texture->bind(currentProgram->getUniform("Texture0"));
-	glUniform1f(currentProgram->getUniform("amb"), amb);
-	glUniform1f(currentProgram->getUniform("dif"), dif);
-	glUniform1f(currentProgram->getUniform("spec"), spec);
-	glUniform1f(currentProgram->getUniform("specIntensity"), specIntensity);
+	texture->bind(currentProgram->getUniform(UNIFORM_TEXTURE0));
+	glUniform1f(currentProgram->getUniform(UNIFORM_AMB), amb);
+	glUniform1f(currentProgram->getUniform(UNIFORM_DIF), dif);
+	glUniform1f(currentProgram->getUniform(UNIFORM_SPEC), spec);
+	glUniform1f(currentProgram->getUniform(UNIFORM_SPEC_INTENSITY), specIntensity);
 }
@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 #include <glm/gtc/matrix_transform.hpp>
 
 class Scene;
@@ -16,6 +17,11 @@ public:
 	Material(int programIndex);
 	virtual ~Material();
 	int programIndex;
+	// shows up in profiles
+	std::string name;
+	int profileSection;
+	// unique per material, orders draws in the render queue
+	unsigned sortId;
 	virtual void apply(std::shared_ptr<Scene> scene);
 };
 
@@ -0,0 +1,133 @@
+#include "MeshCache.h"
+#include <iostream>
+#include <cstring>
+
+#include "CacheFile.h"
+#include "MappedFile.h"
+
+namespace MeshCache
+{
+
+std::string directory;
+
+std::string getCachePath(const std::string& sourcePath)
+{
+	return CacheFile::getPath(directory, sourcePath, ".bhmesh");
+}
+
+bool load(const std::string& sourcePath, MappedFile& file, std::vector<PackedShape>& shapes)
+{
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (directory.empty() || !CacheFile::statSource(sourcePath, sourceSize, sourceTime) || !file.open(getCachePath(sourcePath)))
+	{
+		return false;
+	}
+
+	const unsigned char* data = file.getData();
+	size_t size = file.getSize();
+	MeshCacheHeader header;
+	if (size < sizeof(header))
+	{
+		file.close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+	size_t entriesOffset = sizeof(header) + header.pathLength;
+	bool current = std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0
+		&& header.version == MESH_CACHE_VERSION
+		&& header.sourceSize == sourceSize && header.sourceTime == sourceTime
+		&& header.compactVertices == (uint32_t)Shape::compactVertices
+		&& header.normalWeighting == (uint32_t)Shape::normalWeighting
+		&& entriesOffset + (uint64_t)header.shapeCount * sizeof(MeshCacheShape) <= size
+		&& std::string((const char*)data + sizeof(header), header.pathLength) == sourcePath;
+	if (!current)
+	{
+		file.close();
+		return false;
+	}
+
+	shapes.clear();
+	for (uint32_t i = 0; i < header.shapeCount; i++)
+	{
+		MeshCacheShape entry;
+		std::memcpy(&entry, data + entriesOffset + i * sizeof(entry), sizeof(entry));
+		PackedShape packed;
+		packed.format.packedNormals = entry.packedNormals != 0;
+		packed.format.halfTexCoords = entry.halfTexCoords != 0;
+		packed.hasNormals = entry.hasNormals != 0;
+		packed.textured = entry.textured != 0;
+		packed.min = glm::vec3(entry.min[0], entry.min[1], entry.min[2]);
+		packed.max = glm::vec3(entry.max[0], entry.max[1], entry.max[2]);
+		packed.vertexCount = entry.vertexCount;
+		packed.indexCount = entry.indexCount;
+		packed.indexSize = entry.indexSize;
+		uint64_t vertexBytes = (uint64_t)entry.vertexCount * packed.format.getStride();
+		uint64_t indexBytes = (uint64_t)entry.indexCount * entry.indexSize;
+		if ((entry.indexSize != 2 && entry.indexSize != 4)
+			|| entry.vertexOffset + vertexBytes > size || entry.indexOffset + indexBytes > size)
+		{
+			std::cerr << "Corrupt mesh cache for " << sourcePath << ", rebuilding it" << std::endl;
+			shapes.clear();
+			file.close();
+			return false;
+		}
+		packed.vertices = data + entry.vertexOffset;
+		packed.indices = data + entry.indexOffset;
+		shapes.push_back(packed);
+	}
+	return true;
+}
+
+bool save(const std::string& sourcePath, const std::vector<PackedShape>& shapes)
+{
+	MeshCacheHeader header = {};
+	if (directory.empty() || !CacheFile::statSource(sourcePath, header.sourceSize, header.sourceTime))
+	{
+		return false;
+	}
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.shapeCount = (uint32_t)shapes.size();
+	header.compactVertices = Shape::compactVertices;
+	header.normalWeighting = Shape::normalWeighting;
+	header.pathLength = (uint32_t)sourcePath.size();
+
+	std::vector<MeshCacheShape> entries(shapes.size());
+	uint64_t offset = sizeof(header) + sourcePath.size() + shapes.size() * sizeof(MeshCacheShape);
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		const PackedShape& packed = shapes[i];
+		MeshCacheShape& entry = entries[i];
+		entry = {};
+		entry.vertexCount = (uint32_t)packed.vertexCount;
+		entry.indexCount = (uint32_t)packed.indexCount;
+		entry.indexSize = (uint32_t)packed.indexSize;
+		entry.packedNormals = packed.format.packedNormals;
+		entry.halfTexCoords = packed.format.halfTexCoords;
+		entry.hasNormals = packed.hasNormals;
+		entry.textured = packed.textured;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			entry.min[axis] = packed.min[axis];
+			entry.max[axis] = packed.max[axis];
+		}
+		entry.vertexOffset = CacheFile::align(offset);
+		entry.indexOffset = CacheFile::align(entry.vertexOffset + packed.vertexCount * packed.format.getStride());
+		offset = entry.indexOffset + packed.indexCount * packed.indexSize;
+	}
+
+	std::vector<CacheFilePiece> pieces = {
+		{ 0, &header, sizeof(header) },
+		{ sizeof(header), sourcePath.data(), sourcePath.size() },
+		{ sizeof(header) + sourcePath.size(), entries.data(), entries.size() * sizeof(MeshCacheShape) }
+	};
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		pieces.push_back({ entries[i].vertexOffset, shapes[i].vertices, shapes[i].vertexCount * shapes[i].format.getStride() });
+		pieces.push_back({ entries[i].indexOffset, shapes[i].indices, shapes[i].indexCount * shapes[i].indexSize });
+	}
+	return CacheFile::write(getCachePath(sourcePath), pieces);
+}
+
+}
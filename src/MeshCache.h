@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Shape.h"
+
+class MappedFile;
+
+// Binary cache of a loaded .obj (.bhmesh). The header is followed by the source
+// path, one entry per shape and then every shape's vertices and indices exactly
+// as Shape::pack leaves them, so a hit is a mapping and an upload with no
+// parsing. The source's size and modification time and the vertex settings it
+// was packed with are recorded; if any of them differ the cache is rebuilt.
+constexpr char MESH_CACHE_MAGIC[8] = { 'B', 'H', 'M', 'E', 'S', 'H', '\r', '\n' };
+constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+struct MeshCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t shapeCount;
+	uint64_t sourceSize;
+	// whatever the filesystem clock counts in, only ever compared for equality
+	int64_t sourceTime;
+	// Shape::compactVertices and Shape::normalWeighting when it was written
+	uint32_t compactVertices;
+	uint32_t pathLength;
+	uint32_t normalWeighting;
+	uint32_t reserved;
+};
+
+struct MeshCacheShape
+{
+	// from the start of the file, aligned to CACHE_FILE_ALIGNMENT
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	uint32_t packedNormals;
+	uint32_t halfTexCoords;
+	uint32_t hasNormals;
+	uint32_t textured;
+	float min[3];
+	float max[3];
+	uint32_t reserved;
+};
+
+static_assert(sizeof(MeshCacheHeader) == 48, "MeshCacheHeader layout changed");
+static_assert(sizeof(MeshCacheShape) == 72, "MeshCacheShape layout changed");
+
+namespace MeshCache
+{
+	// where the caches go, one file per source named after a hash of its path;
+	// empty turns caching off
+	extern std::string directory;
+	std::string getCachePath(const std::string& sourcePath);
+	// maps the cache for sourcePath if it is there and current; the shapes point
+	// into file, so keep it open until they are uploaded
+	bool load(const std::string& sourcePath, MappedFile& file, std::vector<PackedShape>& shapes);
+	bool save(const std::string& sourcePath, const std::vector<PackedShape>& shapes);
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include <iostream>
+#include <chrono>
 
 #include "Model.h"
 #include "Program.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader/tiny_obj_loader.h>
@@ -10,12 +13,55 @@
 Model::Model() :
 	shapes(std::vector<std::shared_ptr<Shape>>()),
 	flipNormals(false),
-	useBlackHole(true)
+	useBlackHole(true),
+	loadTime(0.0),
+	uploadTime(0.0),
+	fromCache(false)
 {
+	static unsigned nextSortId = 0;
+	sortId = nextSortId++;
 }
 
 Model::Model(const std::string& path) :
 	Model()
+{
+	finish(*prepare(path));
+}
+
+std::unique_ptr<ModelData> Model::prepare(const std::string& path)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto data = std::make_unique<ModelData>();
+	data->fromCache = MeshCache::load(path, data->cacheFile, data->packed);
+	if (data->fromCache)
+	{
+		for (size_t i = 0; i < data->packed.size(); i++)
+		{
+			data->shapes.push_back(std::make_shared<Shape>(true));
+		}
+	}
+	else
+	{
+		loadObj(path, *data);
+	}
+	data->prepareTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return data;
+}
+
+void Model::finish(ModelData& data)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < data.shapes.size(); i++)
+	{
+		data.shapes[i]->upload(data.packed[i]);
+		addShape(data.shapes[i]);
+	}
+	fromCache = data.fromCache;
+	uploadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	loadTime = data.prepareTime + uploadTime;
+}
+
+void Model::loadObj(const std::string& path, ModelData& data)
 {
 	std::vector<tinyobj::shape_t> TOshapes;
 	std::vector<tinyobj::material_t> objMaterials;
@@ -28,14 +74,17 @@ Model::Model(const std::string& path) :
 		std::cerr << errStr << std::endl;
 	}
 	else {
-		for (auto& toShape : TOshapes)
+		data.vertexData.resize(TOshapes.size());
+		data.indexData.resize(TOshapes.size());
+		for (size_t i = 0; i < TOshapes.size(); i++)
 		{
 			auto shape = std::make_shared<Shape>(true);
-			shape->createShape(toShape);
+			shape->createShape(TOshapes[i]);
 			shape->measure();
-			shape->init();
-			addShape(shape);
+			data.packed.push_back(shape->pack(data.vertexData[i], data.indexData[i]));
+			data.shapes.push_back(shape);
 		}
+		MeshCache::save(path, data.packed);
 	}
 }
 
@@ -45,20 +94,36 @@ Model::~Model()
 
 void Model::draw(const std::shared_ptr<Program> prog) const
 {
-	glUniform1i(prog->getUniform("flipNormals"), flipNormals);
-	glUniform1i(prog->getUniform("useBlackHole"), useBlackHole);
-	glUniform1i(prog->getUniform("blackHoleSecondary"), false);
+	draw(prog, false);
+	draw(prog, true);
+}
+
+void Model::draw(const std::shared_ptr<Program> prog, bool secondary, int instances) const
+{
+	applyUniforms(prog, secondary, false);
 	for (auto& shape : shapes)
 	{
-		shape->draw(prog);
+		shape->draw(prog, instances);
 	}
-	glUniform1i(prog->getUniform("blackHoleSecondary"), true);
+}
+
+void Model::drawBothImages(const std::shared_ptr<Program> prog, int instances) const
+{
+	applyUniforms(prog, false, true);
 	for (auto& shape : shapes)
 	{
-		shape->draw(prog);
+		shape->draw(prog, 2 * instances);
 	}
 }
 
+void Model::applyUniforms(const std::shared_ptr<Program> prog, bool secondary, bool bothImages) const
+{
+	glUniform1i(prog->getUniform(UNIFORM_FLIP_NORMALS), flipNormals);
+	glUniform1i(prog->getUniform(UNIFORM_USE_BLACK_HOLE), useBlackHole);
+	glUniform1i(prog->getUniform(UNIFORM_BLACK_HOLE_SECONDARY), secondary);
+	glUniform1i(prog->getUniform(UNIFORM_BOTH_IMAGES), bothImages);
+}
+
 void Model::addShape(std::shared_ptr<Shape> shape)
 {
 	shapes.push_back(shape);
@@ -97,3 +162,23 @@ glm::vec3 Model::getMax()
 
 	return max;
 }
+
+size_t Model::getVertexCount() const
+{
+	size_t count = 0;
+	for (auto& shape : shapes)
+	{
+		count += shape->getVertexCount();
+	}
+	return count;
+}
+
+MeshFootprint Model::getFootprint() const
+{
+	MeshFootprint footprint;
+	for (auto& shape : shapes)
+	{
+		footprint += shape->getFootprint();
+	}
+	return footprint;
+}
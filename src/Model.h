@@ -5,20 +5,58 @@
 #include <vector>
 #include <memory>
 #include "Shape.h"
+#include "MappedFile.h"
+
+// everything loading a model does before touching GL, see Model::prepare
+struct ModelData
+{
+	std::vector<std::shared_ptr<Shape>> shapes;
+	// one per shape, pointing into cacheFile or vertexData and indexData
+	std::vector<PackedShape> packed;
+	MappedFile cacheFile;
+	std::vector<std::vector<unsigned char>> vertexData;
+	std::vector<std::vector<unsigned char>> indexData;
+	bool fromCache = false;
+	double prepareTime = 0.0;
+};
 
 class Model
 {
 public:
 	Model();
+	// prepare() and finish() in one go
 	Model(const std::string& path);
+	// maps the MeshCache or parses and packs the .obj; no GL, so any thread will do
+	static std::unique_ptr<ModelData> prepare(const std::string& path);
+	// uploads the shapes to the GeometryArena and adds them, on the GL thread
+	void finish(ModelData& data);
 	virtual ~Model();
 	void draw(const std::shared_ptr<Program> prog) const;
+	// just the primary or just the secondary image, of instances copies
+	void draw(const std::shared_ptr<Program> prog, bool secondary, int instances = 1) const;
+	// both images in one draw per shape, as twice the instances
+	void drawBothImages(const std::shared_ptr<Program> prog, int instances = 1) const;
+	// what the draws above set before drawing, for drawing the shapes some other way
+	void applyUniforms(const std::shared_ptr<Program> prog, bool secondary, bool bothImages) const;
 	void addShape(std::shared_ptr<Shape> shape);
 	glm::vec3 getMin();
 	glm::vec3 getMax();
+	size_t getVertexCount() const;
+	// summed over every shape
+	MeshFootprint getFootprint() const;
 	std::vector<std::shared_ptr<Shape>> shapes;
 	bool flipNormals;
 	bool useBlackHole;
+	// unique per model, orders draws in the render queue
+	unsigned sortId;
+	// ms spent in prepare() and finish() together and in finish() alone, and
+	// whether it came from the MeshCache
+	double loadTime;
+	double uploadTime;
+	bool fromCache;
+private:
+	// parses the .obj and writes the cache for next time
+	static void loadObj(const std::string& path, ModelData& data);
 };
 
 #endif
@@ -0,0 +1,40 @@
+#include "ModelLoader.h"
+#include <chrono>
+
+ModelLoader::ModelLoader(unsigned threadCount) :
+	pool(threadCount)
+{
+}
+
+std::shared_ptr<Model> ModelLoader::load(const std::string& path)
+{
+	auto model = std::make_shared<Model>();
+	pending.push_back({ model, pool.submit([path]() { return Model::prepare(path); }) });
+	return model;
+}
+
+size_t ModelLoader::poll()
+{
+	for (size_t i = 0; i < pending.size();)
+	{
+		if (pending[i].data.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			pending[i].model->finish(*pending[i].data.get());
+			pending.erase(pending.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return pending.size();
+}
+
+void ModelLoader::finishAll()
+{
+	while (poll() > 0)
+	{
+		// nothing to upload yet, give the workers a moment instead of spinning
+		pending.front().data.wait_for(std::chrono::milliseconds(1));
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _MODEL_LOADER_H_
+#define _MODEL_LOADER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+
+#include "Model.h"
+#include "ThreadPool.h"
+
+// Loads models on a ThreadPool. Workers map the mesh cache or parse, build
+// normals and pack the .obj (Model::prepare), and the GL thread only uploads
+// each one (Model::finish) as it comes back, in whatever order that is.
+class ModelLoader
+{
+public:
+	// zero threads means one per hardware thread
+	ModelLoader(unsigned threadCount = 0);
+	ModelLoader(const ModelLoader&) = delete;
+	ModelLoader& operator=(const ModelLoader&) = delete;
+	// starts loading straight away; the model stays empty until poll or finishAll uploads it
+	std::shared_ptr<Model> load(const std::string& path);
+	// uploads every model that is ready, on the GL thread, and returns how many are still loading
+	size_t poll();
+	// uploads the rest as they arrive
+	void finishAll();
+	size_t getPendingCount() const { return pending.size(); }
+private:
+	struct Pending
+	{
+		std::shared_ptr<Model> model;
+		std::future<std::unique_ptr<ModelData>> data;
+	};
+	ThreadPool pool;
+	std::vector<Pending> pending;
+};
+
+#endif
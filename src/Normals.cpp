@@ -0,0 +1,235 @@
+#include "Normals.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NORMALS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+// below this many faces handing out work costs more than it saves
+const size_t PARALLEL_FACES = 1 << 16;
+// vertices or faces per task; a chunk of vertex sums (3 floats each) stays in L1
+const size_t CHUNK_SIZE = 2048;
+
+// angle between two edges, zero if either has no length
+float cornerAngle(const float *a, const float *b)
+{
+	float lengths = std::sqrt((a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2]));
+	if (lengths <= 0.0f)
+	{
+		return 0.0f;
+	}
+	float cosine = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / lengths;
+	return std::acos(std::min(1.0f, std::max(-1.0f, cosine)));
+}
+
+// scales every (x, y, z) to unit length in place, leaving zero ones at zero
+void normalize(float *x, float *y, float *z, size_t count)
+{
+	size_t i = 0;
+#ifdef NORMALS_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps(x + i);
+		__m128 vy = _mm_loadu_ps(y + i);
+		__m128 vz = _mm_loadu_ps(z + i);
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		// a full divide rather than rsqrt, the normals get packed to 10 bits but float vertices keep all of them
+		__m128 scale = _mm_and_ps(_mm_cmpgt_ps(lengthSquared, zero), _mm_div_ps(one, _mm_sqrt_ps(lengthSquared)));
+		_mm_storeu_ps(x + i, _mm_mul_ps(vx, scale));
+		_mm_storeu_ps(y + i, _mm_mul_ps(vy, scale));
+		_mm_storeu_ps(z + i, _mm_mul_ps(vz, scale));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float lengthSquared = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+		float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+		x[i] *= scale;
+		y[i] *= scale;
+		z[i] *= scale;
+	}
+}
+
+}
+
+namespace Normals
+{
+
+void generate(const float *positions, size_t vertexCount, const unsigned int *indices, size_t indexCount,
+	float *normals, NormalWeighting weighting, ThreadPool *pool)
+{
+	size_t faceCount = indexCount / 3;
+	// the face's weighted normal, and for angle weighting its angle at each corner
+	auto faceNormal = [&](size_t face, float *normal, float *angles)
+	{
+		const float *vert0 = positions + 3 * (size_t)indices[3 * face];
+		const float *vert1 = positions + 3 * (size_t)indices[3 * face + 1];
+		const float *vert2 = positions + 3 * (size_t)indices[3 * face + 2];
+		float edge1[3] = { vert1[0] - vert0[0], vert1[1] - vert0[1], vert1[2] - vert0[2] };
+		float edge2[3] = { vert2[0] - vert0[0], vert2[1] - vert0[1], vert2[2] - vert0[2] };
+		normal[0] = edge1[1] * edge2[2] - edge1[2] * edge2[1];
+		normal[1] = edge1[2] * edge2[0] - edge1[0] * edge2[2];
+		normal[2] = edge1[0] * edge2[1] - edge1[1] * edge2[0];
+		// the cross product is already twice the area
+		if (weighting != NORMAL_WEIGHT_AREA)
+		{
+			float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float scale = length > 0.0f ? 1.0f / length : 0.0f;
+			normal[0] *= scale;
+			normal[1] *= scale;
+			normal[2] *= scale;
+		}
+		if (weighting == NORMAL_WEIGHT_ANGLE)
+		{
+			float edge3[3] = { vert2[0] - vert1[0], vert2[1] - vert1[1], vert2[2] - vert1[2] };
+			float back1[3] = { -edge1[0], -edge1[1], -edge1[2] };
+			float back2[3] = { -edge2[0], -edge2[1], -edge2[2] };
+			float back3[3] = { -edge3[0], -edge3[1], -edge3[2] };
+			angles[0] = cornerAngle(edge1, edge2);
+			angles[1] = cornerAngle(back1, edge3);
+			angles[2] = cornerAngle(back2, back3);
+		}
+		else
+		{
+			angles[0] = angles[1] = angles[2] = 1.0f;
+		}
+	};
+
+	if (pool == nullptr || pool->getThreadCount() < 2 || faceCount < PARALLEL_FACES)
+	{
+		// one thread can scatter straight into the sums, in the same face order the
+		// gather below ends up with, and skip building the adjacency list
+		std::vector<float> x(vertexCount, 0.0f), y(vertexCount, 0.0f), z(vertexCount, 0.0f);
+		for (size_t face = 0; face < faceCount; face++)
+		{
+			float normal[3], angles[3];
+			faceNormal(face, normal, angles);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = indices[3 * face + corner];
+				x[vertex] += normal[0] * angles[corner];
+				y[vertex] += normal[1] * angles[corner];
+				z[vertex] += normal[2] * angles[corner];
+			}
+		}
+		normalize(x.data(), y.data(), z.data(), vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			normals[3 * vertex] = x[vertex];
+			normals[3 * vertex + 1] = y[vertex];
+			normals[3 * vertex + 2] = z[vertex];
+		}
+		return;
+	}
+
+	// each face's normal as x, y and z arrays, and each corner's weight
+	std::vector<float> faceX(faceCount), faceY(faceCount), faceZ(faceCount);
+	std::vector<float> cornerWeights(weighting == NORMAL_WEIGHT_ANGLE ? indexCount : 0);
+	ThreadPool::forEachRange(pool, faceCount, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		for (size_t face = begin; face < end; face++)
+		{
+			float normal[3], angles[3];
+			faceNormal(face, normal, angles);
+			faceX[face] = normal[0];
+			faceY[face] = normal[1];
+			faceZ[face] = normal[2];
+			if (!cornerWeights.empty())
+			{
+				std::copy(angles, angles + 3, cornerWeights.begin() + 3 * face);
+			}
+		}
+	});
+
+	// vertex to corner adjacency, in corner order so the sums come out the same as a scatter would
+	std::vector<unsigned int> firstCorner(vertexCount + 1, 0);
+	for (size_t i = 0; i < faceCount * 3; i++)
+	{
+		firstCorner[indices[i] + 1]++;
+	}
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		firstCorner[vertex + 1] += firstCorner[vertex];
+	}
+	std::vector<unsigned int> corners(faceCount * 3);
+	{
+		std::vector<unsigned int> next(firstCorner.begin(), firstCorner.end() - 1);
+		for (size_t i = 0; i < faceCount * 3; i++)
+		{
+			corners[next[indices[i]]++] = (unsigned int)i;
+		}
+	}
+
+	ThreadPool::forEachRange(pool, vertexCount, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		float x[CHUNK_SIZE], y[CHUNK_SIZE], z[CHUNK_SIZE];
+		for (size_t vertex = begin; vertex < end; vertex++)
+		{
+			float sum[3] = { 0.0f, 0.0f, 0.0f };
+			for (unsigned int i = firstCorner[vertex]; i < firstCorner[vertex + 1]; i++)
+			{
+				unsigned int corner = corners[i];
+				unsigned int face = corner / 3;
+				float weight = cornerWeights.empty() ? 1.0f : cornerWeights[corner];
+				sum[0] += faceX[face] * weight;
+				sum[1] += faceY[face] * weight;
+				sum[2] += faceZ[face] * weight;
+			}
+			x[vertex - begin] = sum[0];
+			y[vertex - begin] = sum[1];
+			z[vertex - begin] = sum[2];
+		}
+		normalize(x, y, z, end - begin);
+		for (size_t vertex = begin; vertex < end; vertex++)
+		{
+			normals[3 * vertex] = x[vertex - begin];
+			normals[3 * vertex + 1] = y[vertex - begin];
+			normals[3 * vertex + 2] = z[vertex - begin];
+		}
+	});
+}
+
+ThreadPool& getThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+const char *getWeightingName(NormalWeighting weighting)
+{
+	switch (weighting)
+	{
+	case NORMAL_WEIGHT_AREA:
+		return "area";
+	case NORMAL_WEIGHT_ANGLE:
+		return "angle";
+	default:
+		return "uniform";
+	}
+}
+
+bool parseWeighting(const char *name, NormalWeighting& weighting)
+{
+	for (NormalWeighting candidate : { NORMAL_WEIGHT_UNIFORM, NORMAL_WEIGHT_AREA, NORMAL_WEIGHT_ANGLE })
+	{
+		if (std::strcmp(name, getWeightingName(candidate)) == 0)
+		{
+			weighting = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _NORMALS_H_
+#define _NORMALS_H_
+
+#include <cstddef>
+
+class ThreadPool;
+
+// how much each face around a vertex counts towards its normal
+enum NormalWeighting
+{
+	// every face the same, what Shape always did
+	NORMAL_WEIGHT_UNIFORM = 0,
+	// by the face's area, so slivers barely count
+	NORMAL_WEIGHT_AREA = 1,
+	// by the face's angle at the vertex, so a fan of thin faces counts as much as one wide one
+	NORMAL_WEIGHT_ANGLE = 2
+};
+
+// Smooth vertex normals for an indexed triangle list. Instead of scattering each
+// face's normal into its three vertices, the faces around each vertex are looked
+// up in an adjacency list and gathered, so vertices split across threads without
+// atomics or per thread copies, each vertex sums its faces in the same order
+// whatever the thread count, and the normalizing runs over chunks of x, y and z
+// arrays four at a time.
+namespace Normals
+{
+	// positions and normals are xyz per vertex. Big meshes are split over pool,
+	// null keeps everything on the calling thread. Vertices no face touches,
+	// or whose faces cancel out, get a zero normal.
+	void generate(const float *positions, size_t vertexCount, const unsigned int *indices, size_t indexCount,
+		float *normals, NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM, ThreadPool *pool = nullptr);
+	// shared by every Shape, started the first time a mesh is big enough to need it
+	ThreadPool& getThreadPool();
+	const char *getWeightingName(NormalWeighting weighting);
+	// false for anything but uniform, area or angle
+	bool parseWeighting(const char *name, NormalWeighting& weighting);
+}
+
+#endif
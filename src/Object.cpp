@@ -85,19 +85,6 @@ MeshObject::MeshObject(std::shared_ptr<Scene> scene, std::shared_ptr<Model> mode
 {
 }
 
-void MeshObject::draw(bool freeCam)
-{
-	material->apply(scene);
-	auto program = scene->getCurrentShaderProgram();
-	scene->addLightsToProgram(program);
-	scene->addBlackHoleToProgram(program);
-	glUniformMatrix4fv(program->getUniform("M"), 1, GL_FALSE, glm::value_ptr(globalTransform));
-	glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE, glm::value_ptr(scene->viewMatrix));
-	glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE, glm::value_ptr(scene->projectionMatrix));
-	glUniform1i(program->getUniform("freeCam"), freeCam);
-	model->draw(program);
-}
-
 PointLightObject::PointLightObject(std::shared_ptr<Scene> scene, float intensity) :
 	Object(scene),
 	intensity(intensity)
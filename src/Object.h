@@ -40,7 +40,7 @@ public:
 	MeshObject(std::shared_ptr<Scene> scene, std::shared_ptr<Model> model, std::shared_ptr<Material> material);
 	std::shared_ptr<Model> model;
 	std::shared_ptr<Material> material;
-	void draw(bool freeCam) override;
+	// drawn by the scene's RenderQueue, batched with others sharing the model and material
 };
 
 class PointLightObject : public Object
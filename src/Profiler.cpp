@@ -0,0 +1,287 @@
+#include "Profiler.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+void Profiler::Samples::add(float value, size_t window)
+{
+	if (values.size() < window)
+	{
+		values.push_back(value);
+	}
+	else
+	{
+		values[next] = value;
+		next = (next + 1) % window;
+	}
+}
+
+Profiler::Profiler(size_t window) :
+	window(std::max<size_t>(window, 1)),
+	// timestamps are core in 3.3, the context only asks for 3.2
+	timerQueries(GLAD_GL_VERSION_3_3 && glQueryCounter != nullptr && glGetQueryObjectui64v != nullptr),
+	pendingIndex(0)
+{
+	getSection("frame", true);
+	if (!timerQueries)
+	{
+		std::cerr << "No timer queries, GPU times will not be recorded" << std::endl;
+	}
+}
+
+Profiler::~Profiler()
+{
+	for (auto& queries : pending)
+	{
+		for (auto& query : queries)
+		{
+			freeQueries.push_back(query.start);
+			freeQueries.push_back(query.end);
+		}
+	}
+	if (!freeQueries.empty())
+	{
+		glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+	}
+}
+
+int Profiler::getSection(const std::string& name, bool gpu)
+{
+	auto found = sectionIndices.find(name);
+	if (found != sectionIndices.end())
+	{
+		return found->second;
+	}
+	Section section;
+	section.name = name;
+	section.gpu = gpu && timerQueries;
+	sections.push_back(section);
+	sectionIndices[name] = (int)sections.size() - 1;
+	return (int)sections.size() - 1;
+}
+
+GLuint Profiler::takeQuery()
+{
+	if (freeQueries.empty())
+	{
+		GLuint queries[16];
+		glGenQueries(16, queries);
+		freeQueries.insert(freeQueries.end(), queries, queries + 16);
+	}
+	GLuint query = freeQueries.back();
+	freeQueries.pop_back();
+	return query;
+}
+
+void Profiler::resolve(std::vector<PendingQuery>& queries)
+{
+	if (queries.empty())
+	{
+		return;
+	}
+	std::vector<double> totals(sections.size(), 0.0);
+	std::vector<bool> ran(sections.size(), false);
+	for (auto& query : queries)
+	{
+		// blocks if the GPU is still QUERY_LATENCY frames behind, which is what we want to know anyway
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+		totals[query.section] += (end - start) / 1e6;
+		ran[query.section] = true;
+		freeQueries.push_back(query.start);
+		freeQueries.push_back(query.end);
+	}
+	queries.clear();
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		if (ran[i])
+		{
+			sections[i].gpuSamples.add((float)totals[i], window);
+		}
+	}
+}
+
+void Profiler::beginFrame()
+{
+	pendingIndex = (pendingIndex + 1) % QUERY_LATENCY;
+	resolve(pending[pendingIndex]);
+	begin(0);
+}
+
+void Profiler::endFrame()
+{
+	end(0);
+	for (auto& section : sections)
+	{
+		if (section.frameCalls > 0)
+		{
+			section.cpuSamples.add((float)section.frameTime, window);
+			section.totalCalls += section.frameCalls;
+			section.frames++;
+		}
+		section.frameTime = 0.0;
+		section.frameCalls = 0;
+	}
+}
+
+void Profiler::begin(int section)
+{
+	Section& current = sections[section];
+	if (current.gpu)
+	{
+		current.startQuery = takeQuery();
+		glQueryCounter(current.startQuery, GL_TIMESTAMP);
+	}
+	current.start = Clock::now();
+}
+
+void Profiler::end(int section)
+{
+	Section& current = sections[section];
+	current.frameTime += std::chrono::duration<double, std::milli>(Clock::now() - current.start).count();
+	current.frameCalls++;
+	if (current.gpu)
+	{
+		GLuint endQuery = takeQuery();
+		glQueryCounter(endQuery, GL_TIMESTAMP);
+		pending[pendingIndex].push_back({ section, current.startQuery, endQuery });
+	}
+}
+
+void Profiler::finish()
+{
+	for (int i = 1; i <= QUERY_LATENCY; i++)
+	{
+		resolve(pending[(pendingIndex + i) % QUERY_LATENCY]);
+	}
+}
+
+Profiler::Stats Profiler::computeStats(const Samples& samples)
+{
+	Stats stats;
+	stats.count = samples.values.size();
+	if (stats.count == 0)
+	{
+		return stats;
+	}
+	std::vector<float> sorted = samples.values;
+	std::sort(sorted.begin(), sorted.end());
+	// nearest rank
+	auto percentile = [&](double p)
+	{
+		size_t rank = (size_t)std::ceil(p * sorted.size());
+		return (double)sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+	};
+	double total = 0.0;
+	for (float value : sorted)
+	{
+		total += value;
+	}
+	stats.mean = total / sorted.size();
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.max = sorted.back();
+	return stats;
+}
+
+Profiler::Stats Profiler::getStats(int section, bool gpu) const
+{
+	return computeStats(gpu ? sections[section].gpuSamples : sections[section].cpuSamples);
+}
+
+std::string Profiler::getSummary() const
+{
+	std::ostringstream summary;
+	summary << std::fixed << std::setprecision(2);
+	Stats cpu = getStats(0, false);
+	summary << "frame " << cpu.p50 << " ms (p99 " << cpu.p99 << ")";
+	if (sections[0].gpu)
+	{
+		Stats gpu = getStats(0, true);
+		summary << ", gpu " << gpu.p50 << " ms (p99 " << gpu.p99 << ")";
+	}
+	return summary.str();
+}
+
+void Profiler::printStats() const
+{
+	std::cout << std::left << std::setw(28) << "section" << std::right << std::setw(5) << "side"
+		<< std::setw(8) << "calls" << std::setw(9) << "mean" << std::setw(9) << "p50"
+		<< std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		const Section& section = sections[i];
+		double calls = section.frames > 0 ? section.totalCalls / (double)section.frames : 0.0;
+		for (int side = 0; side < (section.gpu ? 2 : 1); side++)
+		{
+			Stats stats = getStats((int)i, side == 1);
+			std::cout << std::left << std::setw(28) << section.name << std::right << std::setw(5) << (side == 1 ? "gpu" : "cpu")
+				<< std::setw(8) << std::setprecision(1) << calls << std::setprecision(3)
+				<< std::setw(9) << stats.mean << std::setw(9) << stats.p50 << std::setw(9) << stats.p95
+				<< std::setw(9) << stats.p99 << std::setw(9) << stats.max << std::endl;
+		}
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+bool Profiler::writeCSV(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open file: '" << path << "'" << std::endl;
+		return false;
+	}
+	// times in milliseconds, calls per frame the section ran in
+	file << "section,side,frames,calls,mean,p50,p95,p99,max" << std::endl;
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		const Section& section = sections[i];
+		double calls = section.frames > 0 ? section.totalCalls / (double)section.frames : 0.0;
+		for (int side = 0; side < (section.gpu ? 2 : 1); side++)
+		{
+			Stats stats = getStats((int)i, side == 1);
+			file << "\"" << section.name << "\"," << (side == 1 ? "gpu" : "cpu") << "," << stats.count << "," << calls << ","
+				<< stats.mean << "," << stats.p50 << "," << stats.p95 << "," << stats.p99 << "," << stats.max << std::endl;
+		}
+	}
+	return true;
+}
+
+bool Profiler::writeJSON(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open file: '" << path << "'" << std::endl;
+		return false;
+	}
+	auto writeStats = [&](const Stats& stats)
+	{
+		file << "{ \"frames\": " << stats.count << ", \"mean\": " << stats.mean << ", \"p50\": " << stats.p50
+			<< ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << " }";
+	};
+	file << "{" << std::endl << "\t\"window\": " << window << "," << std::endl << "\t\"sections\": [" << std::endl;
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		const Section& section = sections[i];
+		double calls = section.frames > 0 ? section.totalCalls / (double)section.frames : 0.0;
+		// section names come from code and material names, nothing that needs escaping
+		file << "\t\t{ \"name\": \"" << section.name << "\", \"calls\": " << calls << ", \"cpu\": ";
+		writeStats(getStats((int)i, false));
+		if (section.gpu)
+		{
+			file << ", \"gpu\": ";
+			writeStats(getStats((int)i, true));
+		}
+		file << " }" << (i + 1 < sections.size() ? "," : "") << std::endl;
+	}
+	file << "\t]" << std::endl << "}" << std::endl;
+	return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+#include <glad/glad.h>
+
+// Per frame CPU timings for named sections, plus GPU timings from timestamp
+// queries for sections that ask for them. Every section gets one sample per
+// frame it ran in (the total of all its calls that frame), and the last
+// `window` samples are kept for percentiles. GPU results are read back a few
+// frames late so reading them doesn't stall the pipeline.
+class Profiler
+{
+public:
+	struct Stats
+	{
+		size_t count = 0;
+		double mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+	};
+	Profiler(size_t window = 1000);
+	virtual ~Profiler();
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+	// handle for a section, created the first time its name comes up; look it
+	// up once and keep it, this is a hash map lookup
+	int getSection(const std::string& name, bool gpu = false);
+	// the frame section itself is handle 0 and is timed on both sides
+	void beginFrame();
+	void endFrame();
+	void begin(int section);
+	void end(int section);
+	// waits for the GPU results still in flight, call before reading stats at exit
+	void finish();
+	bool hasTimerQueries() const { return timerQueries; }
+	long getFrameCount() const { return sections[0].frames; }
+	Stats getStats(int section, bool gpu) const;
+	// frame times on one line, for the window title
+	std::string getSummary() const;
+	void printStats() const;
+	bool writeCSV(const std::string& path) const;
+	bool writeJSON(const std::string& path) const;
+private:
+	static constexpr int QUERY_LATENCY = 4;
+	using Clock = std::chrono::steady_clock;
+	struct Samples
+	{
+		std::vector<float> values;
+		size_t next = 0;
+		void add(float value, size_t window);
+	};
+	struct Section
+	{
+		std::string name;
+		bool gpu;
+		Clock::time_point start;
+		GLuint startQuery = 0;
+		double frameTime = 0.0;
+		int frameCalls = 0;
+		long totalCalls = 0;
+		long frames = 0;
+		Samples cpuSamples, gpuSamples;
+	};
+	struct PendingQuery
+	{
+		int section;
+		GLuint start, end;
+	};
+	size_t window;
+	bool timerQueries;
+	std::vector<Section> sections;
+	std::unordered_map<std::string, int> sectionIndices;
+	std::vector<GLuint> freeQueries;
+	std::vector<PendingQuery> pending[QUERY_LATENCY];
+	int pendingIndex;
+	GLuint takeQuery();
+	void resolve(std::vector<PendingQuery>& queries);
+	static Stats computeStats(const Samples& samples);
+};
+
+// times the enclosing block; does nothing without a profiler or with section -1
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler* profiler, int section) :
+		profiler(section < 0 ? nullptr : profiler),
+		section(section)
+	{
+		if (this->profiler != nullptr)
+		{
+			this->profiler->begin(section);
+		}
+	}
+	~ProfileScope()
+	{
+		if (profiler != nullptr)
+		{
+			profiler->end(section);
+		}
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+	Profiler* profiler;
+	int section;
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include <algorithm>
+#include <iterator>
 
 #include "GLSL.h"
 
@@ -28,6 +30,33 @@ std::string readFileAsString(const std::string &fileName)
 	return result;
 }
 
+static const char *uniformNames[UNIFORM_COUNT] = {
+	"instanceTransforms",
+	"instanceBase",
+	"flipNormals",
+	"useBlackHole",
+	"blackHoleSecondary",
+	"bothImages",
+	"blackHoleMesh",
+	"pointLights",
+	"solidColor",
+	"matAmb",
+	"matDif",
+	"matSpec",
+	"specIntensity",
+	"Texture0",
+	"amb",
+	"dif",
+	"spec"
+};
+
+static const char *attributeNames[ATTRIBUTE_COUNT] = {
+	"vertPos",
+	"vertNor",
+	"vertTex",
+	"vertInstance"
+};
+
 void Program::setShaderNames(const std::string &v, const std::string &f)
 {
 	vShaderName = v;
@@ -37,6 +66,8 @@ void Program::setShaderNames(const std::string &v, const std::string &f)
 bool Program::init()
 {
 	GLint rc;
+	std::fill(std::begin(uniformHandles), std::end(uniformHandles), -1);
+	std::fill(std::begin(attributeHandles), std::end(attributeHandles), -1);
 
 	// Create shader handles
 	GLuint VS = glCreateShader(GL_VERTEX_SHADER);
@@ -92,6 +123,16 @@ bool Program::init()
 		return false;
 	}
 
+	// quietly, most programs only use some of them
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		uniformHandles[i] = glGetUniformLocation(pid, uniformNames[i]);
+	}
+	for (int i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		attributeHandles[i] = glGetAttribLocation(pid, attributeNames[i]);
+	}
+
 	return true;
 }
 
@@ -115,6 +156,20 @@ void Program::addUniform(const std::string &name)
 	uniforms[name] = GLSL::getUniformLocation(pid, name.c_str(), isVerbose());
 }
 
+void Program::addUniformBlock(const std::string &name, GLuint binding)
+{
+	GLuint index = glGetUniformBlockIndex(pid, name.c_str());
+	if (index == GL_INVALID_INDEX)
+	{
+		if (isVerbose())
+		{
+			std::cerr << "WARN: uniform block " << name << " cannot be bound (it either doesn't exist or has been optimized away)." << std::endl;
+		}
+		return;
+	}
+	CHECKED_GL_CALL(glUniformBlockBinding(pid, index, binding));
+}
+
 GLint Program::getAttribute(const std::string &name) const
 {
 	std::map<std::string, GLint>::const_iterator attribute = attributes.find(name.c_str());
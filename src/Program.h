@@ -12,6 +12,42 @@
 
 std::string readFileAsString(const std::string &fileName);
 
+// Everything the renderer sets per draw; per frame state lives in the FrameData
+// block, see Scene.h. init() looks all of them up once after linking, so draws
+// index an array instead of searching the maps by name. Programs that don't use
+// one get -1, which glUniform* ignores.
+enum ProgramUniform
+{
+	UNIFORM_INSTANCE_TRANSFORMS,
+	UNIFORM_INSTANCE_BASE,
+	UNIFORM_FLIP_NORMALS,
+	UNIFORM_USE_BLACK_HOLE,
+	UNIFORM_BLACK_HOLE_SECONDARY,
+	UNIFORM_BOTH_IMAGES,
+	UNIFORM_BLACK_HOLE_MESH,
+	UNIFORM_POINT_LIGHTS,
+	UNIFORM_SOLID_COLOR,
+	UNIFORM_MAT_AMB,
+	UNIFORM_MAT_DIF,
+	UNIFORM_MAT_SPEC,
+	UNIFORM_SPEC_INTENSITY,
+	UNIFORM_TEXTURE0,
+	UNIFORM_AMB,
+	UNIFORM_DIF,
+	UNIFORM_SPEC,
+	UNIFORM_COUNT
+};
+
+// in layout(location) order, Shape bakes these into its VAO
+enum ProgramAttribute
+{
+	ATTRIBUTE_VERT_POS,
+	ATTRIBUTE_VERT_NOR,
+	ATTRIBUTE_VERT_TEX,
+	ATTRIBUTE_VERT_INSTANCE,
+	ATTRIBUTE_COUNT
+};
+
 class Program
 {
 
@@ -27,8 +63,12 @@ public:
 
 	void addAttribute(const std::string &name);
 	void addUniform(const std::string &name);
+	// points the named uniform block at a GL_UNIFORM_BUFFER binding
+	void addUniformBlock(const std::string &name, GLuint binding);
 	GLint getAttribute(const std::string &name) const;
 	GLint getUniform(const std::string &name) const;
+	GLint getAttribute(ProgramAttribute attribute) const { return attributeHandles[attribute]; }
+	GLint getUniform(ProgramUniform uniform) const { return uniformHandles[uniform]; }
 
 protected:
 
@@ -40,6 +80,8 @@ private:
 	GLuint pid = 0;
 	std::map<std::string, GLint> attributes;
 	std::map<std::string, GLint> uniforms;
+	GLint attributeHandles[ATTRIBUTE_COUNT];
+	GLint uniformHandles[UNIFORM_COUNT];
 	bool verbose = true;
 
 };
@@ -0,0 +1,294 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstdio>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Object.h"
+#include "GLSL.h"
+#include "GeometryArena.h"
+
+RenderQueue::RenderQueue() :
+	sorted(true),
+	instanced(true),
+	singlePass(false),
+	multiDraw(true),
+	instanceBuffer(0),
+	instanceTexture(0),
+	commandBuffer(0),
+	frames(0)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		glDeleteTextures(1, &instanceTexture);
+	}
+	if (commandBuffer != 0)
+	{
+		glDeleteBuffers(1, &commandBuffer);
+	}
+}
+
+// 8 bits of program, 24 of material and 32 of model, most expensive change on top
+uint64_t RenderQueue::makeKey(const MeshObject& mesh)
+{
+	return ((uint64_t)(mesh.material->programIndex & 0xFF) << 56)
+		| ((uint64_t)(mesh.material->sortId & 0xFFFFFF) << 32)
+		| (uint64_t)mesh.model->sortId;
+}
+
+void RenderQueue::countChanges(const std::vector<Item>& items, long& programChanges, long& materialChanges, long& modelChanges)
+{
+	programChanges = materialChanges = modelChanges = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		uint64_t key = items[i].key;
+		uint64_t previous = i > 0 ? items[i - 1].key : ~key;
+		programChanges += (key >> 56) != (previous >> 56);
+		materialChanges += (key >> 32) != (previous >> 32);
+		modelChanges += (key != previous);
+	}
+}
+
+void RenderQueue::build(const std::vector<std::shared_ptr<MeshObject>>& meshes)
+{
+	items.clear();
+	for (auto& mesh : meshes)
+	{
+		items.push_back({ makeKey(*mesh), mesh.get() });
+	}
+
+	frameStats = Stats();
+	frameStats.draws = (long)items.size();
+	countChanges(items, frameStats.unsortedProgramChanges, frameStats.unsortedMaterialChanges, frameStats.unsortedModelChanges);
+	if (sorted)
+	{
+		// stable so equal keys keep scene order and frames come out the same every time
+		std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+	}
+	countChanges(items, frameStats.programChanges, frameStats.materialChanges, frameStats.modelChanges);
+
+	batches.clear();
+	transforms.resize(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		transforms[i] = items[i].mesh->globalTransform;
+		const MeshObject* previous = i > 0 ? items[i - 1].mesh : nullptr;
+		if (instanced && previous != nullptr && previous->model == items[i].mesh->model && previous->material == items[i].mesh->material)
+		{
+			batches.back().count++;
+		}
+		else
+		{
+			batches.push_back({ (int)i, 1 });
+		}
+	}
+	frameStats.batches = (long)batches.size();
+
+	commands.clear();
+	runs.clear();
+	for (size_t b = 0; b < batches.size(); b++)
+	{
+		const Batch& batch = batches[b];
+		const MeshObject* mesh = items[batch.first].mesh;
+		const Model& model = *mesh->model;
+		MeshFootprint footprint = model.getFootprint();
+		frameStats.fetchBytes += 2LL * batch.count * (long long)footprint.fetchBytes;
+		frameStats.floatFetchBytes += 2LL * batch.count * (long long)footprint.floatFetchBytes;
+		for (auto& shape : model.shapes)
+		{
+			const MeshObject* runMesh = runs.empty() ? nullptr : items[batches[runs.back().firstBatch].first].mesh;
+			bool sameRun = runMesh != nullptr && runMesh->material == mesh->material
+				&& runs.back().pool == shape->getArenaPool() && runs.back().indexType == shape->getIndexType()
+				&& runMesh->model->flipNormals == model.flipNormals && runMesh->model->useBlackHole == model.useBlackHole;
+			if (!sameRun)
+			{
+				runs.push_back({ (int)b, (int)commands.size(), 0, shape->getArenaPool(), shape->getIndexType() });
+			}
+			runs.back().commandCount++;
+			commands.push_back({ (GLuint)shape->getIndexCount(), (GLuint)(singlePass ? 2 * batch.count : batch.count),
+				(GLuint)shape->getFirstIndex(), shape->getBaseVertex(), (GLuint)batch.first });
+		}
+	}
+}
+
+bool RenderQueue::usesMultiDraw() const
+{
+	return multiDraw && GLSL::multiDrawElementsIndirect != nullptr;
+}
+
+void RenderQueue::bindInstances()
+{
+	if (instanceBuffer == 0)
+	{
+		glGenBuffers(1, &instanceBuffer);
+		glGenTextures(1, &instanceTexture);
+		glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+		glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+	// fresh storage every frame so the driver doesn't wait on last frame's draws
+	glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(transforms.size(), 1) * sizeof(glm::mat4), transforms.empty() ? nullptr : glm::value_ptr(transforms[0]), GL_STREAM_DRAW);
+	glActiveTexture(GL_TEXTURE0 + INSTANCE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+
+	GeometryArena& arena = GeometryArena::get();
+	arena.reserveInstances(items.size());
+	arena.setInstanceDivisor(singlePass ? 2 : 1);
+
+	if (usesMultiDraw())
+	{
+		if (commandBuffer == 0)
+		{
+			glGenBuffers(1, &commandBuffer);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, std::max<size_t>(commands.size(), 1) * sizeof(DrawCommand), commands.empty() ? nullptr : commands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+}
+
+void RenderQueue::draw()
+{
+	if (usesMultiDraw())
+	{
+		drawRuns();
+	}
+	else
+	{
+		drawBatches();
+	}
+
+	totalStats.draws += frameStats.draws;
+	totalStats.batches += frameStats.batches;
+	totalStats.submits += frameStats.submits;
+	totalStats.fetchBytes += frameStats.fetchBytes;
+	totalStats.floatFetchBytes += frameStats.floatFetchBytes;
+	totalStats.programChanges += frameStats.programChanges;
+	totalStats.materialChanges += frameStats.materialChanges;
+	totalStats.modelChanges += frameStats.modelChanges;
+	totalStats.unsortedProgramChanges += frameStats.unsortedProgramChanges;
+	totalStats.unsortedMaterialChanges += frameStats.unsortedMaterialChanges;
+	totalStats.unsortedModelChanges += frameStats.unsortedModelChanges;
+	frames++;
+}
+
+// the material's profiler section, looked up the first time it's drawn
+static int getMaterialSection(Profiler* profiler, Material* material)
+{
+	if (profiler != nullptr && material->profileSection < 0)
+	{
+		material->profileSection = profiler->getSection("material " + (material->name.empty() ? std::to_string(material->programIndex) : material->name), true);
+	}
+	return material->profileSection;
+}
+
+void RenderQueue::drawRuns()
+{
+	Material* applied = nullptr;
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	for (auto& run : runs)
+	{
+		MeshObject* mesh = items[batches[run.firstBatch].first].mesh;
+		Scene* scene = mesh->scene.get();
+		if (mesh->material.get() != applied)
+		{
+			applied = mesh->material.get();
+			applied->apply(mesh->scene);
+		}
+		auto program = scene->getCurrentShaderProgram();
+		// the commands' base instances say where each one starts
+		glUniform1i(program->getUniform(UNIFORM_INSTANCE_BASE), 0);
+		GeometryArena::get().bind(run.pool);
+		const void *offset = (const void *)(run.firstCommand * sizeof(DrawCommand));
+
+		Profiler* profiler = scene->profiler.get();
+		ProfileScope materialScope(profiler, getMaterialSection(profiler, applied));
+		if (singlePass)
+		{
+			ProfileScope bothScope(profiler, scene->bothImagesSection);
+			mesh->model->applyUniforms(program, false, true);
+			GLSL::multiDrawElementsIndirect(GL_TRIANGLES, run.indexType, offset, run.commandCount, 0);
+			scene->drawCalls++;
+			frameStats.submits++;
+			continue;
+		}
+		{
+			ProfileScope primaryScope(profiler, scene->primarySection);
+			mesh->model->applyUniforms(program, false, false);
+			GLSL::multiDrawElementsIndirect(GL_TRIANGLES, run.indexType, offset, run.commandCount, 0);
+		}
+		{
+			ProfileScope secondaryScope(profiler, scene->secondarySection);
+			mesh->model->applyUniforms(program, true, false);
+			GLSL::multiDrawElementsIndirect(GL_TRIANGLES, run.indexType, offset, run.commandCount, 0);
+		}
+		scene->drawCalls += 2;
+		frameStats.submits += 2;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void RenderQueue::drawBatches()
+{
+	Material* applied = nullptr;
+	for (auto& batch : batches)
+	{
+		MeshObject* mesh = items[batch.first].mesh;
+		Scene* scene = mesh->scene.get();
+		if (mesh->material.get() != applied)
+		{
+			applied = mesh->material.get();
+			applied->apply(mesh->scene);
+		}
+		auto program = scene->getCurrentShaderProgram();
+		glUniform1i(program->getUniform(UNIFORM_INSTANCE_BASE), batch.first);
+
+		Profiler* profiler = scene->profiler.get();
+		ProfileScope materialScope(profiler, getMaterialSection(profiler, applied));
+		long shapes = (long)mesh->model->shapes.size();
+		if (singlePass)
+		{
+			ProfileScope bothScope(profiler, scene->bothImagesSection);
+			mesh->model->drawBothImages(program, batch.count);
+			scene->drawCalls += shapes;
+			frameStats.submits += shapes;
+			continue;
+		}
+		{
+			ProfileScope primaryScope(profiler, scene->primarySection);
+			mesh->model->draw(program, false, batch.count);
+		}
+		{
+			ProfileScope secondaryScope(profiler, scene->secondarySection);
+			mesh->model->draw(program, true, batch.count);
+		}
+		scene->drawCalls += 2 * shapes;
+		frameStats.submits += 2 * shapes;
+	}
+}
+
+void RenderQueue::printStats() const
+{
+	if (frames == 0)
+	{
+		return;
+	}
+	double perFrame = 1.0 / frames;
+	printf("Render queue (%s, %s, %s, %s), per frame: %.0f objects in %.0f batches, %.0f GL draw calls\n", sorted ? "sorted" : "scene order",
+		instanced ? "instanced" : "not instanced", singlePass ? "single pass" : "two pass", usesMultiDraw() ? "multi-draw indirect" : "per batch",
+		totalStats.draws * perFrame, totalStats.batches * perFrame, totalStats.submits * perFrame);
+	printf("  program changes  %8.1f (%.1f in scene order, %.1f avoided)\n", totalStats.programChanges * perFrame,
+		totalStats.unsortedProgramChanges * perFrame, (totalStats.unsortedProgramChanges - totalStats.programChanges) * perFrame);
+	printf("  material changes %8.1f (%.1f in scene order, %.1f avoided)\n", totalStats.materialChanges * perFrame,
+		totalStats.unsortedMaterialChanges * perFrame, (totalStats.unsortedMaterialChanges - totalStats.materialChanges) * perFrame);
+	printf("  model changes    %8.1f (%.1f in scene order, %.1f avoided)\n", totalStats.modelChanges * perFrame,
+		totalStats.unsortedModelChanges * perFrame, (totalStats.unsortedModelChanges - totalStats.modelChanges) * perFrame);
+	printf("  vertex fetch     %8.2f MB (%.2f MB with float vertices)\n", totalStats.fetchBytes * perFrame / (1 << 20),
+		totalStats.floatFetchBytes * perFrame / (1 << 20));
+}
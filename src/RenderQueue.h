@@ -0,0 +1,110 @@
+#pragma once
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class MeshObject;
+
+// Orders a frame's draws by program, then material, then model, so each of those
+// changes as few times as possible, and applies a material only when it changes.
+// Runs of objects sharing a model and material become one instanced draw per
+// image, with every model matrix of the frame in one buffer texture that the
+// vertex shader indexes with instanceBase + gl_InstanceID. In single pass mode
+// odd instances are the secondary image of the one before. Where the context
+// has glMultiDrawElementsIndirect, the batches become a command buffer built on
+// the CPU each frame, and every run of commands sharing a material, arena pool
+// and model uniforms is one multi-draw per image; the commands' base instances
+// reach the shader through vertInstance. Keys are rebuilt every frame, so
+// objects can swap materials freely.
+class RenderQueue
+{
+public:
+	// state changes in one frame, as drawn and as they would have been in scene order
+	struct Stats
+	{
+		long draws = 0;
+		long batches = 0;
+		// GL draw calls, a multi-draw counting once
+		long submits = 0;
+		long programChanges = 0, materialChanges = 0, modelChanges = 0;
+		long unsortedProgramChanges = 0, unsortedMaterialChanges = 0, unsortedModelChanges = 0;
+		// vertex and index bytes the draws read, and what they would with float vertices, see MeshFootprint
+		long long fetchBytes = 0, floatFetchBytes = 0;
+	};
+	RenderQueue();
+	virtual ~RenderQueue();
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+	// turn off to draw in scene order, for comparing
+	bool sorted;
+	// turn off to give every object its own draw, for comparing
+	bool instanced;
+	// draw the primary and secondary images together, doubling the instances,
+	// instead of in two passes
+	bool singlePass;
+	// turn off to draw batch by batch even where multi-draw indirect is there
+	bool multiDraw;
+	bool usesMultiDraw() const;
+	void build(const std::vector<std::shared_ptr<MeshObject>>& meshes);
+	// needs the instance buffer bound on INSTANCE_TEXTURE_UNIT, see bindInstances
+	void draw();
+	// uploads the transforms, and the commands when multi-drawing
+	void bindInstances();
+	const Stats& getFrameStats() const { return frameStats; }
+	// summed over every frame drawn so far
+	const Stats& getTotalStats() const { return totalStats; }
+	long getFrameCount() const { return frames; }
+	void printStats() const;
+private:
+	struct Item
+	{
+		uint64_t key;
+		MeshObject* mesh;
+	};
+	struct Batch
+	{
+		int first;
+		int count;
+	};
+	// DrawElementsIndirectCommand, as glMultiDrawElementsIndirect reads it
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+	// commands one multi-draw can take
+	struct CommandRun
+	{
+		int firstBatch;
+		int firstCommand;
+		int commandCount;
+		int pool;
+		GLenum indexType;
+	};
+	std::vector<Item> items;
+	std::vector<Batch> batches;
+	std::vector<glm::mat4> transforms;
+	std::vector<DrawCommand> commands;
+	std::vector<CommandRun> runs;
+	GLuint instanceBuffer;
+	GLuint instanceTexture;
+	GLuint commandBuffer;
+	void drawRuns();
+	void drawBatches();
+	Stats frameStats;
+	Stats totalStats;
+	long frames;
+	static uint64_t makeKey(const MeshObject& mesh);
+	static void countChanges(const std::vector<Item>& items, long& programChanges, long& materialChanges, long& modelChanges);
+};
+
+#endif
@@ -1,133 +1,42 @@
 #include "Scene.h"
 #include <iostream>
-#include <fstream>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-BlackHoleMap::BlackHoleMap() :
-	position(glm::vec3(0.0)),
-	size(0.0f),
-	vrResolution(0),
-	vrMin(0.0f),
-	vrMax(0.0f),
-	vPhiResolution(0),
-	orResolution(0),
-	orMin(0.0f),
-	orMax(0.0f),
-	data(nullptr),
-	textureID(0),
-	textureUnit(0)
-{
-}
-
-BlackHoleMap::~BlackHoleMap()
-{
-}
-
-void BlackHoleMap::loadFromFile(std::string path)
-{
-	std::ifstream file(path);
-	if (!file) {
-		std::cerr << "Failed to open black hole file: " << path << std::endl;
-		return;
-	}
-
-	// Read header: dimensions and min/max values.
-	file >> vrResolution >> vPhiResolution >> orResolution;
-	file >> vrMin >> vrMax;
-	file >> orMin >> orMax;
-
-	auto totalSize = vrResolution * vPhiResolution * orResolution * 3;
-
-	// Allocate memory for observerAngles (3D array)
-	data = new float[totalSize];
-
-	// Read all the values into the observerAngles array
-	for (int i = 0; i < totalSize; i += 3)
-	{
-		file >> data[i] >> data[i + 1] >> data[i + 2];
-	}
-
-	file.close();
-}
-
-void BlackHoleMap::sendToGPU()
-{
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_3D, textureID);
-
-	glPixelStorei(GL_UNPACK_ROW_LENGTH, orResolution);
-	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, vPhiResolution);
-
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB32F, orResolution, vPhiResolution, vrResolution, 0, GL_RGB, GL_FLOAT, data);
-
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	glBindTexture(GL_TEXTURE_3D, 0);
-}
-
-glm::vec3 BlackHoleMap::getValue(float vr, float vPhi, float orAngle)
-{
-	if (vr >= 1.0f)
-		vr = 0.9999f;
-	if (vr < 0.0f)
-		vr = 0.0f;
-
-	if (vPhi >= 1.0f)
-		vPhi = 0.9999f;
-	if (vPhi < 0.0f)
-		vPhi = 0.0f;
-
-	if (orAngle >= 1.0f)
-		orAngle = 0.9999f;
-	if (orAngle < 0.0f)
-		orAngle = 0.0f;
-
-	int vrIndex = floorf(vr * vrResolution);
-	int vPhiIndex = floorf(vPhi * vPhiResolution);
-	int orIndex = floorf(orAngle * orResolution);
-
-	std::cout << "vrIndex: " << vrIndex << ", vPhiIndex: " << vPhiIndex << ", orIndex: " << orIndex << std::endl;
-
-	int baseIndex = (vrIndex * vPhiResolution * orResolution + vPhiIndex * orResolution + orIndex) * 3;
-
-	return glm::vec3(data[baseIndex], data[baseIndex + 1], data[baseIndex + 2]);
-}
-
-void BlackHoleMap::bind(GLint handle)
-{
-	glActiveTexture(GL_TEXTURE0 + textureUnit);
-	glBindTexture(GL_TEXTURE_3D, textureID);
-	glUniform1i(handle, textureUnit);
-}
-
-void BlackHoleMap::unbind()
-{
-	glActiveTexture(GL_TEXTURE0 + textureUnit);
-	glBindTexture(GL_TEXTURE_3D, 0);
-}
-
 Scene::Scene() :
 	nextAvailableId(0),
+	frameUniformBuffer(0),
+	pointLightBuffer(0),
+	pointLightTexture(0),
+	samplersAssigned(false),
 	currentShaderProgramIndex(0),
 	shaderPrograms(std::vector<std::shared_ptr<Program>>()),
 	objects(std::vector<std::shared_ptr<Object>>()),
 	blackHole(nullptr),
 	activeCamera(nullptr),
 	viewMatrix(glm::identity<glm::mat4>()),
-	projectionMatrix(glm::identity<glm::mat4>())
+	projectionMatrix(glm::identity<glm::mat4>()),
+	drawCalls(0),
+	profiler(nullptr),
+	transformSection(-1),
+	drawSection(-1),
+	primarySection(-1),
+	secondarySection(-1),
+	bothImagesSection(-1)
 {
 }
 
 Scene::~Scene()
 {
+	if (frameUniformBuffer != 0)
+	{
+		glDeleteBuffers(1, &frameUniformBuffer);
+		glDeleteBuffers(1, &pointLightBuffer);
+		glDeleteTextures(1, &pointLightTexture);
+	}
 }
 
 long Scene::getNextAvailableId()
@@ -135,6 +44,22 @@ long Scene::getNextAvailableId()
 	return nextAvailableId++;
 }
 
+void Scene::setProfiler(std::shared_ptr<Profiler> newProfiler)
+{
+	profiler = newProfiler;
+	transformSection = drawSection = primarySection = secondarySection = bothImagesSection = -1;
+	if (profiler != nullptr)
+	{
+		transformSection = profiler->getSection("transforms");
+		drawSection = profiler->getSection("drawAll", true);
+		// every object is drawn twice, once per image around the black hole
+		primarySection = profiler->getSection("primary image", true);
+		secondarySection = profiler->getSection("secondary image", true);
+		// or once for both, see RenderQueue::singlePass
+		bothImagesSection = profiler->getSection("both images", true);
+	}
+}
+
 void Scene::computeCameraMatrices()
 {
 	if (activeCamera == nullptr)
@@ -151,16 +76,34 @@ void Scene::computeCameraMatrices()
 
 void Scene::drawAll(bool freeCam)
 {
-	computeCameraMatrices();
-	for (auto& object : objects)
+	ProfileScope scope(profiler.get(), drawSection);
+	if (!samplersAssigned)
 	{
-		object->draw(freeCam);
+		assignSamplers();
+		samplersAssigned = true;
 	}
+	computeCameraMatrices();
+	updateFrameUniforms(freeCam);
+	renderQueue.build(meshes);
+	renderQueue.bindInstances();
+	renderQueue.draw();
 }
 
 void Scene::addObject(std::shared_ptr<Object> newObject)
 {
 	objects.push_back(newObject);
+	if (auto mesh = std::dynamic_pointer_cast<MeshObject>(newObject))
+	{
+		meshes.push_back(mesh);
+	}
+	else if (auto light = std::dynamic_pointer_cast<PointLightObject>(newObject))
+	{
+		pointLights.push_back(light);
+	}
+	else if (auto camera = std::dynamic_pointer_cast<CameraObject>(newObject))
+	{
+		cameras.push_back(camera);
+	}
 }
 
 void Scene::addShaderProgram(std::shared_ptr<Program> newShaderProgram)
@@ -182,53 +125,83 @@ std::shared_ptr<Program> Scene::getCurrentShaderProgram()
 	return shaderPrograms[currentShaderProgramIndex];
 }
 
-void Scene::addLightsToProgram(std::shared_ptr<Program> program)
+void Scene::updateFrameUniforms(bool freeCam)
 {
-	int dirLightIndex = 0;
-	glm::vec3 dirLightDirections[MAX_DIR_LIGHTS] = { glm::vec3(0.0) };
-	float dirLightIntensities[MAX_DIR_LIGHTS] = { 0.0 };
-	int pointLightIndex = 0;
-	glm::vec3 pointLightPositions[MAX_POINT_LIGHTS] = { glm::vec3(0.0) };
-	float pointLightIntensities[MAX_POINT_LIGHTS] = { 0.0 };
+	if (frameUniformBuffer == 0)
+	{
+		glGenBuffers(1, &frameUniformBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameUniformBuffer);
+
+		glGenBuffers(1, &pointLightBuffer);
+		glGenTextures(1, &pointLightTexture);
+		glBindBuffer(GL_TEXTURE_BUFFER, pointLightBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, pointLightTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pointLightBuffer);
+	}
+
+	FrameUniforms& frame = frameUniforms;
+	frame = FrameUniforms();
+	frame.P = projectionMatrix;
+	frame.V = viewMatrix;
+	frame.freeCam = freeCam;
 
 	// TODO: make more robust (should be easy) (surely)
-	dirLightDirections[0] = glm::vec3(1.0, -2.0, -1.0);
-	dirLightIntensities[0] = 0.3;
+	frame.dirLights[0] = glm::vec4(1.0, -2.0, -1.0, 0.3);
 
-	for (auto& object : objects)
+	// the shaders take the count from the buffer size, so there is always at least
+	// one, a dark one if need be
+	viewPointLights.assign(std::max<size_t>(pointLightData.size(), 1), glm::vec4(0.0));
+	for (size_t i = 0; i < pointLightData.size(); i++)
 	{
-		// apparently this is bad but i don't really care
-		if (PointLightObject* plo = dynamic_cast<PointLightObject*>(object.get()))
-		{
-			auto globalPos = plo->getGlobalPosition();
-			pointLightPositions[pointLightIndex] = globalPos;
-			pointLightIntensities[pointLightIndex] = plo->intensity;
-			pointLightIndex++;
-		}
+		glm::vec4 position = viewMatrix * glm::vec4(glm::vec3(pointLightData[i]), 1.0);
+		viewPointLights[i] = glm::vec4(glm::vec3(position), pointLightData[i].w);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, pointLightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, viewPointLights.size() * sizeof(glm::vec4), viewPointLights.data(), GL_DYNAMIC_DRAW);
+	glActiveTexture(GL_TEXTURE0 + POINT_LIGHT_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, pointLightTexture);
+
+	if (blackHole != nullptr)
+	{
+		frame.blackHolePosition = blackHole->position;
+		frame.blackHoleSize = blackHole->size;
+		frame.blackHoleVertexMin = blackHole->vrMin;
+		frame.blackHoleVertexMax = blackHole->vrMax;
+		frame.blackHoleObserverMin = blackHole->orMin;
+		frame.blackHoleObserverMax = blackHole->orMax;
+		frame.blackHoleWarp = glm::ivec3(blackHole->vrWarp, blackHole->vPhiWarp, blackHole->orWarp);
+		frame.blackHoleWarpParameter = glm::vec3(blackHole->vrWarpParameter, blackHole->vPhiWarpParameter, blackHole->orWarpParameter);
+		frame.blackHoleChannelScale = blackHole->channelScale;
+		frame.blackHoleChannelOffset = blackHole->channelOffset;
+		// every program reads it from the same unit, see assignSamplers
+		blackHole->bindTexture();
 	}
 
-	glUniform3fv(program->getUniform("dirLightDirections"), MAX_DIR_LIGHTS, glm::value_ptr(dirLightDirections[0]));
-	glUniform1fv(program->getUniform("dirLightIntensities"), MAX_DIR_LIGHTS, dirLightIntensities);
-	glUniform3fv(program->getUniform("pointLightPositions"), MAX_POINT_LIGHTS, glm::value_ptr(pointLightPositions[0]));
-	glUniform1fv(program->getUniform("pointLightIntensities"), MAX_POINT_LIGHTS, pointLightIntensities);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
 }
 
-void Scene::addBlackHoleToProgram(std::shared_ptr<Program> program)
+void Scene::assignSamplers()
 {
-	if (blackHole == nullptr)
+	for (auto& program : shaderPrograms)
 	{
-		return;
+		program->bind();
+		if (blackHole != nullptr)
+		{
+			glUniform1i(program->getUniform(UNIFORM_BLACK_HOLE_MESH), blackHole->textureUnit);
+		}
+		glUniform1i(program->getUniform(UNIFORM_POINT_LIGHTS), POINT_LIGHT_TEXTURE_UNIT);
+		glUniform1i(program->getUniform(UNIFORM_INSTANCE_TRANSFORMS), INSTANCE_TEXTURE_UNIT);
 	}
-	glUniform3f(program->getUniform("blackHolePosition"), blackHole->position.x, blackHole->position.y, blackHole->position.z);
-	glUniform1f(program->getUniform("blackHoleSize"), blackHole->size);
-	glUniform1f(program->getUniform("blackHoleVertexMin"), blackHole->vrMin);
-	glUniform1f(program->getUniform("blackHoleVertexMax"), blackHole->vrMax);
-	glUniform1f(program->getUniform("blackHoleObserverMin"), blackHole->orMin);
-	glUniform1f(program->getUniform("blackHoleObserverMax"), blackHole->orMax);
+	shaderPrograms[currentShaderProgramIndex]->bind();
 }
 
 void Scene::evaluateAllGlobalTransforms()
 {
+	ProfileScope scope(profiler.get(), transformSection);
 	for (auto& object : objects)
 	{
 		if (object->parent == nullptr)
@@ -236,4 +209,15 @@ void Scene::evaluateAllGlobalTransforms()
 			object->evaluateGlobalTransformsRecursive();
 		}
 	}
+	// once everything has moved
+	gatherLights();
+}
+
+void Scene::gatherLights()
+{
+	pointLightData.resize(pointLights.size());
+	for (size_t i = 0; i < pointLights.size(); i++)
+	{
+		pointLightData[i] = glm::vec4(pointLights[i]->getGlobalPosition(), pointLights[i]->intensity);
+	}
 }
@@ -5,49 +5,84 @@
 #include <vector>
 
 class Object;
+class MeshObject;
+class PointLightObject;
 class CameraObject;
 #include "Object.h"
 #include "Program.h"
 #include "MatrixStack.h"
+#include "BlackHoleMap.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
 
-constexpr auto MAX_TOTAL_LIGHTS = 6;
 constexpr auto MAX_DIR_LIGHTS = 3;
-constexpr auto MAX_POINT_LIGHTS = 3;
 
-class BlackHoleMap {
-public:
-	BlackHoleMap();
-	virtual ~BlackHoleMap();
-	glm::vec3 position;
-	float size;
-	int vrResolution;
-	float vrMax, vrMin;
-	int vPhiResolution;
-	int orResolution;
-	float orMin, orMax;
-	float* data;
-	GLuint textureID;
-	GLint textureUnit;
-	void loadFromFile(std::string path);
-	void sendToGPU();
-	glm::vec3 getValue(float vr, float vPhi, float orAngle);
-	void bind(GLint handle);
-	void unbind();
+// GL_UNIFORM_BUFFER binding of the FrameData block
+constexpr GLuint FRAME_UNIFORM_BINDING = 0;
+// the point light buffer texture, every lit program reads it from here
+constexpr GLint POINT_LIGHT_TEXTURE_UNIT = 2;
+// the render queue's instance transforms
+constexpr GLint INSTANCE_TEXTURE_UNIT = 3;
+
+// std140 layout of FrameData in simple_vert.glsl, keep the two in sync
+struct FrameUniforms
+{
+	glm::mat4 P;
+	glm::mat4 V;
+	glm::vec3 blackHolePosition;
+	float blackHoleSize;
+	float blackHoleVertexMin;
+	float blackHoleVertexMax;
+	float blackHoleObserverMin;
+	float blackHoleObserverMax;
+	glm::ivec3 blackHoleWarp;
+	GLint freeCam;
+	glm::vec3 blackHoleWarpParameter;
+	float padding0;
+	glm::vec3 blackHoleChannelScale;
+	float padding1;
+	glm::vec3 blackHoleChannelOffset;
+	float padding2;
+	// direction in xyz, intensity in w
+	glm::vec4 dirLights[MAX_DIR_LIGHTS];
 };
+static_assert(sizeof(FrameUniforms) == 224 + 16 * MAX_DIR_LIGHTS, "FrameUniforms must match std140");
 
 class Scene {
 private:
 	long nextAvailableId;
+	GLuint frameUniformBuffer;
+	// point lights don't fit in a fixed size block, so they go in a buffer texture
+	GLuint pointLightBuffer;
+	GLuint pointLightTexture;
+	std::vector<glm::vec4> viewPointLights;
+	bool samplersAssigned;
+	// points every program's blackHoleMesh at the black hole's texture unit, once
+	void assignSamplers();
 public:
 	Scene();
 	virtual ~Scene();
 	int currentShaderProgramIndex;
 	std::vector<std::shared_ptr<Program>> shaderPrograms;
 	std::vector<std::shared_ptr<Object>> objects;
+	// typed views of objects, kept up to date by addObject
+	std::vector<std::shared_ptr<MeshObject>> meshes;
+	std::vector<std::shared_ptr<PointLightObject>> pointLights;
+	std::vector<std::shared_ptr<CameraObject>> cameras;
+	// world space position and intensity of every point light, gathered by evaluateAllGlobalTransforms
+	std::vector<glm::vec4> pointLightData;
 	std::shared_ptr<BlackHoleMap> blackHole;
 	std::shared_ptr<CameraObject> activeCamera;
 	glm::mat4 viewMatrix;
 	glm::mat4 projectionMatrix;
+	// glDrawElements calls since the start, for benchmarks
+	long drawCalls;
+	FrameUniforms frameUniforms;
+	RenderQueue renderQueue;
+	// optional, the sections are -1 without one
+	std::shared_ptr<Profiler> profiler;
+	int transformSection, drawSection, primarySection, secondarySection, bothImagesSection;
+	void setProfiler(std::shared_ptr<Profiler> newProfiler);
 	long getNextAvailableId();
 	void computeCameraMatrices();
 	void drawAll(bool freeCam);
@@ -55,9 +90,10 @@ public:
 	void addShaderProgram(std::shared_ptr<Program> newShaderProgram);
 	void swapToShaderProgram(int shaderProgramIndex);
 	std::shared_ptr<Program> getCurrentShaderProgram();
-	void addLightsToProgram(std::shared_ptr<Program> program);
-	void addBlackHoleToProgram(std::shared_ptr<Program> program);
+	// gathers camera, lights and black hole into frameUniforms and uploads them
+	void updateFrameUniforms(bool freeCam);
 	void evaluateAllGlobalTransforms();
+	void gatherLights();
 };
 
 #endif
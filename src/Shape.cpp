@@ -1,18 +1,38 @@
 #include "Shape.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
 #include <assert.h>
 
+#include <glm/gtc/packing.hpp>
+
 #include "GLSL.h"
 #include "Program.h"
+#include "GeometryArena.h"
 
 using namespace std;
 
+bool Shape::compactVertices = true;
+NormalWeighting Shape::normalWeighting = NORMAL_WEIGHT_UNIFORM;
+
+MeshFootprint& MeshFootprint::operator+=(const MeshFootprint& other)
+{
+	bytes += other.bytes;
+	fetchBytes += other.fetchBytes;
+	floatBytes += other.floatBytes;
+	floatFetchBytes += other.floatFetchBytes;
+	return *this;
+}
+
 Shape::Shape(bool textured) :
-	eleBufID(0),
-	posBufID(0),
-	norBufID(0),
-	texBufID(0), 
-   vaoID(0)
+	arenaPool(-1),
+	baseVertex(0),
+	indexOffset(0),
+	vertexCount(0),
+	indexType(GL_UNSIGNED_INT),
+	indexCount(0)
 {
 	min = glm::vec3(0);
 	max = glm::vec3(0);
@@ -39,43 +59,7 @@ void Shape::createShape(tinyobj::shape_t & shape)
 void Shape::generateNormals()
 {
 	norBuf.assign(posBuf.size(), 0.0f);
-
-	for (size_t i = 0; i < eleBuf.size(); i += 3)
-	{
-		int vert0i = eleBuf[i];
-		int vert1i = eleBuf[i + 1];
-		int vert2i = eleBuf[i + 2];
-
-		glm::vec3 vert0(posBuf[3 * vert0i], posBuf[3 * vert0i + 1], posBuf[3 * vert0i + 2]);
-		glm::vec3 vert1(posBuf[3 * vert1i], posBuf[3 * vert1i + 1], posBuf[3 * vert1i + 2]);
-		glm::vec3 vert2(posBuf[3 * vert2i], posBuf[3 * vert2i + 1], posBuf[3 * vert2i + 2]);
-
-		glm::vec3 edge1 = vert1 - vert0;
-		glm::vec3 edge2 = vert2 - vert0;
-
-		glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
-
-		norBuf[3 * vert0i] += normal.x;
-		norBuf[3 * vert0i + 1] += normal.y;
-		norBuf[3 * vert0i + 2] += normal.z;
-
-		norBuf[3 * vert1i] += normal.x;
-		norBuf[3 * vert1i + 1] += normal.y;
-		norBuf[3 * vert1i + 2] += normal.z;
-
-		norBuf[3 * vert2i] += normal.x;
-		norBuf[3 * vert2i + 1] += normal.y;
-		norBuf[3 * vert2i + 2] += normal.z;
-	}
-
-	for (size_t i = 0; i < norBuf.size(); i += 3)
-	{
-		glm::vec3 normal(norBuf[i], norBuf[i + 1], norBuf[i + 2]);
-		normal = glm::normalize(normal);
-		norBuf[i] = normal.x;
-		norBuf[i + 1] = normal.y;
-		norBuf[i + 2] = normal.z;
-	}
+	Normals::generate(posBuf.data(), posBuf.size() / 3, eleBuf.data(), eleBuf.size(), norBuf.data(), normalWeighting, &Normals::getThreadPool());
 }
 
 void Shape::measure() {
@@ -107,90 +91,100 @@ void Shape::measure() {
 
 void Shape::init()
 {
-   // Initialize the vertex array object
-   glGenVertexArrays(1, &vaoID);
-   glBindVertexArray(vaoID);
-
-	// Send the position array to the GPU
-	glGenBuffers(1, &posBufID);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-	
-	// Send the normal array to the GPU
-	if(norBuf.empty()) {
-		norBufID = 0;
-	} else {
-		glGenBuffers(1, &norBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+	vector<unsigned char> vertexData, indexData;
+	upload(pack(vertexData, indexData));
+}
+
+PackedShape Shape::pack(vector<unsigned char>& vertexData, vector<unsigned char>& indexData) const
+{
+	PackedShape packed;
+	packed.vertexCount = posBuf.size() / 3;
+	packed.hasNormals = !norBuf.empty();
+	packed.textured = !texBuf.empty() && !texOff;
+	packed.min = min;
+	packed.max = max;
+	// every shape in the arena has a normal and a texcoord, zero when it has none
+	packed.format.packedNormals = compactVertices;
+	// halves are good to about half a texel of a 1024 texture below 1, past that they get coarse
+	packed.format.halfTexCoords = compactVertices
+		&& all_of(texBuf.begin(), texBuf.end(), [](float t) { return fabs(t) <= 1.0f; });
+
+	size_t normalOffset = packed.format.getNormalOffset();
+	size_t texOffset = packed.format.getTexOffset();
+	size_t stride = packed.format.getStride();
+	vertexData.assign(packed.vertexCount * stride, 0);
+	for (size_t v = 0; v < packed.vertexCount; v++)
+	{
+		unsigned char *vertex = &vertexData[v * stride];
+		memcpy(vertex, &posBuf[3 * v], 3 * sizeof(float));
+		if (packed.hasNormals && packed.format.packedNormals)
+		{
+			uint32_t normal = glm::packSnorm3x10_1x2(glm::vec4(norBuf[3 * v], norBuf[3 * v + 1], norBuf[3 * v + 2], 0.0f));
+			memcpy(vertex + normalOffset, &normal, sizeof(normal));
+		}
+		else if (packed.hasNormals)
+		{
+			memcpy(vertex + normalOffset, &norBuf[3 * v], 3 * sizeof(float));
+		}
+		if (packed.textured && packed.format.halfTexCoords)
+		{
+			uint32_t texCoord = glm::packHalf2x16(glm::vec2(texBuf[2 * v], texBuf[2 * v + 1]));
+			memcpy(vertex + texOffset, &texCoord, sizeof(texCoord));
+		}
+		else if (packed.textured)
+		{
+			memcpy(vertex + texOffset, &texBuf[2 * v], 2 * sizeof(float));
+		}
 	}
-	
-	// Send the texture array to the GPU - for now no textures
-	if(texBuf.empty() || texOff) {
-		texBufID = 0;
+
+	// indices are relative to the shape's base vertex, so 16 bits do whenever every vertex fits
+	packed.indexCount = eleBuf.size();
+	if (packed.vertexCount <= 0x10000) {
+		packed.indexSize = sizeof(uint16_t);
+		indexData.resize(packed.indexCount * packed.indexSize);
+		uint16_t *shortIndices = reinterpret_cast<uint16_t *>(indexData.data());
+		for (size_t i = 0; i < packed.indexCount; i++) {
+			shortIndices[i] = (uint16_t)eleBuf[i];
+		}
 	} else {
-		glGenBuffers(1, &texBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-		glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+		packed.indexSize = sizeof(unsigned int);
+		indexData.resize(packed.indexCount * packed.indexSize);
+		memcpy(indexData.data(), eleBuf.data(), indexData.size());
 	}
-	
-	// Send the element array to the GPU
-	glGenBuffers(1, &eleBufID);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size()*sizeof(unsigned int), &eleBuf[0], GL_STATIC_DRAW);
-	
-	// Unbind the arrays
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	
+	packed.vertices = vertexData.data();
+	packed.indices = indexData.data();
+	return packed;
+}
+
+void Shape::upload(const PackedShape& packed)
+{
+	vertexCount = packed.vertexCount;
+	indexCount = packed.indexCount;
+	indexType = packed.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	min = packed.min;
+	max = packed.max;
+	GeometryArena::Range range = GeometryArena::get().add(packed.format, packed.vertices, packed.vertexCount, packed.indices, packed.indexCount, packed.indexSize);
+	arenaPool = range.pool;
+	baseVertex = range.baseVertex;
+	indexOffset = range.indexOffset;
+
+	size_t stride = packed.format.getStride();
+	size_t floatStride = (3 + (packed.hasNormals ? 3 : 0) + (packed.textured ? 2 : 0)) * sizeof(float);
+	footprint.bytes = vertexCount * stride + indexCount * packed.indexSize;
+	footprint.fetchBytes = indexCount * (stride + packed.indexSize);
+	footprint.floatBytes = vertexCount * floatStride + indexCount * sizeof(unsigned int);
+	footprint.floatFetchBytes = indexCount * (floatStride + sizeof(unsigned int));
+
 	assert(glGetError() == GL_NO_ERROR);
 }
 
-//always untextured for intro labs until texture mapping
-void Shape::draw(const shared_ptr<Program> prog) const
+size_t Shape::getFirstIndex() const
 {
-	int h_pos, h_nor, h_tex;
-	h_pos = h_nor = h_tex = -1;
-
-   glBindVertexArray(vaoID);
-	// Bind position buffer
-	h_pos = prog->getAttribute("vertPos");
-	GLSL::enableVertexAttribArray(h_pos);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-	
-	// Bind normal buffer
-	h_nor = prog->getAttribute("vertNor");
-	if(h_nor != -1 && norBufID != 0) {
-		GLSL::enableVertexAttribArray(h_nor);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-	}
+	return indexOffset / (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int));
+}
 
-	if (texBufID != 0) {	
-		// Bind texcoords buffer
-		h_tex = prog->getAttribute("vertTex");
-		if(h_tex != -1 && texBufID != 0) {
-			GLSL::enableVertexAttribArray(h_tex);
-			glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-			glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-		}
-	}
-	
-	// Bind element buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-	
-	// Draw
-	glDrawElements(GL_TRIANGLES, (int)eleBuf.size(), GL_UNSIGNED_INT, (const void *)0);
-	
-	// Disable and unbind
-	if(h_tex != -1) {
-		GLSL::disableVertexAttribArray(h_tex);
-	}
-	if(h_nor != -1) {
-		GLSL::disableVertexAttribArray(h_nor);
-	}
-	GLSL::disableVertexAttribArray(h_pos);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Shape::draw(const shared_ptr<Program> prog, int instances) const
+{
+	GeometryArena::get().bind(arenaPool);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (int)indexCount, indexType, (const void *)indexOffset, instances, baseVertex);
 }
@@ -8,18 +8,72 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <tiny_obj_loader/tiny_obj_loader.h>
 
+#include "GeometryArena.h"
+#include "Normals.h"
+
 class Program;
 
+// GPU memory of a mesh and the bytes one draw of it fetches (every index and the
+// vertex it points at, ignoring the post-transform cache), as stored and as the
+// separate 32 bit float arrays and 32 bit indices it started out as
+struct MeshFootprint
+{
+	size_t bytes = 0;
+	size_t fetchBytes = 0;
+	size_t floatBytes = 0;
+	size_t floatFetchBytes = 0;
+	MeshFootprint& operator+=(const MeshFootprint& other);
+};
+
+// A shape's vertices and indices exactly as they go into the GeometryArena.
+// Doesn't own them, they live in Shape::pack's buffers or a mapped MeshCache file.
+struct PackedShape
+{
+	GeometryArena::VertexFormat format;
+	// what the shape had before packing, for its MeshFootprint
+	bool hasNormals;
+	bool textured;
+	glm::vec3 min;
+	glm::vec3 max;
+	const void *vertices;
+	size_t vertexCount;
+	const void *indices;
+	size_t indexCount;
+	// 2 or 4
+	size_t indexSize;
+};
+
 class Shape
 {
 public:
+	// packed 10_10_10_2 normals and half texcoords; turn off before loading
+	// anything to keep full floats, for comparing. Indices are 16 bit either way
+	// when the mesh has few enough vertices. Everything goes in the GeometryArena
+	static bool compactVertices;
+	// for shapes that come without normals; also set before loading anything
+	static NormalWeighting normalWeighting;
 	Shape(bool textured);
 	virtual ~Shape();
 	void createShape(tinyobj::shape_t & shape);
 	void generateNormals();
+	// pack() then upload()
 	void init();
+	// interleaves the vertices and narrows the indices, into the given buffers
+	PackedShape pack(std::vector<unsigned char>& vertexData, std::vector<unsigned char>& indexData) const;
+	// copies a packed shape into the GeometryArena; the CPU side arrays stay as they
+	// are, so a shape loaded this way has none
+	void upload(const PackedShape& packed);
 	void measure();
-	void draw(const std::shared_ptr<Program> prog) const;
+	void draw(const std::shared_ptr<Program> prog, int instances = 1) const;
+	size_t getVertexCount() const { return vertexCount; }
+	const MeshFootprint& getFootprint() const { return footprint; }
+	// where the shape sits in the GeometryArena, for building indirect draws
+	int getArenaPool() const { return arenaPool; }
+	unsigned getIndexType() const { return indexType; }
+	size_t getIndexCount() const { return indexCount; }
+	int getBaseVertex() const { return baseVertex; }
+	// in indices, not bytes
+	size_t getFirstIndex() const;
 	glm::vec3 min;
 	glm::vec3 max;
 	std::vector<float> norBuf;
@@ -28,11 +82,14 @@ private:
 	std::vector<unsigned int> eleBuf;
 	std::vector<float> posBuf;
 	std::vector<float> texBuf;
-	unsigned eleBufID;
-	unsigned posBufID;
-	unsigned norBufID;
-	unsigned texBufID;
-    unsigned vaoID;
+	// where init() put the vertices and indices in the GeometryArena
+	int arenaPool;
+	int baseVertex;
+	size_t indexOffset;
+	size_t vertexCount;
+	unsigned indexType;
+	size_t indexCount;
+	MeshFootprint footprint;
 	bool texOff;
 };
 
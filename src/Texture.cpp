@@ -1,16 +1,82 @@
 #include "Texture.h"
+#include "TextureCache.h"
 #include "GLSL.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
+// sums[i] = a[i] + b[i], the vertical half of the box filter
+static void addRows(const unsigned char *a, const unsigned char *b, uint16_t *sums, size_t count)
+{
+	size_t i = 0;
+#ifdef TEXTURE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i rowA = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		__m128i rowB = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i), _mm_add_epi16(_mm_unpacklo_epi8(rowA, zero), _mm_unpacklo_epi8(rowB, zero)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(rowA, zero), _mm_unpackhi_epi8(rowB, zero)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		sums[i] = (uint16_t)(a[i] + b[i]);
+	}
+}
+
+// halves an RGB image with a 2x2 box filter, the same one glGenerateMipmap uses;
+// an odd last row or column is averaged with itself
+static void downsample(const unsigned char *source, int width, int height, unsigned char *destination)
+{
+	int halfWidth = max(1, width / 2);
+	int halfHeight = max(1, height / 2);
+	vector<uint16_t> sums((size_t)width * 3);
+	for (int y = 0; y < halfHeight; y++)
+	{
+		const unsigned char *top = source + (size_t)min(2 * y, height - 1) * width * 3;
+		const unsigned char *bottom = source + (size_t)min(2 * y + 1, height - 1) * width * 3;
+		addRows(top, bottom, sums.data(), (size_t)width * 3);
+		unsigned char *row = destination + (size_t)y * halfWidth * 3;
+		for (int x = 0; x < halfWidth; x++)
+		{
+			const uint16_t *left = sums.data() + min(2 * x, width - 1) * 3;
+			const uint16_t *right = sums.data() + min(2 * x + 1, width - 1) * 3;
+			for (int c = 0; c < 3; c++)
+			{
+				row[3 * x + c] = (unsigned char)((left[c] + right[c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+bool Texture::compress = true;
+
 Texture::Texture() :
+	decodeTime(0.0),
+	mipTime(0.0),
+	encodeTime(0.0),
+	fromCache(false),
 	filename(""),
-	tid(0)
+	width(0),
+	height(0),
+	tid(0),
+	format(GL_RGB),
+	bytes(0),
+	baseLevel(0)
 {
 	
 }
@@ -22,46 +88,170 @@ Texture::~Texture()
 
 void Texture::init()
 {
-	// Load texture
+	create();
+	beginUpload(prepare(filename));
+	while (uploadNextLevel())
+	{
+	}
+}
+
+unique_ptr<TextureData> Texture::prepare(const std::string& filename)
+{
+	auto data = make_unique<TextureData>();
+	auto decodeStart = chrono::steady_clock::now();
+	if (compress && TextureCache::load(filename, *data))
+	{
+		data->decodeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - decodeStart).count();
+		return data;
+	}
+	// Load texture, always as RGB
 	int w, h, ncomps;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char *data = stbi_load(filename.c_str(), &w, &h, &ncomps, 0);
-	if(!data) {
+	unsigned char *pixels = stbi_load(filename.c_str(), &w, &h, &ncomps, 3);
+	if(!pixels) {
 		cerr << filename << " not found" << endl;
+		return data;
 	}
 	if(ncomps != 3) {
-		cerr << filename << " must have 3 components (RGB)" << endl;
+		cerr << filename << " has " << ncomps << " components, converted to RGB" << endl;
 	}
 	if((w & (w - 1)) != 0 || (h & (h - 1)) != 0) {
-		cerr << filename << " must be a power of 2" << endl;
+		cerr << filename << " should be a power of 2" << endl;
+	}
+	data->width = w;
+	data->height = h;
+
+	// flipped while copying out instead of with stbi_set_flip_vertically_on_load, which is global
+	size_t rowBytes = (size_t)w * 3;
+	data->storage.emplace_back(rowBytes * h);
+	for (int y = 0; y < h; y++)
+	{
+		memcpy(data->storage[0].data() + (size_t)y * rowBytes, pixels + (size_t)(h - 1 - y) * rowBytes, rowBytes);
 	}
-	width = w;
-	height = h;
+	stbi_image_free(pixels);
+	auto mipStart = chrono::steady_clock::now();
+	data->decodeTime = chrono::duration<double, milli>(mipStart - decodeStart).count();
 
+	// Generate image pyramid
+	while (w > 1 || h > 1)
+	{
+		int halfWidth = max(1, w / 2);
+		int halfHeight = max(1, h / 2);
+		vector<unsigned char> level((size_t)halfWidth * halfHeight * 3);
+		downsample(data->storage.back().data(), w, h, level.data());
+		data->storage.push_back(move(level));
+		w = halfWidth;
+		h = halfHeight;
+	}
+	auto encodeStart = chrono::steady_clock::now();
+	data->mipTime = chrono::duration<double, milli>(encodeStart - mipStart).count();
+
+	if (compress)
+	{
+		w = data->width;
+		h = data->height;
+		for (auto& level : data->storage)
+		{
+			vector<unsigned char> blocks(TextureCache::getBC1Size(w, h));
+			TextureCache::encodeBC1(level.data(), w, h, blocks.data());
+			level = move(blocks);
+			w = max(1, w / 2);
+			h = max(1, h / 2);
+		}
+		data->format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		data->encodeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - encodeStart).count();
+	}
+	for (auto& level : data->storage)
+	{
+		data->levels.push_back(level.data());
+		data->levelSizes.push_back(level.size());
+	}
+	if (compress)
+	{
+		TextureCache::save(filename, *data);
+	}
+	return data;
+}
+
+void Texture::create()
+{
 	// Generate a texture buffer object
 	glGenTextures(1, &tid);
-	// Bind the current texture to be the newly generated texture object
 	glBindTexture(GL_TEXTURE_2D, tid);
-	// Load the actual texture data
-	// Base level is 0, number of channels is 3, and border is 0.
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	// Generate image pyramid
-	glGenerateMipmap(GL_TEXTURE_2D);
 	// Set texture wrap modes for the S and T directions
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	// Set filtering mode for magnification and minimification
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	// Unbind
 	glBindTexture(GL_TEXTURE_2D, 0);
-	// Free image, since the data is now on the GPU
-	stbi_image_free(data);
+}
+
+void Texture::beginUpload(unique_ptr<TextureData> data)
+{
+	decodeTime = data->decodeTime;
+	mipTime = data->mipTime;
+	encodeTime = data->encodeTime;
+	fromCache = data->fromCache;
+	if (data->levels.empty())
+	{
+		// stays incomplete and samples black
+		return;
+	}
+	width = data->width;
+	height = data->height;
+	format = data->format;
+	bytes = 0;
+	baseLevel = (int)data->levels.size();
+	pending = move(data);
+	glBindTexture(GL_TEXTURE_2D, tid);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, baseLevel - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// the 1x1 level at least, then everything too small to be worth a frame of its own
+	while (uploadNextLevel() && max(width >> (baseLevel - 1), height >> (baseLevel - 1)) <= TEXTURE_STREAM_FIRST_SIZE)
+	{
+	}
+}
+
+bool Texture::uploadNextLevel()
+{
+	if (pending == nullptr)
+	{
+		return false;
+	}
+	baseLevel--;
+	GLsizei levelWidth = max(1, width >> baseLevel);
+	GLsizei levelHeight = max(1, height >> baseLevel);
+	size_t levelSize = pending->levelSizes[baseLevel];
+	glBindTexture(GL_TEXTURE_2D, tid);
+	if (format == GL_RGB)
+	{
+		// the small levels' rows aren't 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, baseLevel, GL_RGB, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pending->levels[baseLevel]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	else
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, baseLevel, format, levelWidth, levelHeight, 0, (GLsizei)levelSize, pending->levels[baseLevel]);
+	}
+	// sampling is clamped to the levels that are in so far
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	bytes += levelSize;
+	if ((size_t)baseLevel < pending->storage.size())
+	{
+		vector<unsigned char>().swap(pending->storage[baseLevel]);
+	}
+	if (baseLevel == 0)
+	{
+		pending = nullptr;
+	}
+	return pending != nullptr;
 }
 
 void Texture::setWrapModes(GLint wrapS, GLint wrapT)
 {
-	// Must be called after init()
+	// Must be called after init() or create()
 	glBindTexture(GL_TEXTURE_2D, tid);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
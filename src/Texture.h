@@ -4,6 +4,37 @@
 
 #include <glad/glad.h>
 #include <string>
+#include <vector>
+#include <memory>
+
+#include "MappedFile.h"
+
+// BC1, from EXT_texture_compression_s3tc, which glad's 3.3 loader doesn't know about
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// levels no bigger than this go up together when a texture starts streaming
+constexpr int TEXTURE_STREAM_FIRST_SIZE = 256;
+
+// a decoded image and its mip chain, see Texture::prepare
+struct TextureData
+{
+	int width = 0;
+	int height = 0;
+	// GL_RGB, or GL_COMPRESSED_RGB_S3TC_DXT1_EXT when compressed
+	GLenum format = GL_RGB;
+	// level 0 first, each half the size of the one before down to 1x1, pointing
+	// into cacheFile or storage; empty if decoding failed
+	std::vector<const unsigned char*> levels;
+	std::vector<size_t> levelSizes;
+	std::vector<std::vector<unsigned char>> storage;
+	MappedFile cacheFile;
+	bool fromCache = false;
+	double decodeTime = 0.0;
+	double mipTime = 0.0;
+	double encodeTime = 0.0;
+};
 
 class Texture
 {
@@ -11,20 +42,50 @@ public:
 	Texture();
 	virtual ~Texture();
 	void setFilename(const std::string &f) { filename = f; }
+	const std::string& getFilename() const { return filename; }
+	// prepare(), create() and every level uploaded, in one go
 	void init();
+	// maps the TextureCache or decodes the file and builds its mip chain (and
+	// compresses it and writes the cache, with compress set); no GL, so any thread will do
+	static std::unique_ptr<TextureData> prepare(const std::string& filename);
+	// BC1 instead of RGB8, set from the context before loading anything
+	static bool compress;
+	// makes the texture object with no images yet, so it can be bound and have its wrap modes set
+	void create();
+	// uploads the coarse levels (up to TEXTURE_STREAM_FIRST_SIZE) and keeps the rest for uploadNextLevel
+	void beginUpload(std::unique_ptr<TextureData> data);
+	// uploads the next finer level and samples from it; false once level 0 is in
+	bool uploadNextLevel();
+	bool isStreaming() const { return pending != nullptr; }
+	int getBaseLevel() const { return baseLevel; }
 	void setUnit(GLint u) { unit = u; }
 	GLint getUnit() const { return unit; }
 	void bind(GLint handle);
 	void unbind();
-	void setWrapModes(GLint wrapS, GLint wrapT); // Must be called after init()
+	void setWrapModes(GLint wrapS, GLint wrapT); // Must be called after init() or create()
 	GLint getID() const { return tid;}
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	// bytes of every level on the GPU once they are all in
+	size_t getBytes() const { return bytes; }
+	// ms spent decoding, building mips and compressing in prepare(), and whether
+	// it came from the TextureCache
+	double decodeTime;
+	double mipTime;
+	double encodeTime;
+	bool fromCache;
 private:
 	std::string filename;
 	int width;
 	int height;
 	GLuint tid;
 	GLint unit;
-	
+	GLenum format;
+	size_t bytes;
+	// levels still to upload, finest last
+	std::unique_ptr<TextureData> pending;
+	int baseLevel;
+
 };
 
 #endif
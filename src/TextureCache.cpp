@@ -0,0 +1,337 @@
+#include "TextureCache.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "CacheFile.h"
+
+namespace
+{
+
+struct Block
+{
+	uint16_t color0;
+	uint16_t color1;
+	uint32_t indices;
+	float error;
+};
+
+uint16_t to565(const float *color)
+{
+	int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// the 8 bit color a decoder expands a 565 one to
+void from565(uint16_t packed, float *color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (float)((r << 3) | (r >> 2));
+	color[1] = (float)((g << 2) | (g >> 4));
+	color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// nearest of the four colors between a and b for every pixel; a and b are
+// ordered so the block decodes in four color mode
+Block fit(const float pixels[16][3], uint16_t a, uint16_t b)
+{
+	Block block;
+	block.color0 = std::max(a, b);
+	block.color1 = std::min(a, b);
+	block.indices = 0;
+	block.error = 0.0f;
+	float palette[4][3];
+	from565(block.color0, palette[0]);
+	from565(block.color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+	// equal endpoints would mean three color mode, where index 3 is black; stick to index 0
+	int paletteSize = block.color0 == block.color1 ? 1 : 4;
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		float bestError = 0.0f;
+		for (int entry = 0; entry < paletteSize; entry++)
+		{
+			float error = 0.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				float difference = pixels[i][c] - palette[entry][c];
+				error += difference * difference;
+			}
+			if (entry == 0 || error < bestError)
+			{
+				best = entry;
+				bestError = error;
+			}
+		}
+		block.indices |= (uint32_t)best << (2 * i);
+		block.error += bestError;
+	}
+	return block;
+}
+
+// endpoints at the ends of the pixels' principal axis, then one least squares
+// pass on the endpoints for the indices those picked
+Block encodeBlock(const float pixels[16][3])
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += pixels[i][c] / 16.0f;
+		}
+	}
+	float covariance[3][3] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				covariance[row][column] += (pixels[i][row] - mean[row]) * (pixels[i][column] - mean[column]);
+			}
+		}
+	}
+	// power iteration, a few steps are plenty for picking endpoints
+	float axis[3] = { 0.57735f, 0.57735f, 0.57735f };
+	for (int step = 0; step < 8; step++)
+	{
+		float next[3];
+		for (int row = 0; row < 3; row++)
+		{
+			next[row] = covariance[row][0] * axis[0] + covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+		}
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			axis[c] = next[c] / length;
+		}
+	}
+	float low = 0.0f;
+	float high = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+		low = std::min(low, t);
+		high = std::max(high, t);
+	}
+	float start[3];
+	float end[3];
+	for (int c = 0; c < 3; c++)
+	{
+		start[c] = mean[c] + axis[c] * high;
+		end[c] = mean[c] + axis[c] * low;
+	}
+	Block best = fit(pixels, to565(start), to565(end));
+	if (best.color0 == best.color1)
+	{
+		return best;
+	}
+
+	// weight of color0 for each index
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = {}, bx[3] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		float w = weights[(best.indices >> (2 * i)) & 3];
+		aa += w * w;
+		bb += (1.0f - w) * (1.0f - w);
+		ab += w * (1.0f - w);
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += w * pixels[i][c];
+			bx[c] += (1.0f - w) * pixels[i][c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) > 1e-6f)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			start[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			end[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		Block refined = fit(pixels, to565(start), to565(end));
+		if (refined.error < best.error)
+		{
+			best = refined;
+		}
+	}
+	return best;
+}
+
+// down to 1x1
+uint32_t countLevels(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		count++;
+	}
+	return count;
+}
+
+}
+
+namespace TextureCache
+{
+
+std::string directory;
+
+size_t getBC1Size(int width, int height)
+{
+	return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * 8;
+}
+
+void encodeBC1(const unsigned char *rgb, int width, int height, unsigned char *blocks)
+{
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			// partial blocks at the edges repeat the last row and column
+			float pixels[16][3];
+			for (int i = 0; i < 16; i++)
+			{
+				int x = std::min(blockX + i % 4, width - 1);
+				int y = std::min(blockY + i / 4, height - 1);
+				const unsigned char *pixel = rgb + ((size_t)y * width + x) * 3;
+				for (int c = 0; c < 3; c++)
+				{
+					pixels[i][c] = pixel[c];
+				}
+			}
+			Block block = encodeBlock(pixels);
+			// little endian, like every GPU reads it
+			unsigned char bytes[8] = {
+				(unsigned char)block.color0, (unsigned char)(block.color0 >> 8),
+				(unsigned char)block.color1, (unsigned char)(block.color1 >> 8),
+				(unsigned char)block.indices, (unsigned char)(block.indices >> 8),
+				(unsigned char)(block.indices >> 16), (unsigned char)(block.indices >> 24)
+			};
+			std::memcpy(blocks, bytes, sizeof(bytes));
+			blocks += sizeof(bytes);
+		}
+	}
+}
+
+std::string getCachePath(const std::string& sourcePath)
+{
+	return CacheFile::getPath(directory, sourcePath, ".bhtex");
+}
+
+bool load(const std::string& sourcePath, TextureData& data)
+{
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	MappedFile& file = data.cacheFile;
+	if (directory.empty() || !CacheFile::statSource(sourcePath, sourceSize, sourceTime) || !file.open(getCachePath(sourcePath)))
+	{
+		return false;
+	}
+
+	const unsigned char *bytes = file.getData();
+	size_t size = file.getSize();
+	TextureCacheHeader header;
+	if (size < sizeof(header))
+	{
+		file.close();
+		return false;
+	}
+	std::memcpy(&header, bytes, sizeof(header));
+	size_t levelsOffset = sizeof(header) + header.pathLength;
+	bool current = std::memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) == 0
+		&& header.version == TEXTURE_CACHE_VERSION
+		&& header.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		&& header.sourceSize == sourceSize && header.sourceTime == sourceTime
+		&& header.width > 0 && header.height > 0 && header.levelCount == countLevels(header.width, header.height)
+		&& levelsOffset + (uint64_t)header.levelCount * sizeof(TextureCacheLevel) <= size
+		&& std::string((const char *)bytes + sizeof(header), header.pathLength) == sourcePath;
+	if (!current)
+	{
+		file.close();
+		return false;
+	}
+
+	data.levels.clear();
+	data.levelSizes.clear();
+	int width = (int)header.width;
+	int height = (int)header.height;
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		TextureCacheLevel level;
+		std::memcpy(&level, bytes + levelsOffset + i * sizeof(level), sizeof(level));
+		if (level.size != getBC1Size(width, height) || level.offset + level.size > size)
+		{
+			std::cerr << "Corrupt texture cache for " << sourcePath << ", rebuilding it" << std::endl;
+			data.levels.clear();
+			data.levelSizes.clear();
+			file.close();
+			return false;
+		}
+		data.levels.push_back(bytes + level.offset);
+		data.levelSizes.push_back((size_t)level.size);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	data.width = (int)header.width;
+	data.height = (int)header.height;
+	data.format = header.format;
+	data.fromCache = true;
+	return true;
+}
+
+bool save(const std::string& sourcePath, const TextureData& data)
+{
+	TextureCacheHeader header = {};
+	if (directory.empty() || data.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT || !CacheFile::statSource(sourcePath, header.sourceSize, header.sourceTime))
+	{
+		return false;
+	}
+	std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+	header.version = TEXTURE_CACHE_VERSION;
+	header.format = data.format;
+	header.width = (uint32_t)data.width;
+	header.height = (uint32_t)data.height;
+	header.levelCount = (uint32_t)data.levels.size();
+	header.pathLength = (uint32_t)sourcePath.size();
+
+	std::vector<TextureCacheLevel> entries(data.levels.size());
+	uint64_t offset = sizeof(header) + sourcePath.size() + entries.size() * sizeof(TextureCacheLevel);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].offset = CacheFile::align(offset);
+		entries[i].size = data.levelSizes[i];
+		offset = entries[i].offset + entries[i].size;
+	}
+
+	std::vector<CacheFilePiece> pieces = {
+		{ 0, &header, sizeof(header) },
+		{ sizeof(header), sourcePath.data(), sourcePath.size() },
+		{ sizeof(header) + sourcePath.size(), entries.data(), entries.size() * sizeof(TextureCacheLevel) }
+	};
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		pieces.push_back({ entries[i].offset, data.levels[i], (size_t)entries[i].size });
+	}
+	return CacheFile::write(getCachePath(sourcePath), pieces);
+}
+
+}
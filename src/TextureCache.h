@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _TEXTURE_CACHE_H_
+#define _TEXTURE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "Texture.h"
+
+// Binary cache of a texture's compressed mip chain (.bhtex). The header is
+// followed by the source path, one entry per level and then every level's
+// blocks exactly as glCompressedTexImage2D takes them, so a hit is a mapping
+// and an upload with no decoding. Like the MeshCache, the source's size and
+// modification time are recorded and the cache is rebuilt if either changes.
+constexpr char TEXTURE_CACHE_MAGIC[8] = { 'B', 'H', 'T', 'E', 'X', '\r', '\n', '\x1a' };
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	// the GL enum of the blocks
+	uint32_t format;
+	uint64_t sourceSize;
+	// whatever the filesystem clock counts in, only ever compared for equality
+	int64_t sourceTime;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t pathLength;
+};
+
+struct TextureCacheLevel
+{
+	// from the start of the file, aligned to CACHE_FILE_ALIGNMENT
+	uint64_t offset;
+	uint64_t size;
+};
+
+static_assert(sizeof(TextureCacheHeader) == 48, "TextureCacheHeader layout changed");
+static_assert(sizeof(TextureCacheLevel) == 16, "TextureCacheLevel layout changed");
+
+namespace TextureCache
+{
+	// where the caches go, one file per source named after a hash of its path;
+	// empty turns caching off
+	extern std::string directory;
+	std::string getCachePath(const std::string& sourcePath);
+	// maps the cache for sourcePath into data if it is there and current
+	bool load(const std::string& sourcePath, TextureData& data);
+	// data has to be compressed already
+	bool save(const std::string& sourcePath, const TextureData& data);
+
+	// bytes of a BC1 image, 8 per 4x4 block with partial blocks rounded up
+	size_t getBC1Size(int width, int height);
+	// compresses an RGB8 image to BC1, into getBC1Size(width, height) bytes
+	void encodeBC1(const unsigned char *rgb, int width, int height, unsigned char *blocks);
+}
+
+#endif
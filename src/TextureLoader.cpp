@@ -0,0 +1,62 @@
+#include "TextureLoader.h"
+#include <chrono>
+
+TextureLoader::TextureLoader(unsigned threadCount) :
+	pool(threadCount)
+{
+}
+
+std::shared_ptr<Texture> TextureLoader::load(const std::string& path)
+{
+	auto texture = std::make_shared<Texture>();
+	texture->setFilename(path);
+	texture->create();
+	pending.push_back({ texture, pool.submit([path]() { return Texture::prepare(path); }) });
+	return texture;
+}
+
+size_t TextureLoader::poll()
+{
+	for (size_t i = 0; i < pending.size();)
+	{
+		if (pending[i].data.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			pending[i].texture->beginUpload(pending[i].data.get());
+			if (pending[i].texture->isStreaming())
+			{
+				streaming.push_back(pending[i].texture);
+			}
+			pending.erase(pending.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return pending.size();
+}
+
+void TextureLoader::finishDecoding()
+{
+	while (poll() > 0)
+	{
+		pending.front().data.wait_for(std::chrono::milliseconds(1));
+	}
+}
+
+size_t TextureLoader::stream()
+{
+	poll();
+	for (size_t i = 0; i < streaming.size();)
+	{
+		if (streaming[i]->uploadNextLevel())
+		{
+			i++;
+		}
+		else
+		{
+			streaming.erase(streaming.begin() + i);
+		}
+	}
+	return pending.size() + streaming.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef _TEXTURE_LOADER_H_
+#define _TEXTURE_LOADER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+
+#include "Texture.h"
+#include "ThreadPool.h"
+
+// Decodes textures and builds their mip chains on a ThreadPool (Texture::prepare).
+// Once one comes back its coarse levels go up together, then stream() uploads
+// one finer level per texture per frame, so the first frames sample a low mip
+// instead of waiting on the full size upload.
+class TextureLoader
+{
+public:
+	// zero threads means one per hardware thread
+	TextureLoader(unsigned threadCount = 0);
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+	// starts decoding straight away; the texture object exists (so wrap modes can
+	// be set) but has no images until poll or finishDecoding uploads its coarse levels
+	std::shared_ptr<Texture> load(const std::string& path);
+	// uploads the coarse levels of every texture that has decoded, on the GL
+	// thread, and returns how many are still decoding
+	size_t poll();
+	// waits for the rest of the decodes
+	void finishDecoding();
+	// poll, then the next finer level of every texture that has one left; returns
+	// how many textures are still decoding or streaming
+	size_t stream();
+private:
+	struct Pending
+	{
+		std::shared_ptr<Texture> texture;
+		std::future<std::unique_ptr<TextureData>> data;
+	};
+	ThreadPool pool;
+	std::vector<Pending> pending;
+	std::vector<std::shared_ptr<Texture>> streaming;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount) :
+	stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body, size_t chunkSize)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	chunkSize = std::max<size_t>(chunkSize, 1);
+
+	auto next = std::make_shared<std::atomic<size_t>>(0);
+	auto runChunks = [next, count, chunkSize, &body]()
+	{
+		while (true)
+		{
+			size_t begin = next->fetch_add(chunkSize);
+			if (begin >= count)
+			{
+				return;
+			}
+			size_t end = std::min(begin + chunkSize, count);
+			for (size_t i = begin; i < end; i++)
+			{
+				body(i);
+			}
+		}
+	};
+
+	size_t helperCount = std::min<size_t>(workers.size(), (count + chunkSize - 1) / chunkSize);
+	std::vector<std::future<void>> helpers;
+	for (size_t i = 0; i < helperCount; i++)
+	{
+		helpers.push_back(submit(runChunks));
+	}
+	runChunks();
+	for (auto& helper : helpers)
+	{
+		helper.get();
+	}
+}
+
+void ThreadPool::forEachRange(ThreadPool *pool, size_t count, size_t rangeSize, const std::function<void(size_t, size_t)>& body)
+{
+	rangeSize = std::max<size_t>(rangeSize, 1);
+	size_t ranges = (count + rangeSize - 1) / rangeSize;
+	auto runRange = [&](size_t range) { body(range * rangeSize, std::min(count, (range + 1) * rangeSize)); };
+	if (pool != nullptr && pool->getThreadCount() > 1)
+	{
+		pool->parallelFor(ranges, runRange);
+	}
+	else
+	{
+		for (size_t range = 0; range < ranges; range++)
+		{
+			runRange(range);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+// Fixed set of worker threads pulling tasks off a shared queue.
+// Tasks must not wait on other tasks from the same pool.
+class ThreadPool
+{
+public:
+	// zero means one worker per hardware thread
+	ThreadPool(unsigned threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	unsigned getThreadCount() const { return (unsigned)workers.size(); }
+
+	template<typename Task>
+	auto submit(Task task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push([packaged]() { (*packaged)(); });
+		}
+		condition.notify_one();
+		return result;
+	}
+
+	// runs body(i) for every i in [0, count) on the workers and the calling thread,
+	// handing out indices in chunks, and returns once all of them are done
+	void parallelFor(size_t count, const std::function<void(size_t)>& body, size_t chunkSize = 1);
+	// runs body(begin, end) over [0, count) in ranges of at most rangeSize, through
+	// parallelFor, or in order on the calling thread without a pool or with only one worker
+	static void forEachRange(ThreadPool *pool, size_t count, size_t rangeSize, const std::function<void(size_t, size_t)>& body);
+
+private:
+	void workerLoop();
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+};
+
+#endif
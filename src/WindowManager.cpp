@@ -30,7 +30,7 @@ WindowManager::~WindowManager()
 	}
 }
 
-bool WindowManager::init(int const width, int const height)
+bool WindowManager::init(int const width, int const height, bool visible, bool osmesa)
 {
 	glfwSetErrorCallback(error_callback);
 
@@ -45,6 +45,15 @@ bool WindowManager::init(int const width, int const height)
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+	glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+	if (osmesa)
+	{
+#ifdef GLFW_OSMESA_CONTEXT_API
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#else
+		std::cerr << "This GLFW is too old for OSMesa contexts, using the default one" << std::endl;
+#endif
+	}
 
 	// Create a windowed mode window and its OpenGL context.
 	windowHandle = glfwCreateWindow(width, height, "Final Project - Jacob Kelleran", nullptr, nullptr);
@@ -62,6 +71,7 @@ bool WindowManager::init(int const width, int const height)
 		std::cerr << "Failed to initialize GLAD" << std::endl;
 		return false;
 	}
+	GLSL::loadMultiDrawIndirect((GLADloadproc)glfwGetProcAddress);
 
 	std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
 	std::cout << "GLSL version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
@@ -57,7 +57,9 @@ public:
 	WindowManager(const WindowManager&) = delete;
 	WindowManager& operator= (const WindowManager&) = delete;
 
-	bool init(int const width, int const height);
+	// a hidden window still gets a context for rendering offscreen, and osmesa asks
+	// GLFW for a software context that needs no display server at all
+	bool init(int const width, int const height, bool visible = true, bool osmesa = false);
 	void shutdown();
 
 	void setEventCallbacks(EventCallbacks *callbacks);
@@ -6,17 +6,30 @@
  */
 
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <glad/glad.h>
 
 #include "GLSL.h"
 #include "Program.h"
 #include "Shape.h"
+#include "GeometryArena.h"
+#include "MeshCache.h"
+#include "ModelLoader.h"
+#include "TextureLoader.h"
+#include "TextureCache.h"
 #include "Model.h"
 #include "Object.h"
 #include "Scene.h"
 #include "Spline.h"
 #include "MatrixStack.h"
 #include "WindowManager.h"
+#include "Framebuffer.h"
+#include "FrameDumper.h"
+#include "CameraPath.h"
+#include "Profiler.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader/tiny_obj_loader.h>
@@ -106,6 +119,23 @@ public:
 	double timeSinceStart = 0.0;
 	double deltaTime = 0.0;
 
+	// headless runs draw into this instead of the window and follow cameraPath
+	bool headless = false;
+	shared_ptr<Framebuffer> offscreen;
+	CameraPath cameraPath;
+
+	// only set with --profile
+	shared_ptr<Profiler> profiler;
+	int updateSection = -1;
+	int renderSection = -1;
+
+	// only while the meshes load, see initGeom
+	unique_ptr<ModelLoader> modelLoader;
+	chrono::steady_clock::time_point geomStart;
+	// until every texture level is up, see streamTextures
+	unique_ptr<TextureLoader> textureLoader;
+	chrono::steady_clock::time_point textureStart;
+
 
 	void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 	{
@@ -165,6 +195,12 @@ public:
 			m_clawPart->useBlackHole = blackHoleActive;
 		}
 
+		if (key == GLFW_KEY_P && action == GLFW_PRESS)
+		{
+			scene->renderQueue.singlePass = !scene->renderQueue.singlePass;
+			cout << (scene->renderQueue.singlePass ? "single pass" : "two pass") << " black hole images" << endl;
+		}
+
 		if (key == GLFW_KEY_Z && action == GLFW_PRESS)
 		{
 			glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
@@ -235,34 +271,28 @@ public:
 	void init()
 	{
 		glfwGetFramebufferSize(windowManager->getHandle(), &windowWidth, &windowHeight);
-		toggleFpsCameraControl(windowManager->getHandle(), true);
+		if (!headless)
+		{
+			toggleFpsCameraControl(windowManager->getHandle(), true);
+		}
 	}
 
 	void initBasicShader(shared_ptr<Program> program)
 	{
 		program->setVerbose(true);
 		program->init();
-		program->addUniform("P");
-		program->addUniform("V");
-		program->addUniform("M");
+		program->addUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+		program->addUniform("instanceTransforms");
+		program->addUniform("instanceBase");
 		program->addUniform("blackHoleMesh");
-		program->addUniform("blackHolePosition");
-		program->addUniform("blackHoleSize");
-		program->addUniform("blackHoleVertexMin");
-		program->addUniform("blackHoleVertexMax");
-		program->addUniform("blackHoleObserverMin");
-		program->addUniform("blackHoleObserverMax");
 		program->addUniform("useBlackHole");
 		program->addUniform("blackHoleSecondary");
-		program->addUniform("freeCam");
+		program->addUniform("bothImages");
 		program->addUniform("flipNormals");
-		program->addUniform("dirLightDirections");
-		program->addUniform("dirLightIntensities");
-		program->addUniform("pointLightPositions");
-		program->addUniform("pointLightIntensities");
 		program->addAttribute("vertPos");
 		program->addAttribute("vertNor");
 		program->addAttribute("vertTex");
+		program->addAttribute("vertInstance");
 	}
 
 	void initShaders(const std::string& resourceDirectory)
@@ -299,15 +329,14 @@ public:
 		texBlinnPhongProg->addUniform("spec");
 		texBlinnPhongProg->addUniform("specIntensity");
 
-		t_skybox = make_shared<Texture>();
-		t_skybox->setFilename(resourceDirectory + "/textures/skybox.jpeg");
-		t_skybox->init();
+		// decoded on the texture loader's workers while everything else loads, see finishTextures
+		textureStart = chrono::steady_clock::now();
+		textureLoader = make_unique<TextureLoader>();
+		t_skybox = textureLoader->load(resourceDirectory + "/textures/skybox.jpeg");
 		t_skybox->setUnit(0);
 		t_skybox->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
-		t_rock = make_shared<Texture>();
-		t_rock->setFilename(resourceDirectory + "/textures/rock.jpg");
-		t_rock->init();
+		t_rock = textureLoader->load(resourceDirectory + "/textures/rock.jpg");
 		t_rock->setUnit(0);
 		t_rock->setWrapModes(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
@@ -371,22 +400,36 @@ public:
 			0.3,
 			5.0
 		);
+
+		s_normal->name = "normal";
+		s_texCoord->name = "texCoord";
+		s_white->name = "white";
+		s_black->name = "black";
+		s_blueWater->name = "blueWater";
+		s_redWater->name = "redWater";
+		s_metal->name = "metal";
+		s_marble->name = "marble";
+		s_skybox->name = "skybox";
+		s_rock->name = "rock";
 	}
 
+	// starts every mesh loading on the model loader's workers; finishGeom uploads them
 	void initGeom(const std::string& resourceDirectory)
 	{
-		m_uvSphere = make_shared<Model>(resourceDirectory + "/meshes/UVSphere.obj");
-		m_uvSphereHires = make_shared<Model>(resourceDirectory + "/meshes/UVSphereHires.obj");
-		m_icosphere = make_shared<Model>(resourceDirectory + "/meshes/Icosphere.obj");
-		m_icosphereHires = make_shared<Model>(resourceDirectory + "/meshes/IcosphereHires.obj");
-		m_island = make_shared<Model>(resourceDirectory + "/meshes/Island.obj");
-		m_chain = make_shared<Model>(resourceDirectory + "/meshes/Chain.obj");
-		m_pillar = make_shared<Model>(resourceDirectory + "/meshes/Pillar.obj");
-		m_clawBase = make_shared<Model>(resourceDirectory + "/meshes/ClawBase.obj");
-		m_clawPart = make_shared<Model>(resourceDirectory + "/meshes/ClawPart.obj");
-		m_rock1 = make_shared<Model>(resourceDirectory + "/meshes/Rock1.obj");
-		m_rock2 = make_shared<Model>(resourceDirectory + "/meshes/Rock2.obj");
-		m_rock3 = make_shared<Model>(resourceDirectory + "/meshes/Rock3.obj");
+		geomStart = chrono::steady_clock::now();
+		modelLoader = make_unique<ModelLoader>();
+		m_uvSphere = modelLoader->load(resourceDirectory + "/meshes/UVSphere.obj");
+		m_uvSphereHires = modelLoader->load(resourceDirectory + "/meshes/UVSphereHires.obj");
+		m_icosphere = modelLoader->load(resourceDirectory + "/meshes/Icosphere.obj");
+		m_icosphereHires = modelLoader->load(resourceDirectory + "/meshes/IcosphereHires.obj");
+		m_island = modelLoader->load(resourceDirectory + "/meshes/Island.obj");
+		m_chain = modelLoader->load(resourceDirectory + "/meshes/Chain.obj");
+		m_pillar = modelLoader->load(resourceDirectory + "/meshes/Pillar.obj");
+		m_clawBase = modelLoader->load(resourceDirectory + "/meshes/ClawBase.obj");
+		m_clawPart = modelLoader->load(resourceDirectory + "/meshes/ClawPart.obj");
+		m_rock1 = modelLoader->load(resourceDirectory + "/meshes/Rock1.obj");
+		m_rock2 = modelLoader->load(resourceDirectory + "/meshes/Rock2.obj");
+		m_rock3 = modelLoader->load(resourceDirectory + "/meshes/Rock3.obj");
 		m_uvSphere->useBlackHole = blackHoleActive;
 		m_uvSphereHires->useBlackHole = blackHoleActive;
 		m_icosphere->useBlackHole = blackHoleActive;
@@ -398,14 +441,128 @@ public:
 		m_clawPart->useBlackHole = blackHoleActive;
 	}
 
+	// uploads the meshes as the workers finish them, the scene needs them all
+	void finishGeom()
+	{
+		modelLoader->finishAll();
+		modelLoader = nullptr;
+		auto geomTime = chrono::duration<double, milli>(chrono::steady_clock::now() - geomStart).count();
+
+		pair<const char *, shared_ptr<Model>> models[] = {
+			{ "UVSphere", m_uvSphere }, { "UVSphereHires", m_uvSphereHires }, { "Icosphere", m_icosphere },
+			{ "IcosphereHires", m_icosphereHires }, { "Island", m_island }, { "Chain", m_chain }, { "Pillar", m_pillar },
+			{ "ClawBase", m_clawBase }, { "ClawPart", m_clawPart }, { "Rock1", m_rock1 }, { "Rock2", m_rock2 }, { "Rock3", m_rock3 }
+		};
+		MeshFootprint total;
+		for (auto& model : models)
+		{
+			MeshFootprint footprint = model.second->getFootprint();
+			cout << "Mesh " << model.first << ": " << (model.second->fromCache ? "cached" : "parsed") << " in "
+				<< model.second->loadTime << " ms (" << model.second->uploadTime << " uploading), " << footprint.bytes / 1024 << " KB (" << footprint.floatBytes / 1024
+				<< " KB as floats), " << footprint.fetchBytes / 1024 << " KB fetched per draw (" << footprint.floatFetchBytes / 1024 << " KB)" << endl;
+			total += footprint;
+		}
+		cout << "Meshes: " << total.bytes / 1024 << " KB on the GPU, " << total.floatBytes / 1024 << " KB with float vertices, loaded in "
+			<< geomTime << " ms" << endl;
+		GeometryArena& arena = GeometryArena::get();
+		cout << "Geometry arena: " << arena.getPoolCount() << " pool(s), " << arena.getUsedBytes() / 1024 << " KB used of "
+			<< arena.getCapacityBytes() / 1024 << " KB" << endl;
+	}
+
+	// waits for the texture decodes and uploads their coarse levels, enough for the first frame
+	void finishTextures()
+	{
+		textureLoader->finishDecoding();
+		auto textureTime = chrono::duration<double, milli>(chrono::steady_clock::now() - textureStart).count();
+		for (auto& texture : { t_skybox, t_rock })
+		{
+			if (texture->fromCache)
+			{
+				cout << "Texture " << texture->getFilename() << ": " << texture->getWidth() << "x" << texture->getHeight() << ", cached in "
+					<< texture->decodeTime << " ms, starting from level " << texture->getBaseLevel() << endl;
+			}
+			else
+			{
+				cout << "Texture " << texture->getFilename() << ": " << texture->getWidth() << "x" << texture->getHeight() << ", decoded in "
+					<< texture->decodeTime << " ms, mips built in " << texture->mipTime << " ms, compressed in " << texture->encodeTime
+					<< " ms, starting from level " << texture->getBaseLevel() << endl;
+			}
+		}
+		cout << "Textures ready to draw after " << textureTime << " ms" << endl;
+	}
+
+	// one finer level of each texture per frame until they are all in
+	void streamTextures()
+	{
+		if (textureLoader != nullptr && textureLoader->stream() == 0)
+		{
+			textureLoader = nullptr;
+			cout << "Textures fully uploaded after " << chrono::duration<double, milli>(chrono::steady_clock::now() - textureStart).count() << " ms, "
+				<< (t_skybox->getBytes() + t_rock->getBytes()) / 1024 << " KB on the GPU" << endl;
+		}
+	}
+
 	void initBlackHole(const std::string& resourceDirectory)
 	{
 		blackHole = make_shared<BlackHoleMap>();
 		blackHole->size = 0.4f;
 		blackHole->position = vec3(0, 2.5, 0);
-		blackHole->loadFromFile(resourceDirectory + "/blackhole/blackhole_128_32_32_64_32.txt");
-		cout << "Black hole resolution: " << blackHole->vrResolution << ", " << blackHole->vPhiResolution << ", " << blackHole->orResolution << endl;
+
+		// binary tables are mapped straight into the texture upload, text ones have to be parsed.
+		// a pack (BlackHoleLUTTool pack) starts on its coarsest level and upgrades after the first frame
+		std::string tableDirectory = resourceDirectory + "/blackhole/";
+		std::vector<std::string> tables = {
+			"blackhole_levels.bhlut",
+			"blackhole_128_32_32_64_32.bhlut",
+			"blackhole_128_32_32_64_32.txt",
+			"blackhole_32_32_32_32_32.txt"
+		};
+		auto loadStart = chrono::steady_clock::now();
+		for (auto& table : tables)
+		{
+			if (blackHole->loadFromFile(tableDirectory + table))
+			{
+				cout << "Black hole table: " << table << endl;
+				break;
+			}
+		}
 		blackHole->sendToGPU();
+		auto loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+		cout << "Black hole resolution: " << blackHole->vrResolution << ", " << blackHole->vPhiResolution << ", " << blackHole->orResolution << endl;
+		cout << "Black hole table loaded and uploaded in " << loadTime << " ms" << endl;
+	}
+
+	// picks the finest table level worth having for what the scene draws, once the scene exists
+	void chooseBlackHoleLevel()
+	{
+		BlackHoleBudget budget;
+		budget.textureBytes = 64 << 20;
+		glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &budget.maxTextureSize);
+		for (auto& mesh : scene->meshes)
+		{
+			// drawn once for the primary and once for the secondary image
+			budget.verticesPerFrame += 2 * mesh->model->getVertexCount();
+		}
+
+		blackHole->targetLevel = blackHole->selectLevel(budget);
+		if (blackHole->targetLevel > blackHole->getLevel())
+		{
+			const BlackHoleLUTHeader& target = blackHole->getLevelHeader(blackHole->targetLevel);
+			cout << "Black hole table will upgrade to level " << blackHole->targetLevel << " (" << target.vrResolution << ", "
+				<< target.vPhiResolution << ", " << target.orResolution << ") for " << budget.verticesPerFrame << " vertices per frame" << endl;
+		}
+	}
+
+	// one level per frame so the first frames show up without waiting on the big upload
+	void upgradeBlackHole()
+	{
+		auto upgradeStart = chrono::steady_clock::now();
+		if (blackHole->upgrade())
+		{
+			auto upgradeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - upgradeStart).count();
+			cout << "Black hole table upgraded to level " << blackHole->getLevel() << " (" << blackHole->vrResolution << ", "
+				<< blackHole->vPhiResolution << ", " << blackHole->orResolution << ") in " << upgradeTime << " ms" << endl;
+		}
 	}
 
 	void initScene()
@@ -418,7 +575,6 @@ public:
 		scene->addShaderProgram(texBlinnPhongProg);
 
 		scene->blackHole = blackHole;
-		blackHole->sendToGPU();
 		blackHole->textureUnit = 1;
 
 		// planets
@@ -694,11 +850,79 @@ public:
 		}
 	}
 
+	// a cloud of small spheres spiralling around the black hole, for measuring draw submission
+	void addDrawBenchObjects(int count)
+	{
+		shared_ptr<Material> materials[] = { s_metal, s_marble, s_blueWater, s_rock };
+		for (int i = 0; i < count; i++)
+		{
+			// golden angle, spreads them out evenly
+			float angle = i * 2.39996f;
+			float radius = 4.0f + 5.0f * (i + 0.5f) / count;
+			auto sphere = make_shared<MeshObject>(scene, m_icosphere, materials[i % 4]);
+			sphere->translation = vec3(cos(angle) * radius, 0.5f + fmod(i * 0.618f, 1.0f) * 3.0f, sin(angle) * radius);
+			sphere->scale = vec3(0.05);
+			scene->addObject(sphere);
+		}
+	}
+
+	void enableProfiler()
+	{
+		profiler = make_shared<Profiler>();
+		scene->setProfiler(profiler);
+		updateSection = profiler->getSection("update");
+		renderSection = profiler->getSection("render", true);
+	}
+
+	// prefix.csv and prefix.json, plus a table on stdout
+	void writeProfile(const std::string& prefix)
+	{
+		profiler->finish();
+		profiler->printStats();
+		GLSL::printCallCounts(profiler->getFrameCount());
+		scene->renderQueue.printStats();
+		profiler->writeCSV(prefix + ".csv");
+		profiler->writeJSON(prefix + ".json");
+	}
+
+	// update and render, timed when profiling
+	void step()
+	{
+		{
+			ProfileScope scope(profiler.get(), updateSection);
+			update();
+		}
+		{
+			ProfileScope scope(profiler.get(), renderSection);
+			render();
+		}
+	}
+
+	// puts the camera where the path says it is at timeSinceStart
+	void followCameraPath()
+	{
+		vec3 eye, target;
+		cameraPath.evaluate(timeSinceStart, eye, target);
+		player->translation = eye - fpsCamera->translation;
+		// inverse of CameraObject::getFacing
+		vec3 facing = normalize(target - eye);
+		fpsCamera->rotation = vec3(asin(facing.y), atan2(-facing.x, -facing.z), 0);
+	}
+
 	void render() {
 		// Get current frame buffer size.
 		int width, height;
-		glfwGetFramebufferSize(windowManager->getHandle(), &width, &height);
-		glViewport(0, 0, width, height);
+		if (offscreen != nullptr)
+		{
+			offscreen->bind();
+			width = offscreen->getWidth();
+			height = offscreen->getHeight();
+		}
+		else
+		{
+			glfwGetFramebufferSize(windowManager->getHandle(), &width, &height);
+			glViewport(0, 0, width, height);
+		}
 
 		// Clear framebuffer.
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -710,108 +934,314 @@ public:
 	}
 };
 
-mat4 rotationMatrix(vec3 axis, float angle)
+void testBlackHole(shared_ptr<BlackHoleMap> blackHole, double time)
 {
-	axis = normalize(axis);
-	float s = sin(angle);
-	float c = cos(angle);
-	float oc = 1.0 - c;
-
-	return mat4(oc * axis.x * axis.x + c, oc * axis.x * axis.y - axis.z * s, oc * axis.z * axis.x + axis.y * s, 0.0,
-		oc * axis.x * axis.y + axis.z * s, oc * axis.y * axis.y + c, oc * axis.y * axis.z - axis.x * s, 0.0,
-		oc * axis.z * axis.x - axis.y * s, oc * axis.y * axis.z + axis.x * s, oc * axis.z * axis.z + c, 0.0,
-		0.0, 0.0, 0.0, 1.0);
-}
+	// one vertex circling a hole 5 units in front of the camera, warped on the CPU
+	float position[3] = { (float)(3 * cos(time * 0.2)), 0.0f, (float)(-5 - 3 * sin(time * 0.2)) };
+	float normal[3] = { 0.0f, 0.0f, 1.0f };
+	float warpedPosition[3];
+	float warpedNormal[3];
+
+	BlackHoleWarpFrame frame;
+	frame.hole[2] = -5.0f;
+	frame.size = blackHole->size;
+	BlackHoleWarpBatch batch;
+	batch.count = 1;
+	for (int i = 0; i < 3; i++)
+	{
+		batch.position[i] = &position[i];
+		batch.normal[i] = &normal[i];
+		batch.warpedPosition[i] = &warpedPosition[i];
+		batch.warpedNormal[i] = &warpedNormal[i];
+	}
+	blackHole->warp(frame, batch);
 
-float valueMap(float value, float min1, float max1, float min2, float max2)
-{
-	return min2 + (value - min1) * (max2 - min2) / (max1 - min1);
+	cout << "Vertex: " << position[0] << ", " << position[1] << ", " << position[2]
+		<< " -> " << warpedPosition[0] << ", " << warpedPosition[1] << ", " << warpedPosition[2] << endl;
+	cout << "Normal: " << normal[0] << ", " << normal[1] << ", " << normal[2]
+		<< " -> " << warpedNormal[0] << ", " << warpedNormal[1] << ", " << warpedNormal[2] << endl;
 }
 
-void testBlackHole(shared_ptr<BlackHoleMap> blackHole, double time)
+struct RunOptions
 {
-	vec4 viewPositionV4 = vec4(3, 0, -5, 1);
-	vec4 viewNormalV4 = vec4(0, 0, 1, 0);
-
-	vec3 bhHole = vec3(0, 0, -5);
-	vec3 bhVertex = vec3(3 * cos(time * 0.2), 0, -5 - 3 * sin(time * 0.2));
-	vec3 bhObserver = vec3(0);
-
-	vec3 bhXAxis = normalize(bhObserver - bhHole);
-	vec3 bhNormal = normalize(cross(bhXAxis, bhVertex - bhHole));
-	vec3 bhYAxis = cross(bhNormal, bhXAxis);
-
-	cout << "X Axis: " << bhXAxis.x << ", " << bhXAxis.y << ", " << bhXAxis.z << endl;
-	cout << "Y Axis: " << bhYAxis.x << ", " << bhYAxis.y << ", " << bhYAxis.z << endl;
-
-	vec3 bhVertexRelative = bhVertex - bhHole;
-	float bhVertex2dX = dot(bhVertexRelative, bhXAxis);
-	float bhVertex2dY = dot(bhVertexRelative, bhYAxis);
-	vec2 bhVertex2dCart = vec2(bhVertex2dX, bhVertex2dY);
+	std::string resourceDir = "../resources";
+	bool headless = false;
+	bool osmesa = false;
+	bool blackHole = false;
+	int frames = 300;
+	int width = 1280;
+	int height = 720;
+	double fps = 30.0;
+	// frame dump pattern, see FrameDumper, nothing is saved when empty
+	std::string output;
+	// orbits the black hole when empty
+	std::string cameraPath;
+	// writes prefix.csv and prefix.json at exit when set
+	std::string profile;
+	// extra objects for measuring draws per second
+	int benchObjects = 0;
+	// draw in scene order instead of sorting by state
+	bool unsorted = false;
+	// one draw per object instead of one per model and material
+	bool uninstanced = false;
+	// both black hole images in one draw instead of two
+	bool singlePass = false;
+	// 32 bit float normals and texcoords instead of packed ones
+	bool floatVertices = false;
+	// one draw per batch and shape even where multi-draw indirect works
+	bool noMultiDraw = false;
+	// always parse the .obj files
+	bool noMeshCache = false;
+	// how faces are weighted in the normals of meshes that come without them
+	NormalWeighting normalWeighting = NORMAL_WEIGHT_UNIFORM;
+	// RGB8 textures instead of BC1
+	bool uncompressedTextures = false;
+	// always decode (and compress) the textures
+	bool noTextureCache = false;
+};
 
-	cout << "Vertex2D: " << bhVertex2dX << ", " << bhVertex2dY << endl;
+static const chrono::steady_clock::time_point launchTime = chrono::steady_clock::now();
 
-	vec3 bhObserverRelative = bhObserver - bhHole;
-	float bhObserver2dX = dot(bhObserverRelative, bhXAxis);
-	float bhObserver2dY = dot(bhObserverRelative, bhYAxis);
-	vec2 bhObserver2dCart = vec2(bhObserver2dX, bhObserver2dY);
+// time to first frame, counting from launch; only the first call prints
+static void reportFirstFrame()
+{
+	static bool reported = false;
+	if (!reported)
+	{
+		reported = true;
+		cout << "First frame after " << chrono::duration<double, milli>(chrono::steady_clock::now() - launchTime).count() << " ms" << endl;
+	}
+}
 
-	cout << "Observer2D: " << bhObserver2dX << ", " << bhObserver2dY << endl;
+void printUsage()
+{
+	cerr << "usage: BlackHoleRasterizer [resourceDir] [--black-hole] [--profile prefix] [--unsorted] [--uninstanced] [--single-pass] [--float-vertices] [--no-multi-draw] [--no-mesh-cache]" << endl;
+	cerr << "           [--uncompressed-textures] [--no-texture-cache] [--normal-weighting uniform|area|angle]" << endl;
+	cerr << "       BlackHoleRasterizer [resourceDir] --headless [--frames N] [--size WxH] [--fps F]" << endl;
+	cerr << "           [--camera-path path.txt] [--output frames/frame_%04d.png|.hdr|.raw|-] [--osmesa] [--black-hole] [--profile prefix]" << endl;
+	cerr << "       BlackHoleRasterizer [resourceDir] --bench-draws objects [headless options]" << endl;
+}
 
-	float vertexR = length(bhVertex2dCart);
-	float vertexPhi = atan(bhVertex2dY, bhVertex2dX);
-	if (vertexPhi < 0.0f)
+bool parseArguments(int argc, char *argv[], RunOptions& options)
+{
+	for (int i = 1; i < argc; i++)
 	{
-		vertexPhi += 2 * PI;
+		string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (argument == "--headless")
+		{
+			options.headless = true;
+		}
+		else if (argument == "--osmesa")
+		{
+			options.osmesa = true;
+		}
+		else if (argument == "--black-hole")
+		{
+			options.blackHole = true;
+		}
+		else if (argument == "--unsorted")
+		{
+			options.unsorted = true;
+		}
+		else if (argument == "--uninstanced")
+		{
+			options.uninstanced = true;
+		}
+		else if (argument == "--single-pass")
+		{
+			options.singlePass = true;
+		}
+		else if (argument == "--float-vertices")
+		{
+			options.floatVertices = true;
+		}
+		else if (argument == "--no-multi-draw")
+		{
+			options.noMultiDraw = true;
+		}
+		else if (argument == "--no-mesh-cache")
+		{
+			options.noMeshCache = true;
+		}
+		else if (argument == "--normal-weighting" && hasValue)
+		{
+			if (!Normals::parseWeighting(argv[++i], options.normalWeighting))
+			{
+				return false;
+			}
+		}
+		else if (argument == "--uncompressed-textures")
+		{
+			options.uncompressedTextures = true;
+		}
+		else if (argument == "--no-texture-cache")
+		{
+			options.noTextureCache = true;
+		}
+		else if (argument == "--frames" && hasValue)
+		{
+			options.frames = atoi(argv[++i]);
+		}
+		else if (argument == "--size" && hasValue)
+		{
+			if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+			{
+				return false;
+			}
+		}
+		else if (argument == "--fps" && hasValue)
+		{
+			options.fps = atof(argv[++i]);
+		}
+		else if (argument == "--output" && hasValue)
+		{
+			options.output = argv[++i];
+		}
+		else if (argument == "--camera-path" && hasValue)
+		{
+			options.cameraPath = argv[++i];
+		}
+		else if (argument == "--profile" && hasValue)
+		{
+			options.profile = argv[++i];
+		}
+		else if (argument == "--bench-draws" && hasValue)
+		{
+			options.benchObjects = atoi(argv[++i]);
+			options.headless = true;
+		}
+		else if (argument.size() > 1 && argument[0] == '-')
+		{
+			return false;
+		}
+		else
+		{
+			options.resourceDir = argument;
+		}
 	}
-	float observerR = length(bhObserver2dCart);
+	return options.frames > 0 && options.width > 0 && options.height > 0 && options.fps > 0.0;
+}
 
-	cout << "VertexR: " << vertexR << ", VertexPhi: " << vertexPhi << ", ObserverR: " << observerR << endl;
+// Renders a fixed number of frames offscreen on a fixed time step, so the same
+// arguments always give the same frames, and reports how long each one took.
+int runHeadless(Application *application, const RunOptions& options)
+{
+	FrameDumper dumper;
+	if (!options.output.empty() && !dumper.open(options.output, options.width, options.height))
+	{
+		return 1;
+	}
+	application->offscreen = make_shared<Framebuffer>();
+	if (!application->offscreen->init(options.width, options.height, dumper.wantsFloat() ? GL_RGBA16F : GL_RGBA8))
+	{
+		return 1;
+	}
 
-	float vertexRMapped = valueMap(vertexR, blackHole->vrMin, blackHole->vrMax, 0.0, 1.0);
-	float vertexPhiMapped = valueMap(vertexPhi, 0, 2 * PI, 0.0, 1.0);
-	float observerRMapped = valueMap(observerR, blackHole->orMin, blackHole->orMax, 0.0, 1.0);
+	double duration = options.frames / options.fps;
+	if (options.cameraPath.empty())
+	{
+		application->cameraPath.makeOrbit(application->blackHole->position, 7.0f, 0.5f, duration);
+	}
+	else if (!application->cameraPath.loadFromFile(options.cameraPath))
+	{
+		return 1;
+	}
+	application->playerCollisions = false;
 
-	vec3 coord = vec3(vertexRMapped, vertexPhiMapped, observerRMapped);
-	cout << "Coord: " << vertexRMapped << ", " << vertexPhiMapped << ", " << observerRMapped << endl;
-	vec3 bh = blackHole->getValue(coord.x, coord.y, coord.z);
-	float va = bh.x;
-	float oa = bh.y;
-	float d = bh.z;
+	// straight to the finest table level and full size textures, no point easing in when nobody is watching
+	while (application->blackHole->upgrade())
+	{
+	}
+	while (application->textureLoader != nullptr)
+	{
+		application->streamTextures();
+	}
 
-	cout << "VA: " << va << ", OA: " << oa << ", D: " << d << endl;
+	vector<double> frameTimes;
+	double submitTime = 0.0;
+	long firstDrawCalls = application->scene->drawCalls;
+	GLSL::resetCallCounts();
+	for (int frame = 0; frame < options.frames; frame++)
+	{
+		application->deltaTime = 1.0 / options.fps;
+		application->timeSinceStart = frame / options.fps;
+		application->followCameraPath();
 
-	vec3 directionFromObserver = cos(oa) * bhXAxis + sin(oa) * bhYAxis;
-	vec3 displacementFromObserver = directionFromObserver * d;
-	vec3 normalRotationAxis = cross(bhXAxis, bhYAxis);
-	float normalRotationAmount = (oa + PI) - va; // probably right?
-	mat4 normalRotationMatrix = rotationMatrix(normalRotationAxis, normalRotationAmount);
+		auto frameStart = chrono::steady_clock::now();
+		if (application->profiler != nullptr)
+		{
+			application->profiler->beginFrame();
+		}
+		application->step();
+		submitTime += chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+		glFinish();
+		reportFirstFrame();
+		if (application->profiler != nullptr)
+		{
+			application->profiler->endFrame();
+		}
+		frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count());
 
-	cout << "displacmentFromObserver: " << displacementFromObserver.x << ", " << displacementFromObserver.y << ", " << displacementFromObserver.z << endl;
-	cout << "normalRotationAxis: " << normalRotationAxis.x << ", " << normalRotationAxis.y << ", " << normalRotationAxis.z << endl;
-	cout << "normalRotationAmount: " << normalRotationAmount << endl;
+		if (!options.output.empty() && !dumper.write(frame))
+		{
+			return 1;
+		}
+	}
+	dumper.close();
 
-	viewPositionV4 = vec4(displacementFromObserver, 1.0);
-	viewNormalV4 = normalRotationMatrix * viewNormalV4;
+	double total = 0.0;
+	for (double time : frameTimes)
+	{
+		total += time;
+	}
+	// stdout may be carrying raw frames
+	cerr << options.frames << " frames at " << options.width << "x" << options.height << ", "
+		<< total / frameTimes.size() << " ms average, " << *min_element(frameTimes.begin(), frameTimes.end()) << " ms min, "
+		<< *max_element(frameTimes.begin(), frameTimes.end()) << " ms max" << endl;
+	long drawCalls = application->scene->drawCalls - firstDrawCalls;
+	cerr << drawCalls / options.frames << " draws per frame, " << drawCalls / (submitTime / 1000.0) << " draws/s submitted (update + render on the CPU), "
+		<< drawCalls / (total / 1000.0) << " draws/s with the GPU finished" << endl;
+	if (GLSL::getCallCount() > 0)
+	{
+		cerr << GLSL::getCallCount() / options.frames << " GL calls per frame" << endl;
+	}
+	const RenderQueue::Stats& queue = application->scene->renderQueue.getFrameStats();
+	cerr << "state changes in the last frame: " << queue.programChanges << " programs, " << queue.materialChanges << " materials, "
+		<< queue.modelChanges << " models (" << queue.unsortedProgramChanges << ", " << queue.unsortedMaterialChanges << " and "
+		<< queue.unsortedModelChanges << " in scene order), " << queue.draws << " objects in " << queue.batches << " instanced batches, " << queue.submits << " GL draw calls" << endl;
+	cerr << "vertex fetch in the last frame: " << queue.fetchBytes / 1024 << " KB (" << queue.floatFetchBytes / 1024 << " KB with float vertices)" << endl;
+	return 0;
 }
 
 int main(int argc, char *argv[])
 {
-	// Where the resources are loaded from
-	std::string resourceDir = "../resources";
-
-	if (argc >= 2)
+	RunOptions options;
+	if (!parseArguments(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+	std::string resourceDir = options.resourceDir;
+	if (options.output == "-")
 	{
-		resourceDir = argv[1];
+		// stdout carries the frames, keep the chatter out of them
+		cout.rdbuf(cerr.rdbuf());
 	}
 
 	Application *application = new Application();
+	application->headless = options.headless;
+	application->blackHoleActive = options.blackHole;
 
 	// Your main will always include a similar set up to establish your window
 	// and GL context, etc.
 
 	WindowManager *windowManager = new WindowManager();
-	windowManager->init(640, 480);
+	if (!windowManager->init(options.headless ? options.width : 640, options.headless ? options.height : 480, !options.headless, options.osmesa))
+	{
+		cerr << "Failed to create an OpenGL context" << endl;
+		return 1;
+	}
 	windowManager->setEventCallbacks(application);
 	application->windowManager = windowManager;
 
@@ -819,31 +1249,90 @@ int main(int argc, char *argv[])
 	// may need to initialize or set up different data and state
 
 	application->init();
+	Texture::compress = !options.uncompressedTextures && GLSL::hasExtension("GL_EXT_texture_compression_s3tc");
+	TextureCache::directory = options.noTextureCache ? "" : resourceDir + "/cache/textures";
+	cout << "Texture compression: " << (Texture::compress ? "BC1" : "off") << endl;
 	application->initShaders(resourceDir);
+	Shape::compactVertices = !options.floatVertices;
+	Shape::normalWeighting = options.normalWeighting;
+	MeshCache::directory = options.noMeshCache ? "" : resourceDir + "/cache/meshes";
+	// the meshes load on worker threads while the black hole table loads here
 	application->initGeom(resourceDir);
 	application->initBlackHole(resourceDir);
+	application->finishGeom();
+	application->finishTextures();
 	application->initScene();
+	application->addDrawBenchObjects(options.benchObjects);
+	application->scene->renderQueue.sorted = !options.unsorted;
+	application->scene->renderQueue.instanced = !options.uninstanced;
+	application->scene->renderQueue.singlePass = options.singlePass;
+	application->scene->renderQueue.multiDraw = !options.noMultiDraw;
+	cout << "Multi-draw indirect: " << (application->scene->renderQueue.usesMultiDraw() ? "on" : (GLSL::multiDrawElementsIndirect != nullptr ? "off" : "unsupported")) << endl;
+	application->chooseBlackHoleLevel();
+	if (!options.profile.empty() || options.benchObjects > 0)
+	{
+		GLSL::countCalls();
+	}
+	if (!options.profile.empty())
+	{
+		application->enableProfiler();
+	}
+
+	if (options.headless)
+	{
+		int result = runHeadless(application, options);
+		if (application->profiler != nullptr)
+		{
+			application->writeProfile(options.profile);
+		}
+		application->offscreen = nullptr;
+		windowManager->shutdown();
+		return result;
+	}
 
+	double titleTime = 0.0;
+	GLSL::resetCallCounts();
 	// Loop until the user closes the window.
 	while (! glfwWindowShouldClose(windowManager->getHandle()))
 	{
+		if (application->profiler != nullptr)
+		{
+			application->profiler->beginFrame();
+		}
 		auto newTime = glfwGetTime();
 		application->deltaTime = newTime - application->timeSinceStart;
 		application->timeSinceStart = newTime;
 
 		// testBlackHole(application->blackHole, application->timeSinceStart);
 
-		// Update state.
-		application->update();
-		// Render scene.
-		application->render();
+		// Update state and render scene.
+		application->step();
 
 		// Swap front and back buffers.
 		glfwSwapBuffers(windowManager->getHandle());
+		reportFirstFrame();
+		application->upgradeBlackHole();
+		application->streamTextures();
 		// Poll for and process events.
 		glfwPollEvents();
+
+		if (application->profiler != nullptr)
+		{
+			application->profiler->endFrame();
+			// poor man's overlay
+			if (newTime - titleTime > 1.0)
+			{
+				titleTime = newTime;
+				string title = "Final Project - Jacob Kelleran | " + application->profiler->getSummary();
+				glfwSetWindowTitle(windowManager->getHandle(), title.c_str());
+			}
+		}
 	}
 
+	if (application->profiler != nullptr)
+	{
+		application->writeProfile(options.profile);
+	}
 	// Quit program.
 	windowManager->shutdown();
 	return 0;
@@ -0,0 +1,659 @@
+/*
+ * Native replacement for resources/blackhole/black_hole_grid_calculator.py.
+ *
+ * Solves the vertex -> observer null geodesic for every (vr, vPhi, or) cell of
+ * the table on a thread pool and writes a .bhlut that BlackHoleMap can load.
+ * The arguments mirror plot_multiple():
+ *
+ *   BlackHoleGridCalculator <vPhiRes> <vrRes> <vrMax> <orRes> <orMax>
+ *       [-o output.bhlut] [--threads N] [--vr-min X] [--or-min X]
+ *       [--method family|shoot] [--tolerance X]
+ *       [--vr-warp W] [--phi-warp W] [--or-warp W] [--evaluate N]
+ *
+ * Warps are "linear", "log[:offset]" or "sinh[:strength]" (see BlackHoleLUT.h).
+ * log on the radii and sinh on phi spend the texels near the photon sphere and
+ * around the vPhi = pi seam. --evaluate solves N random points directly and
+ * reports how far the baked table is off when sampled like the shader does.
+ *
+ * Everything is in units of the Schwarzschild radius, so one table serves
+ * every BlackHoleMap::size. By default each observer radius traces a single
+ * family of rays and bins their crossings into the whole (vr, vPhi) slice;
+ * "shoot" solves every cell on its own and is kept as a reference.
+ *
+ *   BlackHoleGridCalculator --check <table> [--threads N]
+ *
+ * traces light from every cell's vertex along the table's vertex angle and
+ * reports how far from the observer it crosses the observer's axis, which
+ * tells a right table from a wrong one without trusting either solver. -o
+ * with a .txt name writes the text format instead, for linear axes only.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <cstring>
+
+#include "BlackHoleLUT.h"
+#include "ThreadPool.h"
+#include "Geodesic.h"
+
+using namespace std;
+
+constexpr double PI = 3.14159265358979323846;
+
+struct GridSettings
+{
+	int vPhiResolution = 0;
+	int vrResolution = 0;
+	int orResolution = 0;
+	double vrMin = 1.2;
+	double vrMax = 0.0;
+	double orMin = 1.2;
+	double orMax = 0.0;
+	unsigned threads = 0;
+	bool shootEveryCell = false;
+	double tolerance = 1e-4;
+	uint32_t vrWarp = BLACK_HOLE_LUT_WARP_LINEAR;
+	uint32_t vPhiWarp = BLACK_HOLE_LUT_WARP_LINEAR;
+	uint32_t orWarp = BLACK_HOLE_LUT_WARP_LINEAR;
+	double vrWarpParameter = 0.0;
+	double vPhiWarpParameter = 0.0;
+	double orWarpParameter = 0.0;
+	int evaluationPoints = 0;
+	string outputPath;
+};
+
+static void printUsage()
+{
+	cerr << "usage: BlackHoleGridCalculator <vPhiRes> <vrRes> <vrMax> <orRes> <orMax>" << endl;
+	cerr << "           [-o output.bhlut] [--threads N] [--vr-min X] [--or-min X]" << endl;
+	cerr << "           [--method family|shoot] [--tolerance X]" << endl;
+	cerr << "           [--vr-warp W] [--phi-warp W] [--or-warp W] [--evaluate N]" << endl;
+	cerr << "       BlackHoleGridCalculator --check <table> [--threads N]" << endl;
+	cerr << "warps: linear, log[:offset] (default offset 0), sinh[:strength] (default 3)" << endl;
+}
+
+static double gridValue(uint32_t warp, double parameter, double min, double max, int index, int resolution)
+{
+	if (resolution <= 1)
+	{
+		return min;
+	}
+	return BlackHoleLUT::unwarpAxis(warp, parameter, (double)index / (resolution - 1), min, max);
+}
+
+static double vertexRValue(const GridSettings& grid, int index)
+{
+	return gridValue(grid.vrWarp, grid.vrWarpParameter, grid.vrMin, grid.vrMax, index, grid.vrResolution);
+}
+
+static double vertexPhiValue(const GridSettings& grid, int index)
+{
+	return gridValue(grid.vPhiWarp, grid.vPhiWarpParameter, 0.0, 2 * PI, index, grid.vPhiResolution);
+}
+
+static double observerRValue(const GridSettings& grid, int index)
+{
+	return gridValue(grid.orWarp, grid.orWarpParameter, grid.orMin, grid.orMax, index, grid.orResolution);
+}
+
+// "log", "log:1.1", "sinh:4" and so on
+static bool parseWarp(const string& text, uint32_t& warp, double& parameter)
+{
+	string name = text.substr(0, text.find(':'));
+	bool hasParameter = name.size() < text.size();
+	if (name == "linear" && !hasParameter)
+	{
+		warp = BLACK_HOLE_LUT_WARP_LINEAR;
+		parameter = 0.0;
+	}
+	else if (name == "log")
+	{
+		warp = BLACK_HOLE_LUT_WARP_LOG;
+		parameter = hasParameter ? atof(text.c_str() + name.size() + 1) : 0.0;
+	}
+	else if (name == "sinh")
+	{
+		warp = BLACK_HOLE_LUT_WARP_SINH;
+		parameter = hasParameter ? atof(text.c_str() + name.size() + 1) : 3.0;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// same neighbour averaging as interpolate_holes_in_array() in the python script
+static void interpolateHoles(vector<float>& values, const GridSettings& grid, int channel)
+{
+	int strides[3] = { grid.vPhiResolution * grid.orResolution, grid.orResolution, 1 };
+	int extents[3] = { grid.vrResolution, grid.vPhiResolution, grid.orResolution };
+
+	while (true)
+	{
+		vector<size_t> holes;
+		size_t cellCount = values.size() / BLACK_HOLE_LUT_CHANNELS;
+		for (size_t cell = 0; cell < cellCount; cell++)
+		{
+			if (std::isnan(values[cell * BLACK_HOLE_LUT_CHANNELS + channel]))
+			{
+				holes.push_back(cell);
+			}
+		}
+		if (holes.empty())
+		{
+			return;
+		}
+		cout << "Found " << holes.size() << " holes to interpolate." << endl;
+
+		size_t filled = 0;
+		for (size_t cell : holes)
+		{
+			int coords[3] = { (int)(cell / strides[0]), (int)(cell / strides[1] % extents[1]), (int)(cell % extents[2]) };
+			float sum = 0.0f;
+			int count = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int direction = -1; direction <= 1; direction += 2)
+				{
+					int neighbour = coords[axis] + direction;
+					if (neighbour < 0 || neighbour >= extents[axis])
+					{
+						continue;
+					}
+					float value = values[(cell + direction * strides[axis]) * BLACK_HOLE_LUT_CHANNELS + channel];
+					if (!std::isnan(value))
+					{
+						sum += value;
+						count++;
+					}
+				}
+			}
+			if (count > 0)
+			{
+				values[cell * BLACK_HOLE_LUT_CHANNELS + channel] = sum / count;
+				filled++;
+			}
+		}
+		if (filled == 0)
+		{
+			cerr << "No cells could be solved, leaving holes in the table" << endl;
+			return;
+		}
+	}
+}
+
+static bool validWarp(uint32_t warp, double parameter, double min)
+{
+	return warp != BLACK_HOLE_LUT_WARP_LOG ? warp != BLACK_HOLE_LUT_WARP_SINH || parameter > 0.0 : parameter < min;
+}
+
+static bool parseArguments(int argc, char *argv[], GridSettings& grid)
+{
+	if (argc < 6)
+	{
+		return false;
+	}
+	grid.vPhiResolution = atoi(argv[1]);
+	grid.vrResolution = atoi(argv[2]);
+	grid.vrMax = atof(argv[3]);
+	grid.orResolution = atoi(argv[4]);
+	grid.orMax = atof(argv[5]);
+	grid.outputPath = string("blackhole_") + argv[1] + "_" + argv[2] + "_" + argv[3] + "_" + argv[4] + "_" + argv[5] + ".bhlut";
+
+	for (int i = 6; i < argc; i++)
+	{
+		string option = argv[i];
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+		if (option == "-o")
+		{
+			grid.outputPath = argv[++i];
+		}
+		else if (option == "--threads")
+		{
+			grid.threads = (unsigned)atoi(argv[++i]);
+		}
+		else if (option == "--vr-min")
+		{
+			grid.vrMin = atof(argv[++i]);
+		}
+		else if (option == "--or-min")
+		{
+			grid.orMin = atof(argv[++i]);
+		}
+		else if (option == "--method")
+		{
+			string method = argv[++i];
+			if (method != "family" && method != "shoot")
+			{
+				return false;
+			}
+			grid.shootEveryCell = method == "shoot";
+		}
+		else if (option == "--tolerance")
+		{
+			grid.tolerance = atof(argv[++i]);
+		}
+		else if (option == "--vr-warp")
+		{
+			if (!parseWarp(argv[++i], grid.vrWarp, grid.vrWarpParameter))
+			{
+				return false;
+			}
+		}
+		else if (option == "--phi-warp")
+		{
+			if (!parseWarp(argv[++i], grid.vPhiWarp, grid.vPhiWarpParameter))
+			{
+				return false;
+			}
+		}
+		else if (option == "--or-warp")
+		{
+			if (!parseWarp(argv[++i], grid.orWarp, grid.orWarpParameter))
+			{
+				return false;
+			}
+		}
+		else if (option == "--evaluate")
+		{
+			grid.evaluationPoints = atoi(argv[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return grid.vPhiResolution > 0 && grid.vrResolution > 0 && grid.orResolution > 0
+		&& grid.vrMax > grid.vrMin && grid.orMax > grid.orMin && grid.vrMin > 1.0 && grid.orMin > 1.0
+		&& grid.tolerance > 0.0
+		&& validWarp(grid.vrWarp, grid.vrWarpParameter, grid.vrMin)
+		&& validWarp(grid.vPhiWarp, grid.vPhiWarpParameter, 0.0)
+		&& validWarp(grid.orWarp, grid.orWarpParameter, grid.orMin);
+}
+
+static void setCell(vector<float>& values, size_t cell, const GeodesicSample& sample)
+{
+	values[cell * BLACK_HOLE_LUT_CHANNELS] = (float)sample.vertexAngle;
+	values[cell * BLACK_HOLE_LUT_CHANNELS + 1] = (float)sample.observerAngle;
+	values[cell * BLACK_HOLE_LUT_CHANNELS + 2] = (float)sample.distance;
+}
+
+static void printProgress(size_t finished, size_t total, size_t cellsDone, chrono::steady_clock::time_point start)
+{
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "\r" << finished * 100 / total << "% (" << (size_t)(cellsDone / elapsed) << " cells/s)" << flush;
+}
+
+// one shooting problem per cell
+static void solveCells(const GridSettings& grid, ThreadPool& pool, vector<float>& values, atomic<size_t>& failures,
+	chrono::steady_clock::time_point start)
+{
+	size_t cellCount = values.size() / BLACK_HOLE_LUT_CHANNELS;
+	atomic<size_t> done(0);
+	mutex printMutex;
+
+	pool.parallelFor(cellCount, [&](size_t cell)
+	{
+		int vrIndex = (int)(cell / ((size_t)grid.vPhiResolution * grid.orResolution));
+		int vPhiIndex = (int)(cell / grid.orResolution % grid.vPhiResolution);
+		int orIndex = (int)(cell % grid.orResolution);
+
+		double vertexR = vertexRValue(grid, vrIndex);
+		double vertexPhi = vertexPhiValue(grid, vPhiIndex);
+		double observerR = observerRValue(grid, orIndex);
+
+		GeodesicSample sample;
+		if (solveGeodesic(vertexR, vertexPhi, observerR, sample))
+		{
+			setCell(values, cell, sample);
+		}
+		else
+		{
+			failures++;
+		}
+
+		size_t finished = ++done;
+		if (finished % (cellCount / 100 + 1) == 0)
+		{
+			lock_guard<mutex> lock(printMutex);
+			printProgress(finished, cellCount, finished, start);
+		}
+	}, 16);
+}
+
+// one family of rays per observer radius, shared by every vertex cell in that slice
+static void solveSlices(const GridSettings& grid, ThreadPool& pool, vector<float>& values, atomic<size_t>& failures,
+	chrono::steady_clock::time_point start)
+{
+	vector<double> vertexRadii(grid.vrResolution);
+	for (int i = 0; i < grid.vrResolution; i++)
+	{
+		vertexRadii[i] = vertexRValue(grid, i);
+	}
+	vector<double> vertexPhis(grid.vPhiResolution);
+	for (int i = 0; i < grid.vPhiResolution; i++)
+	{
+		vertexPhis[i] = vertexPhiValue(grid, i);
+	}
+
+	size_t sliceCells = vertexRadii.size() * vertexPhis.size();
+	atomic<size_t> done(0);
+	atomic<size_t> rays(0);
+	mutex printMutex;
+
+	pool.parallelFor(grid.orResolution, [&](size_t orIndex)
+	{
+		double observerR = observerRValue(grid, (int)orIndex);
+		vector<GeodesicSample> samples;
+		vector<char> solved;
+		rays += solveGeodesicSlice(observerR, vertexRadii, vertexPhis, grid.tolerance, samples, solved);
+
+		for (size_t sliceCell = 0; sliceCell < sliceCells; sliceCell++)
+		{
+			size_t cell = sliceCell * grid.orResolution + orIndex;
+			if (solved[sliceCell])
+			{
+				setCell(values, cell, samples[sliceCell]);
+			}
+			else
+			{
+				failures++;
+			}
+		}
+
+		size_t finished = ++done;
+		lock_guard<mutex> lock(printMutex);
+		printProgress(finished, grid.orResolution, finished * sliceCells, start);
+	});
+
+	cout << "\rTraced " << rays << " rays for " << grid.orResolution << " observer radii ("
+		<< (double)rays / grid.orResolution << " per slice)" << endl;
+}
+
+struct EvaluationPoint
+{
+	double vertexR;
+	double vertexPhi;
+	double observerR;
+	bool solved;
+	// how far the warped vertex lands from where it should, relative to its distance
+	double positionError;
+	// error in the angle the normals get rotated by
+	double angleError;
+};
+
+static void printErrors(const char* label, const vector<EvaluationPoint>& points, bool (*inRegion)(const EvaluationPoint&))
+{
+	vector<double> positions;
+	vector<double> angles;
+	for (const EvaluationPoint& point : points)
+	{
+		if (point.solved && inRegion(point))
+		{
+			positions.push_back(point.positionError);
+			angles.push_back(point.angleError);
+		}
+	}
+	if (angles.empty())
+	{
+		return;
+	}
+	sort(positions.begin(), positions.end());
+	sort(angles.begin(), angles.end());
+	size_t median = angles.size() / 2;
+	size_t p99 = angles.size() * 99 / 100;
+	cout << "  " << label << " (" << angles.size() << " points)" << endl;
+	cout << "    position:     median " << positions[median] << " p99 " << positions[p99] << " max " << positions.back() << " (relative)" << endl;
+	cout << "    vertex angle: median " << angles[median] << " p99 " << angles[p99] << " max " << angles.back() << " rad" << endl;
+}
+
+// compares shader style lookups of the table against solving random points directly
+static void evaluate(const GridSettings& grid, const BlackHoleLUTHeader& header, const vector<float>& values, ThreadPool& pool)
+{
+	mt19937 random(1);
+	uniform_real_distribution<double> unit(0.0, 1.0);
+	vector<EvaluationPoint> points(grid.evaluationPoints);
+	for (EvaluationPoint& point : points)
+	{
+		point.vertexR = grid.vrMin + (grid.vrMax - grid.vrMin) * unit(random);
+		point.vertexPhi = 2 * PI * unit(random);
+		point.observerR = grid.orMin + (grid.orMax - grid.orMin) * unit(random);
+	}
+
+	pool.parallelFor(points.size(), [&](size_t i)
+	{
+		EvaluationPoint& point = points[i];
+		GeodesicSample reference;
+		point.solved = solveGeodesic(point.vertexR, point.vertexPhi, point.observerR, reference);
+		if (!point.solved)
+		{
+			return;
+		}
+		float value[BLACK_HOLE_LUT_CHANNELS];
+		BlackHoleLUT::sample(header, values.data(), point.vertexR, point.vertexPhi, point.observerR, value);
+		double dx = value[2] * cos(value[1]) - reference.distance * cos(reference.observerAngle);
+		double dy = value[2] * sin(value[1]) - reference.distance * sin(reference.observerAngle);
+		point.positionError = sqrt(dx * dx + dy * dy) / max(reference.distance, 1e-6);
+		double angleError = fmod(fabs(value[0] - reference.vertexAngle), 2 * PI);
+		point.angleError = min(angleError, 2 * PI - angleError);
+	}, 16);
+
+	cout << "Error against " << points.size() << " direct solves:" << endl;
+	printErrors("everywhere", points, [](const EvaluationPoint&) { return true; });
+	printErrors("vertex inside r = 3", points, [](const EvaluationPoint& point) { return point.vertexR < 3.0; });
+	printErrors("within 0.5 rad of the vPhi = pi seam", points, [](const EvaluationPoint& point) { return fabs(point.vertexPhi - PI) < 0.5; });
+}
+
+struct CheckedCell
+{
+	size_t vr, vPhi, orIndex;
+	double vertexR, vertexPhi, observerR;
+	// where the ray crosses the observer's axis; NaN if it falls in or escapes
+	double crossingR;
+	double miss;
+};
+
+static bool loadTable(const string& path, BlackHoleLUTHeader& header, vector<unsigned char>& bytes, vector<float>& values, const void*& texels)
+{
+	if (!BlackHoleLUT::isBinaryFile(path))
+	{
+		if (!BlackHoleLUT::readText(path, header, values))
+		{
+			return false;
+		}
+		texels = values.data();
+		return true;
+	}
+	if (BlackHoleLUT::isPackFile(path))
+	{
+		cerr << path << ": packs aren't supported, check the levels they were made from" << endl;
+		return false;
+	}
+	ifstream file(path, ios::binary);
+	bytes.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	string error;
+	if (bytes.size() < sizeof(header))
+	{
+		cerr << path << ": file is truncated" << endl;
+		return false;
+	}
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (!BlackHoleLUT::validateHeader(header, bytes.size(), error))
+	{
+		cerr << path << ": " << error << endl;
+		return false;
+	}
+	texels = bytes.data() + header.dataOffset;
+	return true;
+}
+
+static double axisValue(uint32_t warp, float parameter, double min, double max, size_t index, uint32_t resolution)
+{
+	return resolution <= 1 ? min : BlackHoleLUT::unwarpAxis(warp, parameter, (double)index / (resolution - 1), min, max);
+}
+
+static int checkTable(const string& path, unsigned threads)
+{
+	BlackHoleLUTHeader header;
+	vector<unsigned char> bytes;
+	vector<float> values;
+	const void *texels = nullptr;
+	if (!loadTable(path, header, bytes, values, texels))
+	{
+		return 1;
+	}
+
+	vector<CheckedCell> cells(BlackHoleLUT::getTexelCount(header));
+	ThreadPool pool(threads);
+	pool.parallelFor(cells.size(), [&](size_t index)
+	{
+		CheckedCell& cell = cells[index];
+		cell.orIndex = index % header.orResolution;
+		cell.vPhi = index / header.orResolution % header.vPhiResolution;
+		cell.vr = index / header.orResolution / header.vPhiResolution;
+		cell.vertexR = axisValue(header.vrWarp, header.vrWarpParameter, header.vrMin, header.vrMax, cell.vr, header.vrResolution);
+		cell.vertexPhi = axisValue(header.vPhiWarp, header.vPhiWarpParameter, 0.0, 2 * PI, cell.vPhi, header.vPhiResolution);
+		cell.observerR = axisValue(header.orWarp, header.orWarpParameter, header.orMin, header.orMax, cell.orIndex, header.orResolution);
+		float value[BLACK_HOLE_LUT_CHANNELS];
+		BlackHoleLUT::decodeTexel(header, texels, index, value);
+		cell.crossingR = numeric_limits<double>::quiet_NaN();
+		cell.miss = -1.0;
+		// on the axis itself the ray runs along a radius and there is nothing to check
+		if (fabs(sin(value[0] - cell.vertexPhi)) < 1e-6)
+		{
+			return;
+		}
+		cell.miss = numeric_limits<double>::infinity();
+		if (traceToObserverAxis(cell.vertexR, cell.vertexPhi, value[0], cell.crossingR))
+		{
+			cell.miss = fabs(cell.crossingR - cell.observerR);
+		}
+	}, 16);
+
+	vector<double> misses;
+	size_t lost = 0;
+	size_t wrong = 0;
+	for (const CheckedCell& cell : cells)
+	{
+		if (cell.miss < 0.0)
+		{
+			continue;
+		}
+		misses.push_back(cell.miss);
+		lost += isinf(cell.miss) ? 1 : 0;
+		wrong += cell.miss > 0.1 ? 1 : 0;
+	}
+	sort(misses.begin(), misses.end());
+	cout << path << ": traced " << misses.size() << " of " << cells.size() << " cells back from their vertex" << endl;
+	if (misses.empty())
+	{
+		return 0;
+	}
+	cout << "  distance from the observer where they cross its axis: median " << misses[misses.size() / 2]
+		<< " p99 " << misses[misses.size() * 99 / 100] << " max " << misses.back() << endl;
+	cout << "  " << wrong << " cells miss by more than 0.1, " << lost << " of them fall in or escape" << endl;
+
+	sort(cells.begin(), cells.end(), [](const CheckedCell& a, const CheckedCell& b) { return a.miss > b.miss; });
+	for (size_t i = 0; i < cells.size() && i < 10 && cells[i].miss > 0.1; i++)
+	{
+		const CheckedCell& cell = cells[i];
+		cout << "  cell (" << cell.vr << ", " << cell.vPhi << ", " << cell.orIndex << "): vertex r " << cell.vertexR
+			<< " phi " << cell.vertexPhi << ", observer r " << cell.observerR << ", ";
+		if (isnan(cell.crossingR))
+		{
+			cout << "falls in or escapes" << endl;
+		}
+		else
+		{
+			cout << "crosses at r " << cell.crossingR << endl;
+		}
+	}
+	return wrong == 0 ? 0 : 2;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 3 && string(argv[1]) == "--check")
+	{
+		unsigned threads = 0;
+		if (argc == 5 && string(argv[3]) == "--threads")
+		{
+			threads = (unsigned)atoi(argv[4]);
+		}
+		else if (argc != 3)
+		{
+			printUsage();
+			return 1;
+		}
+		return checkTable(argv[2], threads);
+	}
+
+	GridSettings grid;
+	if (!parseArguments(argc, argv, grid))
+	{
+		printUsage();
+		return 1;
+	}
+
+	size_t cellCount = (size_t)grid.vrResolution * grid.vPhiResolution * grid.orResolution;
+	vector<float> values(cellCount * BLACK_HOLE_LUT_CHANNELS, numeric_limits<float>::quiet_NaN());
+
+	ThreadPool pool(grid.threads);
+	cout << "Solving " << cellCount << " cells on " << pool.getThreadCount() << " threads" << endl;
+
+	atomic<size_t> failures(0);
+	auto start = chrono::steady_clock::now();
+	if (grid.shootEveryCell)
+	{
+		solveCells(grid, pool, values, failures, start);
+	}
+	else
+	{
+		solveSlices(grid, pool, values, failures, start);
+	}
+
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "\rSolved " << cellCount << " cells in " << elapsed << " s (" << cellCount / elapsed << " cells/s)" << endl;
+	cout << "Failed to converge on " << failures << " paths. Ratio: " << (double)failures / cellCount << endl;
+
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		interpolateHoles(values, grid, channel);
+	}
+
+	BlackHoleLUTHeader header = BlackHoleLUT::makeHeader(grid.vrResolution, grid.vPhiResolution, grid.orResolution,
+		(float)grid.vrMin, (float)grid.vrMax, (float)grid.orMin, (float)grid.orMax);
+	header.vrWarp = grid.vrWarp;
+	header.vPhiWarp = grid.vPhiWarp;
+	header.orWarp = grid.orWarp;
+	header.vrWarpParameter = (float)grid.vrWarpParameter;
+	header.vPhiWarpParameter = (float)grid.vPhiWarpParameter;
+	header.orWarpParameter = (float)grid.orWarpParameter;
+	bool text = grid.outputPath.size() >= 4 && grid.outputPath.compare(grid.outputPath.size() - 4, 4, ".txt") == 0;
+	if (!(text ? BlackHoleLUT::writeText(grid.outputPath, header, values.data()) : BlackHoleLUT::write(grid.outputPath, header, values.data())))
+	{
+		return 1;
+	}
+	cout << "Wrote " << grid.outputPath << endl;
+
+	if (grid.evaluationPoints > 0)
+	{
+		evaluate(grid, header, values, pool);
+	}
+	return 0;
+}
@@ -0,0 +1,492 @@
+/*
+ * Command line helper for baked black hole tables.
+ *
+ *   BlackHoleLUTTool convert <input.txt> <output.bhlut>
+ *   BlackHoleLUTTool info <table.bhlut>
+ *   BlackHoleLUTTool pack <output.bhlut> <table> [table...]
+ *   BlackHoleLUTTool quantize <input> <output.bhlut> <float16|unorm16>
+ *   BlackHoleLUTTool bench-warp <table.bhlut> [vertices]
+ *   BlackHoleLUTTool bench-sample <table.bhlut> [lookups]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "BlackHoleLUT.h"
+#include "MappedFile.h"
+#include "BlackHoleWarp.h"
+
+using namespace std;
+
+static void printUsage()
+{
+	cerr << "usage: BlackHoleLUTTool convert <input.txt> <output.bhlut>" << endl;
+	cerr << "       BlackHoleLUTTool info <table.bhlut>" << endl;
+	cerr << "       BlackHoleLUTTool pack <output.bhlut> <table> [table...]" << endl;
+	cerr << "       BlackHoleLUTTool quantize <input> <output.bhlut> <float16|unorm16>" << endl;
+	cerr << "       BlackHoleLUTTool bench-warp <table.bhlut> [vertices]" << endl;
+	cerr << "       BlackHoleLUTTool bench-sample <table.bhlut> [lookups]" << endl;
+}
+
+static bool readHeader(const MappedFile& file, const string& path, BlackHoleLUTHeader& header)
+{
+	if (file.getSize() < sizeof(header))
+	{
+		cerr << path << ": file is truncated" << endl;
+		return false;
+	}
+	memcpy(&header, file.getData(), sizeof(header));
+
+	string error;
+	if (!BlackHoleLUT::validateHeader(header, file.getSize(), error))
+	{
+		cerr << path << ": " << error << endl;
+		return false;
+	}
+	return true;
+}
+
+static int convert(const string& inputPath, const string& outputPath)
+{
+	BlackHoleLUTHeader header;
+	vector<float> values;
+	if (!BlackHoleLUT::readText(inputPath, header, values))
+	{
+		return 1;
+	}
+	if (!BlackHoleLUT::write(outputPath, header, values.data()))
+	{
+		return 1;
+	}
+	cout << "Wrote " << outputPath << " (" << header.vrResolution << " x " << header.vPhiResolution << " x " << header.orResolution << ")" << endl;
+	return 0;
+}
+
+// prints one table image and checks its payload against the stored checksum
+static bool printTable(const BlackHoleLUTHeader& header, const unsigned char* image)
+{
+	uint32_t checksum = BlackHoleLUT::crc32(image + header.dataOffset, (size_t)header.dataSize);
+	cout << "version:      " << header.version << endl;
+	cout << "resolution:   " << header.vrResolution << " (vr) x " << header.vPhiResolution << " (vPhi) x " << header.orResolution << " (or)" << endl;
+	cout << "vr range:     " << header.vrMin << " - " << header.vrMax << endl;
+	cout << "or range:     " << header.orMin << " - " << header.orMax << endl;
+	cout << "warps:        " << BlackHoleLUT::getWarpName(header.vrWarp) << " " << header.vrWarpParameter << " (vr), "
+		<< BlackHoleLUT::getWarpName(header.vPhiWarp) << " " << header.vPhiWarpParameter << " (vPhi), "
+		<< BlackHoleLUT::getWarpName(header.orWarp) << " " << header.orWarpParameter << " (or)" << endl;
+	cout << "element type: " << BlackHoleLUT::getElementTypeName(header.elementType) << endl;
+	if (header.elementType != BLACK_HOLE_LUT_FLOAT32)
+	{
+		cout << "channels:     ";
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			cout << (channel ? ", " : "") << "x" << header.channelScale[channel] << " + " << header.channelOffset[channel];
+		}
+		cout << endl;
+	}
+	cout << "payload:      " << header.dataSize << " bytes at offset " << header.dataOffset << endl;
+	cout << "checksum:     " << hex << header.checksum << dec << (checksum == header.checksum ? " (ok)" : " (MISMATCH)") << endl;
+	return checksum == header.checksum;
+}
+
+static int info(const string& path)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		cerr << path << ": could not open" << endl;
+		return 1;
+	}
+
+	if (BlackHoleLUT::isPackFile(path))
+	{
+		vector<BlackHoleLUTPackEntry> entries;
+		vector<BlackHoleLUTHeader> headers;
+		string error;
+		if (!BlackHoleLUT::readPack(file.getData(), file.getSize(), entries, headers, error))
+		{
+			cerr << path << ": " << error << endl;
+			return 1;
+		}
+		cout << "pack with " << entries.size() << " levels" << endl;
+		bool ok = true;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			cout << endl << "level " << i << " (" << entries[i].size << " bytes at offset " << entries[i].offset << ")" << endl;
+			ok = printTable(headers[i], file.getData() + entries[i].offset) && ok;
+		}
+		return ok ? 0 : 1;
+	}
+
+	BlackHoleLUTHeader header;
+	if (!readHeader(file, path, header))
+	{
+		return 1;
+	}
+	return printTable(header, file.getData()) ? 0 : 1;
+}
+
+// bundles tables (binary or text) into one pack, coarsest first
+static int pack(const string& outputPath, const vector<string>& inputPaths)
+{
+	vector<vector<unsigned char>> levels;
+	for (const string& path : inputPaths)
+	{
+		if (BlackHoleLUT::isBinaryFile(path))
+		{
+			MappedFile file;
+			BlackHoleLUTHeader header;
+			if (!file.open(path) || !readHeader(file, path, header))
+			{
+				return 1;
+			}
+			levels.emplace_back(file.getData(), file.getData() + header.dataOffset + header.dataSize);
+		}
+		else
+		{
+			BlackHoleLUTHeader header;
+			vector<float> values;
+			if (!BlackHoleLUT::readText(path, header, values))
+			{
+				return 1;
+			}
+			levels.push_back(BlackHoleLUT::serialize(header, values.data()));
+		}
+	}
+
+	if (!BlackHoleLUT::writePack(outputPath, levels))
+	{
+		return 1;
+	}
+	cout << "Wrote " << outputPath << " with " << levels.size() << " levels" << endl;
+	return 0;
+}
+
+// float32 table from a binary or text file, anything already quantized is refused
+static bool readFloatTable(const string& path, BlackHoleLUTHeader& header, vector<float>& values)
+{
+	if (!BlackHoleLUT::isBinaryFile(path))
+	{
+		return BlackHoleLUT::readText(path, header, values);
+	}
+
+	MappedFile file;
+	if (!file.open(path) || !readHeader(file, path, header))
+	{
+		return false;
+	}
+	if (header.elementType != BLACK_HOLE_LUT_FLOAT32)
+	{
+		cerr << path << ": already stored as " << BlackHoleLUT::getElementTypeName(header.elementType) << endl;
+		return false;
+	}
+	values.resize(BlackHoleLUT::getTexelCount(header) * BLACK_HOLE_LUT_CHANNELS);
+	memcpy(values.data(), file.getData() + header.dataOffset, (size_t)header.dataSize);
+	return true;
+}
+
+// re-encodes a float table as 16 bit and reports how far every channel moved
+static int quantize(const string& inputPath, const string& outputPath, const string& typeName)
+{
+	uint32_t elementType;
+	if (typeName == "float16")
+	{
+		elementType = BLACK_HOLE_LUT_FLOAT16;
+	}
+	else if (typeName == "unorm16")
+	{
+		elementType = BLACK_HOLE_LUT_UNORM16;
+	}
+	else
+	{
+		cerr << "unknown element type " << typeName << ", expected float16 or unorm16" << endl;
+		return 1;
+	}
+
+	BlackHoleLUTHeader header;
+	vector<float> values;
+	if (!readFloatTable(inputPath, header, values))
+	{
+		return 1;
+	}
+
+	BlackHoleLUTHeader quantizedHeader;
+	vector<unsigned char> payload = BlackHoleLUT::quantize(header, values.data(), elementType, quantizedHeader);
+
+	// the GPU interpolates decoded values linearly, so nothing in between the grid points is worse than this
+	const char* channelNames[BLACK_HOLE_LUT_CHANNELS] = { "vertex angle", "observer angle", "distance" };
+	double maxError[BLACK_HOLE_LUT_CHANNELS] = {};
+	double squaredError[BLACK_HOLE_LUT_CHANNELS] = {};
+	double maxValue[BLACK_HOLE_LUT_CHANNELS] = {};
+	size_t texelCount = BlackHoleLUT::getTexelCount(header);
+	for (size_t texel = 0; texel < texelCount; texel++)
+	{
+		float decoded[BLACK_HOLE_LUT_CHANNELS];
+		BlackHoleLUT::decodeTexel(quantizedHeader, payload.data(), texel, decoded);
+		for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+		{
+			double original = values[texel * BLACK_HOLE_LUT_CHANNELS + channel];
+			double error = fabs(decoded[channel] - original);
+			maxError[channel] = max(maxError[channel], error);
+			squaredError[channel] += error * error;
+			maxValue[channel] = max(maxValue[channel], fabs(original));
+		}
+	}
+
+	if (!BlackHoleLUT::write(outputPath, quantizedHeader, payload.data()))
+	{
+		return 1;
+	}
+
+	size_t floatBytes = texelCount * BlackHoleLUT::getElementSize(BLACK_HOLE_LUT_FLOAT32);
+	cout << "Wrote " << outputPath << " as " << typeName << ", " << payload.size() << " bytes instead of " << floatBytes
+		<< " (" << (double)floatBytes / payload.size() << "x smaller)" << endl;
+	for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+	{
+		cout << "  " << channelNames[channel] << ": max error " << maxError[channel]
+			<< ", rms " << sqrt(squaredError[channel] / texelCount)
+			<< " (largest value " << maxValue[channel] << ")" << endl;
+	}
+	return 0;
+}
+
+// the finest level of a pack, or the whole file for a single table
+static bool mapTable(MappedFile& file, const string& path, BlackHoleLUTHeader& header, const unsigned char*& texels)
+{
+	if (!file.open(path))
+	{
+		cerr << path << ": could not open" << endl;
+		return false;
+	}
+	if (BlackHoleLUT::isPackFile(path))
+	{
+		vector<BlackHoleLUTPackEntry> entries;
+		vector<BlackHoleLUTHeader> headers;
+		string error;
+		if (!BlackHoleLUT::readPack(file.getData(), file.getSize(), entries, headers, error))
+		{
+			cerr << path << ": " << error << endl;
+			return false;
+		}
+		header = headers.back();
+		texels = file.getData() + entries.back().offset + header.dataOffset;
+		return true;
+	}
+	if (!readHeader(file, path, header))
+	{
+		return false;
+	}
+	texels = file.getData() + header.dataOffset;
+	return true;
+}
+
+// calls body until at least half a second has gone by, returns the seconds per call
+template<typename Body>
+static double timeCalls(Body body)
+{
+	auto start = chrono::steady_clock::now();
+	int calls = 0;
+	double elapsed = 0.0;
+	do
+	{
+		body();
+		calls++;
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	} while (elapsed < 0.5);
+	return elapsed / calls;
+}
+
+// warps a cloud of random vertices around the hole with and without AVX2
+static int benchWarp(const string& path, size_t count)
+{
+	MappedFile file;
+	BlackHoleLUTHeader header;
+	const unsigned char* texels;
+	if (!mapTable(file, path, header, texels))
+	{
+		return 1;
+	}
+	BlackHoleWarpTable table = BlackHoleWarp::prepare(header, texels);
+
+	BlackHoleWarpFrame frame;
+	frame.hole[2] = -0.5f * (header.orMin + header.orMax);
+
+	mt19937 random(1);
+	uniform_real_distribution<float> spread(-header.vrMax, header.vrMax);
+	normal_distribution<float> direction;
+	vector<float> input(count * 6);
+	for (size_t i = 0; i < count; i++)
+	{
+		float n[3] = { direction(random), direction(random), direction(random) };
+		float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int k = 0; k < 3; k++)
+		{
+			input[k * count + i] = frame.hole[k] + spread(random);
+			input[(k + 3) * count + i] = n[k] / length;
+		}
+	}
+
+	vector<float> scalarOutput(count * 6);
+	vector<float> simdOutput(count * 6);
+	auto makeBatch = [&](vector<float>& output)
+	{
+		BlackHoleWarpBatch batch;
+		batch.count = count;
+		for (int k = 0; k < 3; k++)
+		{
+			batch.position[k] = &input[k * count];
+			batch.normal[k] = &input[(k + 3) * count];
+			batch.warpedPosition[k] = &output[k * count];
+			batch.warpedNormal[k] = &output[(k + 3) * count];
+		}
+		return batch;
+	};
+	BlackHoleWarpBatch scalarBatch = makeBatch(scalarOutput);
+	BlackHoleWarpBatch simdBatch = makeBatch(simdOutput);
+
+	cout << BlackHoleLUT::getElementTypeName(header.elementType) << " table " << header.vrResolution << " x " << header.vPhiResolution
+		<< " x " << header.orResolution << ", " << count << " vertices" << endl;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		frame.secondary = pass == 1;
+		double scalarTime = timeCalls([&]() { BlackHoleWarp::warp(table, frame, scalarBatch, false); });
+		cout << (frame.secondary ? "secondary" : "primary  ") << "  scalar: " << count / scalarTime / 1e6 << " M vertices/s";
+		if (!BlackHoleWarp::hasAVX2())
+		{
+			cout << ", no AVX2 on this machine" << endl;
+			continue;
+		}
+		double simdTime = timeCalls([&]() { BlackHoleWarp::warp(table, frame, simdBatch, true); });
+
+		// compared relative to how far the vertex ends up from the observer
+		double positionError = 0.0;
+		double normalError = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			double distance = 0.0;
+			double positionDifference = 0.0;
+			double normalDifference = 0.0;
+			for (int k = 0; k < 3; k++)
+			{
+				distance += (double)scalarOutput[k * count + i] * scalarOutput[k * count + i];
+				positionDifference = max(positionDifference, (double)fabs(scalarOutput[k * count + i] - simdOutput[k * count + i]));
+				normalDifference = max(normalDifference, (double)fabs(scalarOutput[(k + 3) * count + i] - simdOutput[(k + 3) * count + i]));
+			}
+			positionError = max(positionError, positionDifference / max(sqrt(distance), 1.0));
+			normalError = max(normalError, normalDifference);
+		}
+		cout << ", AVX2: " << count / simdTime / 1e6 << " M vertices/s (" << scalarTime / simdTime << "x), max difference "
+			<< positionError << " position, " << normalError << " normal" << endl;
+	}
+	return 0;
+}
+
+// random lookups spread over the whole table, one at a time and batched
+static int benchSample(const string& path, size_t count)
+{
+	MappedFile file;
+	BlackHoleLUTHeader header;
+	const unsigned char* texels;
+	if (!mapTable(file, path, header, texels))
+	{
+		return 1;
+	}
+	BlackHoleWarpTable table = BlackHoleWarp::prepare(header, texels);
+
+	mt19937 random(1);
+	uniform_real_distribution<float> vertexRs(header.vrMin, header.vrMax);
+	uniform_real_distribution<float> vertexPhis(0.0f, 6.2831853f);
+	uniform_real_distribution<float> observerRs(header.orMin, header.orMax);
+	vector<float> vertexR(count), vertexPhi(count), observerR(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		vertexR[i] = vertexRs(random);
+		vertexPhi[i] = vertexPhis(random);
+		observerR[i] = observerRs(random);
+	}
+	vector<float> output(count * BLACK_HOLE_LUT_CHANNELS);
+	float* value[BLACK_HOLE_LUT_CHANNELS] = { &output[0], &output[count], &output[2 * count] };
+
+	// checked against the double precision reference so a fast wrong answer doesn't look good
+	auto maxError = [&]()
+	{
+		double error = 0.0;
+		for (size_t i = 0; i < count; i += 97)
+		{
+			float expected[BLACK_HOLE_LUT_CHANNELS];
+			BlackHoleLUT::sample(header, texels, vertexR[i], vertexPhi[i], observerR[i], expected);
+			for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+			{
+				error = max(error, (double)fabs(value[channel][i] - expected[channel]));
+			}
+		}
+		return error;
+	};
+
+	cout << BlackHoleLUT::getElementTypeName(header.elementType) << " table " << header.vrResolution << " x " << header.vPhiResolution
+		<< " x " << header.orResolution << ", " << count << " lookups" << endl;
+	double singleTime = timeCalls([&]()
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float result[BLACK_HOLE_LUT_CHANNELS];
+			BlackHoleWarp::sample(table, vertexR[i], vertexPhi[i], observerR[i], result);
+			for (int channel = 0; channel < BLACK_HOLE_LUT_CHANNELS; channel++)
+			{
+				value[channel][i] = result[channel];
+			}
+		}
+	});
+	cout << "single:         " << count / singleTime / 1e6 << " M lookups/s, max error " << maxError() << endl;
+	double scalarTime = timeCalls([&]() { BlackHoleWarp::sample(table, count, vertexR.data(), vertexPhi.data(), observerR.data(), value, false); });
+	cout << "batched scalar: " << count / scalarTime / 1e6 << " M lookups/s, max error " << maxError() << endl;
+	if (BlackHoleWarp::hasAVX2())
+	{
+		double simdTime = timeCalls([&]() { BlackHoleWarp::sample(table, count, vertexR.data(), vertexPhi.data(), observerR.data(), value, true); });
+		cout << "batched AVX2:   " << count / simdTime / 1e6 << " M lookups/s, max error " << maxError() << endl;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	string command = argv[1];
+	if (command == "convert" && argc == 4)
+	{
+		return convert(argv[2], argv[3]);
+	}
+	if (command == "info" && argc == 3)
+	{
+		return info(argv[2]);
+	}
+	if (command == "pack" && argc >= 4)
+	{
+		return pack(argv[2], vector<string>(argv + 3, argv + argc));
+	}
+	if (command == "quantize" && argc == 5)
+	{
+		return quantize(argv[2], argv[3], argv[4]);
+	}
+	if (command == "bench-warp" && (argc == 3 || argc == 4))
+	{
+		return benchWarp(argv[2], argc == 4 ? stoul(argv[3]) : 1 << 20);
+	}
+	if (command == "bench-sample" && (argc == 3 || argc == 4))
+	{
+		return benchSample(argv[2], argc == 4 ? stoul(argv[3]) : 1 << 20);
+	}
+
+	printUsage();
+	return 1;
+}
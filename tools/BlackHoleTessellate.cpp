@@ -0,0 +1,312 @@
+/*
+ * Adaptive tessellation of a mesh around the black hole.
+ *
+ *   BlackHoleTessellate <table> <input.obj> <output.obj> [options]
+ *
+ * Splits only the triangles whose edges the black hole bends by more than the
+ * tolerance, seen from anywhere along the camera path, and writes the result
+ * as a single shape .obj. Start from a coarse mesh: far from the hole it stays
+ * as it was, close to it it ends up as fine as it needs to be.
+ *
+ *   --tolerance degrees      how far a midpoint may be drawn from where it belongs (0.1)
+ *   --max-depth N            rounds of splitting at most (6)
+ *   --translate x y z        where the object sits in the scene
+ *   --scale s                and how big it is (1)
+ *   --hole x y z             black hole position (0 2.5 0, as in the scene)
+ *   --hole-size s            black hole size (0.4)
+ *   --camera-path path.txt   eyes along a camera path, as for --headless
+ *   --orbit radius height    eyes on a circle around the hole (7 0.5, the headless orbit)
+ *   --eyes N                 camera positions to check (32)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader/tiny_obj_loader.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "AdaptiveTessellation.h"
+#include "BlackHoleLUT.h"
+#include "BlackHoleWarp.h"
+#include "CameraPath.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+static void printUsage()
+{
+	cerr << "usage: BlackHoleTessellate <table> <input.obj> <output.obj> [--tolerance degrees] [--max-depth N]" << endl;
+	cerr << "           [--translate x y z] [--scale s] [--hole x y z] [--hole-size s]" << endl;
+	cerr << "           [--camera-path path.txt | --orbit radius height] [--eyes N]" << endl;
+}
+
+// the finest level of a pack, a single binary table or a text one parsed into values
+static bool loadTable(MappedFile& file, vector<float>& values, const string& path, BlackHoleLUTHeader& header, const void*& texels)
+{
+	if (!BlackHoleLUT::isBinaryFile(path))
+	{
+		if (!BlackHoleLUT::readText(path, header, values))
+		{
+			return false;
+		}
+		texels = values.data();
+		return true;
+	}
+	if (!file.open(path))
+	{
+		cerr << path << ": could not open" << endl;
+		return false;
+	}
+	string error;
+	if (BlackHoleLUT::isPackFile(path))
+	{
+		vector<BlackHoleLUTPackEntry> entries;
+		vector<BlackHoleLUTHeader> headers;
+		if (!BlackHoleLUT::readPack(file.getData(), file.getSize(), entries, headers, error))
+		{
+			cerr << path << ": " << error << endl;
+			return false;
+		}
+		header = headers.back();
+		texels = file.getData() + entries.back().offset + header.dataOffset;
+		return true;
+	}
+	if (file.getSize() < sizeof(header))
+	{
+		cerr << path << ": file is truncated" << endl;
+		return false;
+	}
+	memcpy(&header, file.getData(), sizeof(header));
+	if (!BlackHoleLUT::validateHeader(header, file.getSize(), error))
+	{
+		cerr << path << ": " << error << endl;
+		return false;
+	}
+	texels = file.getData() + header.dataOffset;
+	return true;
+}
+
+// every shape as one mesh, keeping normals and texcoords only if every shape has them
+static bool loadObj(const string& path, TessellationMesh& mesh)
+{
+	vector<tinyobj::shape_t> shapes;
+	vector<tinyobj::material_t> materials;
+	string error;
+	if (!tinyobj::LoadObj(shapes, materials, error, path.c_str()))
+	{
+		cerr << error << endl;
+		return false;
+	}
+	bool normals = true;
+	bool texcoords = true;
+	for (auto& shape : shapes)
+	{
+		normals = normals && shape.mesh.normals.size() == shape.mesh.positions.size();
+		texcoords = texcoords && shape.mesh.texcoords.size() / 2 == shape.mesh.positions.size() / 3;
+	}
+	for (auto& shape : shapes)
+	{
+		unsigned int base = (unsigned int)(mesh.positions.size() / 3);
+		mesh.positions.insert(mesh.positions.end(), shape.mesh.positions.begin(), shape.mesh.positions.end());
+		if (normals)
+		{
+			mesh.normals.insert(mesh.normals.end(), shape.mesh.normals.begin(), shape.mesh.normals.end());
+		}
+		if (texcoords)
+		{
+			mesh.texcoords.insert(mesh.texcoords.end(), shape.mesh.texcoords.begin(), shape.mesh.texcoords.end());
+		}
+		for (unsigned int index : shape.mesh.indices)
+		{
+			mesh.indices.push_back(base + index);
+		}
+	}
+	return true;
+}
+
+static bool writeObj(const string& path, const TessellationMesh& mesh)
+{
+	ofstream file(path);
+	// enough digits that positions read back exactly
+	file.precision(9);
+	if (!file)
+	{
+		cerr << "Failed to open " << path << " for writing" << endl;
+		return false;
+	}
+	file << "# adaptively tessellated by BlackHoleTessellate" << endl;
+	for (size_t i = 0; i < mesh.positions.size(); i += 3)
+	{
+		file << "v " << mesh.positions[i] << " " << mesh.positions[i + 1] << " " << mesh.positions[i + 2] << "\n";
+	}
+	for (size_t i = 0; i < mesh.normals.size(); i += 3)
+	{
+		file << "vn " << mesh.normals[i] << " " << mesh.normals[i + 1] << " " << mesh.normals[i + 2] << "\n";
+	}
+	for (size_t i = 0; i < mesh.texcoords.size(); i += 2)
+	{
+		file << "vt " << mesh.texcoords[i] << " " << mesh.texcoords[i + 1] << "\n";
+	}
+	// positions, texcoords and normals share their indices, .obj counts from 1
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		file << "f";
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int index = mesh.indices[i + k] + 1;
+			file << " " << index;
+			if (!mesh.texcoords.empty() || !mesh.normals.empty())
+			{
+				file << "/";
+				if (!mesh.texcoords.empty())
+				{
+					file << index;
+				}
+				if (!mesh.normals.empty())
+				{
+					file << "/" << index;
+				}
+			}
+		}
+		file << "\n";
+	}
+	if (!file)
+	{
+		cerr << "Failed to write " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+static void printError(const char *label, const TessellationError& error, float tolerance)
+{
+	cout << label << error.edges << " edges, worst drawn " << glm::degrees(error.maxDeviation) << " degrees off, "
+		<< error.edgesOverTolerance << " over " << glm::degrees(tolerance) << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 4)
+	{
+		printUsage();
+		return 1;
+	}
+	string tablePath = argv[1];
+	string inputPath = argv[2];
+	string outputPath = argv[3];
+
+	TessellationSettings settings;
+	settings.tolerance = glm::radians(0.1f);
+	settings.holePosition = glm::vec3(0.0f, 2.5f, 0.0f);
+	settings.holeSize = 0.4f;
+	glm::vec3 translation(0.0f);
+	float scale = 1.0f;
+	string cameraPathFile;
+	float orbitRadius = 7.0f;
+	float orbitHeight = 0.5f;
+	int eyeCount = 32;
+	for (int i = 4; i < argc; i++)
+	{
+		string argument = argv[i];
+		int values = argc - i - 1;
+		if (argument == "--tolerance" && values >= 1)
+		{
+			settings.tolerance = glm::radians(stof(argv[++i]));
+		}
+		else if (argument == "--max-depth" && values >= 1)
+		{
+			settings.maxDepth = stoi(argv[++i]);
+		}
+		else if (argument == "--translate" && values >= 3)
+		{
+			translation = glm::vec3(stof(argv[i + 1]), stof(argv[i + 2]), stof(argv[i + 3]));
+			i += 3;
+		}
+		else if (argument == "--scale" && values >= 1)
+		{
+			scale = stof(argv[++i]);
+		}
+		else if (argument == "--hole" && values >= 3)
+		{
+			settings.holePosition = glm::vec3(stof(argv[i + 1]), stof(argv[i + 2]), stof(argv[i + 3]));
+			i += 3;
+		}
+		else if (argument == "--hole-size" && values >= 1)
+		{
+			settings.holeSize = stof(argv[++i]);
+		}
+		else if (argument == "--camera-path" && values >= 1)
+		{
+			cameraPathFile = argv[++i];
+		}
+		else if (argument == "--orbit" && values >= 2)
+		{
+			orbitRadius = stof(argv[i + 1]);
+			orbitHeight = stof(argv[i + 2]);
+			i += 2;
+		}
+		else if (argument == "--eyes" && values >= 1)
+		{
+			eyeCount = max(1, stoi(argv[++i]));
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	settings.model = glm::scale(glm::translate(glm::mat4(1.0f), translation), glm::vec3(scale));
+
+	CameraPath cameraPath;
+	if (cameraPathFile.empty())
+	{
+		cameraPath.makeOrbit(settings.holePosition, orbitRadius, orbitHeight, 1.0);
+	}
+	else if (!cameraPath.loadFromFile(cameraPathFile))
+	{
+		return 1;
+	}
+	double start = cameraPath.keyframes.front().time;
+	double end = cameraPath.loop ? cameraPath.loopTime : cameraPath.keyframes.back().time;
+	for (int i = 0; i < eyeCount; i++)
+	{
+		glm::vec3 eye, target;
+		// a looped path would land back on its first eye
+		cameraPath.evaluate(start + (end - start) * i / (cameraPath.loop ? eyeCount : max(1, eyeCount - 1)), eye, target);
+		settings.eyes.push_back(eye);
+	}
+
+	MappedFile tableFile;
+	vector<float> tableValues;
+	BlackHoleLUTHeader header;
+	const void *texels = nullptr;
+	TessellationMesh mesh;
+	if (!loadTable(tableFile, tableValues, tablePath, header, texels) || !loadObj(inputPath, mesh))
+	{
+		return 1;
+	}
+	BlackHoleWarpTable table = BlackHoleWarp::prepare(header, texels);
+	ThreadPool pool;
+
+	size_t inputVertices = mesh.positions.size() / 3;
+	printError("before: ", AdaptiveTessellation::measure(table, settings, mesh, &pool), settings.tolerance);
+	auto tessellateStart = chrono::steady_clock::now();
+	TessellationStats stats = AdaptiveTessellation::tessellate(table, settings, mesh, &pool);
+	double tessellateTime = chrono::duration<double, milli>(chrono::steady_clock::now() - tessellateStart).count();
+	printError("after:  ", AdaptiveTessellation::measure(table, settings, mesh, &pool), settings.tolerance);
+	cout << stats.inputTriangles << " triangles and " << inputVertices << " vertices to " << stats.outputTriangles << " triangles and "
+		<< mesh.positions.size() / 3 << " vertices, " << stats.splitEdges << " edges split over " << stats.rounds << " rounds in "
+		<< tessellateTime << " ms, from " << settings.eyes.size() << " eyes" << endl;
+	// what splitting everything as many times would have cost
+	cout << "uniform subdivision to the same depth: " << (stats.inputTriangles << (2 * stats.rounds)) << " triangles" << endl;
+
+	return writeObj(outputPath, mesh) ? 0 : 1;
+}
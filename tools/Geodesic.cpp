@@ -0,0 +1,534 @@
+#include "Geodesic.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+constexpr double PI = 3.14159265358979323846;
+// u at the photon sphere (r = 1.5), rays can only turn around on the far side of it
+constexpr double PHOTON_SPHERE_U = 2.0 / 3.0;
+constexpr int MAX_STEPS = 1000000;
+
+// Dormand-Prince 5(4) tableau
+static const double C[7] = { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 };
+static const double A[7][6] = {
+	{ 0.0 },
+	{ 1.0 / 5.0 },
+	{ 3.0 / 40.0, 9.0 / 40.0 },
+	{ 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0 },
+	{ 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0 },
+	{ 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0 },
+	{ 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 }
+};
+// difference between the fifth and fourth order weights
+static const double E[7] = { 71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0 };
+
+GeodesicRay::GeodesicRay(double observerR, double psi) :
+	captureU(1.0),
+	escapeU(0.0),
+	relativeTolerance(1e-10),
+	absoluteTolerance(1e-12),
+	outcome(GEODESIC_TRAVELLING),
+	phi(0.0),
+	u(1.0 / observerR),
+	w(0.0),
+	length(0.0),
+	stepSize(0.0),
+	stepCount(0)
+{
+	// the impact parameter follows from the launch angle in the observer's static frame
+	w = u * std::sqrt(1.0 - u) * std::cos(psi) / std::sin(psi);
+	stepSize = 1e-2 / (1.0 + std::fabs(w) / u);
+
+	double dr = -w / (u * u);
+	observerAngle = std::atan2(observerR, dr);
+}
+
+void GeodesicRay::derivatives(const double* y, double* dy) const
+{
+	double stateU = std::max(y[0], 1e-12);
+	dy[0] = y[1];
+	dy[1] = -y[0] + 1.5 * y[0] * y[0];
+	dy[2] = std::sqrt(y[1] * y[1] + stateU * stateU) / (stateU * stateU);
+}
+
+bool GeodesicRay::advanceTo(double targetPhi)
+{
+	double y[3] = { u, w, length };
+	double k[7][3];
+	double stage[3];
+	double next[3];
+
+	while (outcome == GEODESIC_TRAVELLING && phi < targetPhi)
+	{
+		if (stepCount++ > MAX_STEPS || stepSize < 1e-15)
+		{
+			outcome = GEODESIC_STALLED;
+			break;
+		}
+
+		double h = std::min(stepSize, targetPhi - phi);
+		bool truncated = h < stepSize;
+
+		derivatives(y, k[0]);
+		for (int s = 1; s < 7; s++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				stage[i] = y[i];
+				for (int j = 0; j < s; j++)
+				{
+					stage[i] += h * A[s][j] * k[j][i];
+				}
+			}
+			derivatives(stage, k[s]);
+		}
+		// the last stage is evaluated at the fifth order solution (FSAL)
+		for (int i = 0; i < 3; i++)
+		{
+			next[i] = stage[i];
+		}
+
+		double errorNorm = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			double error = 0.0;
+			for (int s = 0; s < 7; s++)
+			{
+				error += h * E[s] * k[s][i];
+			}
+			double scale = absoluteTolerance + relativeTolerance * std::max(std::fabs(y[i]), std::fabs(next[i]));
+			errorNorm += (error / scale) * (error / scale);
+		}
+		errorNorm = std::sqrt(errorNorm / 3.0);
+		if (!std::isfinite(errorNorm))
+		{
+			stepSize *= 0.1;
+			continue;
+		}
+
+		double factor = errorNorm > 0.0 ? 0.9 * std::pow(errorNorm, -0.2) : 5.0;
+		factor = std::min(5.0, std::max(0.2, factor));
+		if (errorNorm > 1.0)
+		{
+			stepSize = h * factor;
+			continue;
+		}
+
+		phi = truncated ? targetPhi : phi + h;
+		for (int i = 0; i < 3; i++)
+		{
+			y[i] = next[i];
+		}
+		// don't let a short final step shrink the step for the next segment
+		stepSize = truncated ? std::max(stepSize, h * factor) : h * factor;
+
+		if (y[0] >= 1.0 || (y[1] > 0.0 && y[0] >= captureU && y[0] >= PHOTON_SPHERE_U))
+		{
+			outcome = GEODESIC_CAPTURED;
+		}
+		else if (y[0] <= 0.0 || (y[1] < 0.0 && y[0] <= escapeU && y[0] <= PHOTON_SPHERE_U))
+		{
+			outcome = GEODESIC_ESCAPED;
+		}
+	}
+
+	u = y[0];
+	w = y[1];
+	length = y[2];
+	return outcome == GEODESIC_TRAVELLING;
+}
+
+double GeodesicRay::getVertexAngle(double u, double w, double phi)
+{
+	double r = 1.0 / u;
+	double dr = -w / (u * u);
+	double dx = dr * std::cos(phi) - r * std::sin(phi);
+	double dy = dr * std::sin(phi) + r * std::cos(phi);
+	// the ray was traced towards the vertex, light travels the other way
+	return std::atan2(-dy, -dx);
+}
+
+// signed miss distance in u, infinite when the ray never gets there
+static double shoot(double psi, double vertexU, double vertexPhi, double observerR, GeodesicRay& ray)
+{
+	ray = GeodesicRay(observerR, psi);
+	ray.captureU = vertexU;
+	ray.escapeU = vertexU;
+	if (ray.advanceTo(vertexPhi))
+	{
+		return ray.u - vertexU;
+	}
+	switch (ray.outcome)
+	{
+	case GEODESIC_CAPTURED:
+		return std::numeric_limits<double>::infinity();
+	case GEODESIC_ESCAPED:
+		return -std::numeric_limits<double>::infinity();
+	default:
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+}
+
+bool solveGeodesic(double vertexR, double vertexPhi, double observerR, GeodesicSample& sample)
+{
+	// straight along the axis, there is nothing to bend
+	if (vertexPhi <= 1e-9)
+	{
+		if (std::fabs(vertexR - observerR) <= 1e-12)
+		{
+			// the vertex is the observer, the script's arctan2(0, 0) gives 0 here
+			sample.vertexAngle = 0.0;
+			sample.observerAngle = 0.0;
+			sample.distance = 0.0;
+			return true;
+		}
+		bool inFront = vertexR < observerR;
+		sample.vertexAngle = inFront ? 0.0 : PI;
+		sample.observerAngle = inFront ? PI : 0.0;
+		sample.distance = std::fabs(observerR - vertexR);
+		return true;
+	}
+
+	double vertexU = 1.0 / vertexR;
+	GeodesicRay ray(observerR, PI / 2);
+
+	// launching straight at the hole gets captured, straight away from it escapes
+	double low = 1e-9;
+	double high = PI - 1e-9;
+	double lowMiss = shoot(low, vertexU, vertexPhi, observerR, ray);
+	double highMiss = shoot(high, vertexU, vertexPhi, observerR, ray);
+	if (!(lowMiss > 0.0) || !(highMiss < 0.0))
+	{
+		return false;
+	}
+
+	GeodesicRay best(observerR, PI / 2);
+	double bestMiss = std::numeric_limits<double>::infinity();
+	int side = 0;
+	for (int iteration = 0; iteration < 200 && high - low > 1e-14; iteration++)
+	{
+		// Illinois regula falsi once both ends are finite, bisection until then
+		double psi = 0.5 * (low + high);
+		if (std::isfinite(lowMiss) && std::isfinite(highMiss))
+		{
+			psi = (low * highMiss - high * lowMiss) / (highMiss - lowMiss);
+			if (!(psi > low && psi < high))
+			{
+				psi = 0.5 * (low + high);
+			}
+		}
+
+		double miss = shoot(psi, vertexU, vertexPhi, observerR, ray);
+		if (std::isnan(miss))
+		{
+			return false;
+		}
+		if (std::isfinite(miss) && std::fabs(miss) < std::fabs(bestMiss))
+		{
+			best = ray;
+			bestMiss = miss;
+			if (std::fabs(miss) < 1e-12)
+			{
+				break;
+			}
+		}
+
+		if (miss > 0.0)
+		{
+			low = psi;
+			lowMiss = miss;
+			if (side == 1 && std::isfinite(highMiss))
+			{
+				highMiss *= 0.5;
+			}
+			side = 1;
+		}
+		else
+		{
+			high = psi;
+			highMiss = miss;
+			if (side == -1 && std::isfinite(lowMiss))
+			{
+				lowMiss *= 0.5;
+			}
+			side = -1;
+		}
+	}
+
+	if (!(std::fabs(bestMiss) < 1e-8 * vertexU))
+	{
+		return false;
+	}
+
+	sample.vertexAngle = best.getVertexAngle();
+	sample.observerAngle = best.getObserverAngle();
+	sample.distance = best.length;
+	return true;
+}
+
+namespace
+{
+	// where a family ray is at one of the vertex angles, u is +inf once it has
+	// been captured, -inf once it has escaped and NaN if the integrator gave up
+	struct RayColumn
+	{
+		double u;
+		double w;
+		double length;
+	};
+
+	struct FamilyRay
+	{
+		double psi;
+		std::vector<RayColumn> columns;
+	};
+
+	struct SliceProblem
+	{
+		double observerR;
+		const std::vector<double>* vertexPhis;
+		// vertex u in ascending order, with the vr index each came from
+		std::vector<std::pair<double, size_t>> targets;
+		double captureU;
+		double escapeU;
+		double tolerance;
+		std::vector<GeodesicSample>* samples;
+		std::vector<char>* solved;
+		size_t rayCount;
+	};
+}
+
+static FamilyRay traceFamilyRay(double psi, SliceProblem& problem)
+{
+	const std::vector<double>& phis = *problem.vertexPhis;
+	FamilyRay ray;
+	ray.psi = psi;
+	ray.columns.resize(phis.size());
+	problem.rayCount++;
+
+	GeodesicRay geodesic(problem.observerR, psi);
+	geodesic.captureU = problem.captureU;
+	geodesic.escapeU = problem.escapeU;
+	for (size_t j = 0; j < phis.size(); j++)
+	{
+		if (!geodesic.advanceTo(phis[j]))
+		{
+			double lost = geodesic.outcome == GEODESIC_CAPTURED ? std::numeric_limits<double>::infinity()
+				: geodesic.outcome == GEODESIC_ESCAPED ? -std::numeric_limits<double>::infinity()
+				: std::numeric_limits<double>::quiet_NaN();
+			for (; j < phis.size(); j++)
+			{
+				ray.columns[j] = { lost, 0.0, 0.0 };
+			}
+			break;
+		}
+		ray.columns[j] = { geodesic.u, geodesic.w, geodesic.length };
+	}
+	return ray;
+}
+
+// range of targets lying between the two u values
+static std::pair<size_t, size_t> bracketedTargets(const SliceProblem& problem, double ua, double ub)
+{
+	double low = std::min(ua, ub);
+	double high = std::max(ua, ub);
+	auto first = std::lower_bound(problem.targets.begin(), problem.targets.end(), std::make_pair(low, (size_t)0));
+	auto last = std::upper_bound(first, problem.targets.end(), std::make_pair(high, std::numeric_limits<size_t>::max()));
+	return { (size_t)(first - problem.targets.begin()), (size_t)(last - problem.targets.begin()) };
+}
+
+// true if some target falls between a ray that arrived and one that was lost,
+// those have to be bisected until the one that arrived gets past the target
+static bool straddlesLostRay(const FamilyRay& a, const FamilyRay& b, const SliceProblem& problem)
+{
+	const std::vector<double>& phis = *problem.vertexPhis;
+	for (size_t j = 0; j < phis.size(); j++)
+	{
+		const RayColumn& ca = a.columns[j];
+		const RayColumn& cb = b.columns[j];
+		if (phis[j] <= 1e-9 || (std::isfinite(ca.u) && std::isfinite(cb.u)))
+		{
+			continue;
+		}
+		if (std::isnan(ca.u) || std::isnan(cb.u))
+		{
+			return true;
+		}
+		auto range = bracketedTargets(problem, ca.u, cb.u);
+		if (range.first != range.second)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// checks the middle ray against the straight line between its neighbours
+// wherever targets are bracketed, which is the error interpolation would make
+static bool isLinearEnough(const FamilyRay& a, const FamilyRay& middle, const FamilyRay& b, const SliceProblem& problem)
+{
+	const std::vector<double>& phis = *problem.vertexPhis;
+	for (size_t j = 0; j < phis.size(); j++)
+	{
+		const RayColumn& ca = a.columns[j];
+		const RayColumn& cm = middle.columns[j];
+		const RayColumn& cb = b.columns[j];
+		if (phis[j] <= 1e-9 || !std::isfinite(ca.u) || !std::isfinite(cb.u))
+		{
+			continue;
+		}
+		auto range = bracketedTargets(problem, ca.u, cb.u);
+		if (range.first == range.second)
+		{
+			continue;
+		}
+		if (!std::isfinite(cm.u))
+		{
+			return false;
+		}
+
+		double u = 0.5 * (ca.u + cb.u);
+		double angleGap = std::fabs(GeodesicRay::getVertexAngle(u, 0.5 * (ca.w + cb.w), phis[j])
+			- GeodesicRay::getVertexAngle(cm.u, cm.w, phis[j]));
+		angleGap = std::min(angleGap, 2 * PI - angleGap);
+		double length = 0.5 * (ca.length + cb.length);
+		if (angleGap > problem.tolerance
+			|| std::fabs(u - cm.u) > problem.tolerance * cm.u
+			|| std::fabs(length - cm.length) > problem.tolerance * std::max(1.0, cm.length))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// fills every cell whose crossing lies between two neighbouring rays
+static void interpolateCrossings(const FamilyRay& a, const FamilyRay& b, SliceProblem& problem)
+{
+	const std::vector<double>& phis = *problem.vertexPhis;
+	for (size_t j = 0; j < phis.size(); j++)
+	{
+		const RayColumn& ca = a.columns[j];
+		const RayColumn& cb = b.columns[j];
+		if (phis[j] <= 1e-9 || !std::isfinite(ca.u) || !std::isfinite(cb.u))
+		{
+			continue;
+		}
+		auto range = bracketedTargets(problem, ca.u, cb.u);
+		for (size_t target = range.first; target < range.second; target++)
+		{
+			double vertexU = problem.targets[target].first;
+			size_t cell = problem.targets[target].second * phis.size() + j;
+			if ((*problem.solved)[cell])
+			{
+				continue;
+			}
+			double t = cb.u != ca.u ? (vertexU - ca.u) / (cb.u - ca.u) : 0.0;
+			double psi = a.psi + t * (b.psi - a.psi);
+			double w = ca.w + t * (cb.w - ca.w);
+
+			GeodesicSample& sample = (*problem.samples)[cell];
+			sample.vertexAngle = GeodesicRay::getVertexAngle(vertexU, w, phis[j]);
+			sample.observerAngle = GeodesicRay(problem.observerR, psi).getObserverAngle();
+			sample.distance = ca.length + t * (cb.length - ca.length);
+			(*problem.solved)[cell] = 1;
+		}
+	}
+}
+
+static void refineFamily(const FamilyRay& a, const FamilyRay& b, SliceProblem& problem)
+{
+	if (b.psi - a.psi <= 1e-13)
+	{
+		interpolateCrossings(a, b, problem);
+		return;
+	}
+
+	bool lost = straddlesLostRay(a, b, problem);
+	FamilyRay middle = traceFamilyRay(0.5 * (a.psi + b.psi), problem);
+	if (!lost && isLinearEnough(a, middle, b, problem))
+	{
+		interpolateCrossings(a, middle, problem);
+		interpolateCrossings(middle, b, problem);
+		return;
+	}
+	refineFamily(a, middle, problem);
+	refineFamily(middle, b, problem);
+}
+
+size_t solveGeodesicSlice(double observerR, const std::vector<double>& vertexRadii, const std::vector<double>& vertexPhis,
+	double tolerance, std::vector<GeodesicSample>& samples, std::vector<char>& solved)
+{
+	samples.assign(vertexRadii.size() * vertexPhis.size(), GeodesicSample());
+	solved.assign(samples.size(), 0);
+
+	SliceProblem problem;
+	problem.observerR = observerR;
+	problem.vertexPhis = &vertexPhis;
+	problem.tolerance = tolerance;
+	problem.samples = &samples;
+	problem.solved = &solved;
+	problem.rayCount = 0;
+	for (size_t i = 0; i < vertexRadii.size(); i++)
+	{
+		problem.targets.push_back({ 1.0 / vertexRadii[i], i });
+	}
+	std::sort(problem.targets.begin(), problem.targets.end());
+	if (problem.targets.empty())
+	{
+		return 0;
+	}
+	// stop rays a little past the innermost and outermost vertex, the margin leaves room for
+	// rays near the edge of the family to bracket those without bisecting all the way down
+	problem.captureU = problem.targets.back().first * 1.05;
+	problem.escapeU = problem.targets.front().first * 0.95;
+
+	// the axis needs no rays at all
+	for (size_t j = 0; j < vertexPhis.size(); j++)
+	{
+		if (vertexPhis[j] > 1e-9)
+		{
+			continue;
+		}
+		for (size_t i = 0; i < vertexRadii.size(); i++)
+		{
+			size_t cell = i * vertexPhis.size() + j;
+			solved[cell] = solveGeodesic(vertexRadii[i], vertexPhis[j], observerR, samples[cell]);
+		}
+	}
+
+	// a coarse fan from straight at the hole to straight away from it, refined where needed
+	const int initialRays = 32;
+	double low = 1e-9;
+	double high = PI - 1e-9;
+	FamilyRay previous = traceFamilyRay(low, problem);
+	for (int i = 1; i <= initialRays; i++)
+	{
+		FamilyRay next = traceFamilyRay(low + (high - low) * i / initialRays, problem);
+		refineFamily(previous, next, problem);
+		previous = std::move(next);
+	}
+	return problem.rayCount;
+}
+
+bool traceToObserverAxis(double vertexR, double vertexPhi, double vertexAngle, double& crossingR)
+{
+	double radial = std::cos(vertexAngle - vertexPhi);
+	double tangential = std::sin(vertexAngle - vertexPhi);
+	if (std::fabs(tangential) < 1e-9)
+	{
+		return false;
+	}
+	// phi always increases along a GeodesicRay, so a ray turning the other way is traced mirrored
+	double sweep = tangential < 0.0 ? vertexPhi : 2 * PI - vertexPhi;
+	GeodesicRay ray(vertexR, PI / 2);
+	ray.w = -ray.u * radial / std::fabs(tangential);
+	ray.stepSize = 1e-2 / (1.0 + std::fabs(ray.w) / ray.u);
+	if (!ray.advanceTo(sweep))
+	{
+		return false;
+	}
+	crossingR = ray.getRadius();
+	return true;
+}
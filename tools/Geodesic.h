@@ -0,0 +1,95 @@
+#pragma once
+#ifndef _GEODESIC_H_
+#define _GEODESIC_H_
+
+#include <vector>
+#include <cstddef>
+
+// Null geodesics around a Schwarzschild black hole, in units of the
+// Schwarzschild radius (the same normalization black_hole_grid_calculator.py
+// uses, so results are independent of BlackHoleMap::size).
+//
+// Rays are traced from the observer towards the vertex using the orbit
+// equation u'' = -u + 3/2 u^2 with u = 1/r and phi as the parameter. The
+// observer sits at phi = 0 and phi increases along the ray. Alongside u we
+// carry the length of the path in the flat (x, y) = r (cos phi, sin phi)
+// picture, which is what the table stores as the distance.
+
+enum GeodesicOutcome
+{
+	GEODESIC_TRAVELLING,
+	GEODESIC_CAPTURED,
+	GEODESIC_ESCAPED,
+	GEODESIC_STALLED
+};
+
+class GeodesicRay
+{
+public:
+	// psi is the launch angle measured from the direction pointing at the hole
+	GeodesicRay(double observerR, double psi);
+
+	// Integrates to targetPhi with an adaptive Dormand-Prince 5(4) scheme.
+	// Returns false if the ray is known to be captured or to escape first.
+	bool advanceTo(double targetPhi);
+
+	// rays moving inwards past captureU (or outwards past escapeU) outside the
+	// photon sphere can never turn around, so they are stopped early
+	double captureU;
+	double escapeU;
+	double relativeTolerance;
+	double absoluteTolerance;
+
+	GeodesicOutcome outcome;
+	double phi;
+	double u;
+	double w;
+	double length;
+	double stepSize;
+	int stepCount;
+
+	double getRadius() const { return 1.0 / u; }
+	// angle of the direction the observer sees the ray arrive from
+	double getObserverAngle() const { return observerAngle; }
+	// angle of the direction light leaves the current point towards the observer
+	double getVertexAngle() const { return getVertexAngle(u, w, phi); }
+	static double getVertexAngle(double u, double w, double phi);
+
+private:
+	void derivatives(const double* y, double* dy) const;
+	double observerAngle;
+};
+
+struct GeodesicSample
+{
+	double vertexAngle;
+	double observerAngle;
+	double distance;
+};
+
+// Finds the ray from (observerR, 0) that reaches (vertexR, vertexPhi) by
+// shooting over the launch angle. vertexPhi may go up to 2 pi for rays that
+// wrap around the hole. Returns false if no ray could be found.
+bool solveGeodesic(double vertexR, double vertexPhi, double observerR, GeodesicSample& sample);
+
+// Solves every (vertexR, vertexPhi) cell for one observer radius from a single
+// family of rays. Each ray is integrated once across all of vertexPhis (which
+// must be ascending) and its crossings of the vertex radii are interpolated
+// between neighbouring rays. The family is bisected until the middle ray of
+// every interval lies within tolerance of the straight line between its
+// neighbours (radians, or relative for u and length), so rays bunch up
+// around the photon sphere where it matters.
+//
+// samples and solved are indexed [vrIndex * vertexPhis.size() + vPhiIndex].
+// Returns the number of rays that were traced.
+size_t solveGeodesicSlice(double observerR, const std::vector<double>& vertexRadii, const std::vector<double>& vertexPhis,
+	double tolerance, std::vector<GeodesicSample>& samples, std::vector<char>& solved);
+
+// Follows light leaving (vertexR, vertexPhi) along vertexAngle, a table's
+// first channel, round to the observer's axis (phi = 0, or 2 pi going the
+// other way) and gives the radius it crosses it at. For a right table entry
+// that is the observer radius. Returns false if the ray falls in or escapes
+// first, or leaves straight along a radius, where there is nothing to check.
+bool traceToObserverAxis(double vertexR, double vertexPhi, double vertexAngle, double& crossingR);
+
+#endif
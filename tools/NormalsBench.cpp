@@ -0,0 +1,198 @@
+/*
+ * Times Normals::generate against the scatter-add Shape::generateNormals used
+ * before it, on a .obj or on a generated sphere.
+ *
+ *   NormalsBench <mesh.obj> [repeats]
+ *   NormalsBench --sphere <rings> [repeats]
+ *
+ * A sphere of 1024 rings has about 4 million triangles.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader/tiny_obj_loader.h>
+
+#include "Normals.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+struct Mesh
+{
+	vector<float> positions;
+	vector<unsigned int> indices;
+};
+
+// the old Shape::generateNormals, with glm swapped for plain floats
+static void scatterNormals(const Mesh& mesh, vector<float>& normals)
+{
+	normals.assign(mesh.positions.size(), 0.0f);
+	const vector<float>& posBuf = mesh.positions;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		size_t vert[3] = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+		float edge1[3], edge2[3];
+		for (int c = 0; c < 3; c++)
+		{
+			edge1[c] = posBuf[3 * vert[1] + c] - posBuf[3 * vert[0] + c];
+			edge2[c] = posBuf[3 * vert[2] + c] - posBuf[3 * vert[0] + c];
+		}
+		float normal[3] = {
+			edge1[1] * edge2[2] - edge1[2] * edge2[1],
+			edge1[2] * edge2[0] - edge1[0] * edge2[2],
+			edge1[0] * edge2[1] - edge1[1] * edge2[0]
+		};
+		float scale = 1.0f / sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				normals[3 * vert[corner] + c] += normal[c] * scale;
+			}
+		}
+	}
+	for (size_t i = 0; i < normals.size(); i += 3)
+	{
+		float scale = 1.0f / sqrt(normals[i] * normals[i] + normals[i + 1] * normals[i + 1] + normals[i + 2] * normals[i + 2]);
+		for (int c = 0; c < 3; c++)
+		{
+			normals[i + c] *= scale;
+		}
+	}
+}
+
+static bool loadObj(const string& path, Mesh& mesh)
+{
+	vector<tinyobj::shape_t> shapes;
+	vector<tinyobj::material_t> materials;
+	string error;
+	if (!tinyobj::LoadObj(shapes, materials, error, path.c_str()))
+	{
+		cerr << error << endl;
+		return false;
+	}
+	// every shape as one mesh, the benchmark doesn't care where they split
+	for (auto& shape : shapes)
+	{
+		unsigned int base = (unsigned int)(mesh.positions.size() / 3);
+		mesh.positions.insert(mesh.positions.end(), shape.mesh.positions.begin(), shape.mesh.positions.end());
+		for (unsigned int index : shape.mesh.indices)
+		{
+			mesh.indices.push_back(base + index);
+		}
+	}
+	return true;
+}
+
+// rings x 2 rings quads with the poles welded, in scan order like an exported grid
+static void makeSphere(int rings, Mesh& mesh)
+{
+	int segments = 2 * rings;
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		float theta = 3.14159265f * ring / rings;
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float phi = 6.28318531f * segment / segments;
+			mesh.positions.push_back(sin(theta) * cos(phi));
+			mesh.positions.push_back(cos(theta));
+			mesh.positions.push_back(sin(theta) * sin(phi));
+		}
+	}
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int segment = 0; segment < segments; segment++)
+		{
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+			if (ring > 0)
+			{
+				mesh.indices.insert(mesh.indices.end(), { a, b, a + 1 });
+			}
+			if (ring < rings - 1)
+			{
+				mesh.indices.insert(mesh.indices.end(), { a + 1, b, b + 1 });
+			}
+		}
+	}
+}
+
+// fastest of repeats runs, in ms
+static double time(int repeats, const function<void()>& run)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		auto start = chrono::steady_clock::now();
+		run();
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	Mesh mesh;
+	int next = 2;
+	if (argc >= 3 && string(argv[1]) == "--sphere")
+	{
+		makeSphere(max(2, stoi(argv[2])), mesh);
+		next = 3;
+	}
+	else if (argc < 2 || !loadObj(argv[1], mesh))
+	{
+		cerr << "usage: NormalsBench <mesh.obj> [repeats]" << endl;
+		cerr << "       NormalsBench --sphere <rings> [repeats]" << endl;
+		return 1;
+	}
+	int repeats = argc > next ? max(1, stoi(argv[next])) : 5;
+	size_t vertexCount = mesh.positions.size() / 3;
+	size_t faceCount = mesh.indices.size() / 3;
+	cout << vertexCount << " vertices, " << faceCount << " triangles, best of " << repeats << endl;
+
+	vector<float> reference;
+	double scatterTime = time(repeats, [&]() { scatterNormals(mesh, reference); });
+	cout << "scatter (old): " << scatterTime << " ms" << endl;
+
+	ThreadPool& pool = Normals::getThreadPool();
+	vector<float> serial(mesh.positions.size());
+	vector<float> parallel(mesh.positions.size());
+	for (NormalWeighting weighting : { NORMAL_WEIGHT_UNIFORM, NORMAL_WEIGHT_AREA, NORMAL_WEIGHT_ANGLE })
+	{
+		auto generate = [&](ThreadPool *threads, vector<float>& normals)
+		{
+			Normals::generate(mesh.positions.data(), vertexCount, mesh.indices.data(), mesh.indices.size(), normals.data(), weighting, threads);
+		};
+		double serialTime = time(repeats, [&]() { generate(nullptr, serial); });
+		double parallelTime = time(repeats, [&]() { generate(&pool, parallel); });
+		cout << Normals::getWeightingName(weighting) << " weighting:" << endl;
+		cout << "    1 thread:  " << serialTime << " ms (" << scatterTime / serialTime << "x)" << endl;
+		cout << "    " << pool.getThreadCount() << " threads: " << parallelTime << " ms (" << scatterTime / parallelTime << "x)" << endl;
+		// every vertex sums its faces in the same order either way
+		if (serial != parallel)
+		{
+			cout << "    threaded normals differ from the single threaded ones" << endl;
+		}
+		if (weighting == NORMAL_WEIGHT_UNIFORM)
+		{
+			// only the rounding of the normalizing can differ, and degenerate faces, which were NaN before
+			float difference = 0.0f;
+			for (size_t i = 0; i < serial.size(); i++)
+			{
+				if (!std::isnan(reference[i]))
+				{
+					difference = max(difference, fabs(serial[i] - reference[i]));
+				}
+			}
+			cout << "    largest difference from scatter: " << difference << endl;
+		}
+	}
+	return 0;
+}
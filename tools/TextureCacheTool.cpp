@@ -0,0 +1,75 @@
+/*
+ * Bakes the renderer's compressed texture caches ahead of time, so even the
+ * first launch maps BC1 levels instead of decoding and compressing.
+ *
+ *   TextureCacheTool <resourceDir> <texture> [texture...]
+ *
+ * Textures are named relative to resourceDir/textures and the caches go to
+ * resourceDir/cache/textures. A cache is only picked up for the exact path the
+ * renderer asks for, so run this from the directory the renderer runs in with
+ * the same resourceDir, e.g. `./tools/TextureCacheTool ../resources skybox.jpeg rock.jpg`
+ * from the build directory.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <future>
+
+#include "Texture.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		cerr << "usage: TextureCacheTool <resourceDir> <texture> [texture...]" << endl;
+		return 1;
+	}
+
+	string resourceDir = argv[1];
+	Texture::compress = true;
+	TextureCache::directory = resourceDir + "/cache/textures";
+
+	// one texture per worker, each is encoded on its own
+	ThreadPool pool;
+	vector<string> paths;
+	vector<future<unique_ptr<TextureData>>> results;
+	for (int i = 2; i < argc; i++)
+	{
+		string path = resourceDir + "/textures/" + argv[i];
+		paths.push_back(path);
+		results.push_back(pool.submit([path]() { return Texture::prepare(path); }));
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		unique_ptr<TextureData> data = results[i].get();
+		if (data->levels.empty())
+		{
+			failures++;
+			continue;
+		}
+		size_t bytes = 0;
+		for (size_t size : data->levelSizes)
+		{
+			bytes += size;
+		}
+		if (data->fromCache)
+		{
+			cout << paths[i] << ": already cached" << endl;
+		}
+		else
+		{
+			cout << paths[i] << ": " << data->width << "x" << data->height << ", " << data->levels.size() << " levels, "
+				<< bytes / 1024 << " KB, decoded in " << data->decodeTime << " ms, mips in " << data->mipTime << " ms, compressed in "
+				<< data->encodeTime << " ms" << endl;
+		}
+		cout << "    -> " << TextureCache::getCachePath(paths[i]) << endl;
+	}
+	return failures == 0 ? 0 : 1;
+}